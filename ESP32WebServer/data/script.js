@@ -1,23 +1,6 @@
-// === Variabel Global untuk Fetching ===
-// Variabel _last dan _fetching sudah tidak diperlukan lagi
-
-// FUNGSI INI TELAH DIPERBAIKI
-// Selalu mengambil data terbaru tanpa logika caching yang salah.
-async function fetchLast() {
-  try {
-    const response = await fetch('/last', { cache: 'no-store' });
-    if (!response.ok) {
-      console.error("Gagal mengambil data sensor:", response.statusText);
-      return null; // Kembalikan null jika ada error
-    }
-    return await response.json();
-  } catch (e) {
-    console.error("Terjadi exception saat fetch:", e);
-    return null; // Kembalikan null jika ada exception
-  }
-}
-
 // === Fungsi Pembuat Chart Real-time ===
+// Titik baru datang dari telemetri WebSocket (handleTelemetry), bukan polling /last;
+// plugin realtime hanya menggeser sumbu waktu setiap refresh.
 function makeRealtimeChart(canvasId, key, color, yMin, yMax) {
   const ctx = document.getElementById(canvasId).getContext('2d');
   return new Chart(ctx, {
@@ -44,24 +27,7 @@ function makeRealtimeChart(canvasId, key, color, yMin, yMax) {
           realtime: {
             duration: 60000,
             refresh: 1000,
-            delay: 2000,
-            onRefresh: async (chart) => {
-              const j = await fetchLast(); // Panggil fungsi yang sudah diperbaiki
-              if (!j || typeof j[key] !== 'number') return; // Cek jika data valid
-
-              chart.data.datasets[0].data.push({ x: Date.now(), y: j[key] });
-
-              // Panggil updateTable dari sini agar sinkron dengan chart
-              const tableIdMap = {
-                  ph: 'tablePH',
-                  turb: 'tableTurbidity',
-                  oks: 'tableOksigen',
-                  suhu: 'tableSuhu'
-              };
-              if (tableIdMap[key]) {
-                  updateTable(tableIdMap[key], key, j[key]);
-              }
-            }
+            delay: 2000
           }
         },
         y: { min: yMin, max: yMax }
@@ -91,24 +57,42 @@ const chartTurb = makeRealtimeChart('chartTurbidity', 'turb', '#2196F3', 0, 100)
 const chartOks = makeRealtimeChart('chartOksigen', 'oks', '#FF9800', 0, 20);
 const chartSuhu = makeRealtimeChart('chartSuhu', 'suhu', '#E91E63', 0, 50);
 
+// Chart dan tabel per key kanal (key sama dengan JSON /snapshot dan telemetri)
+const channelViews = {
+  ph: { chart: chartPH, tableId: 'tablePH' },
+  turb: { chart: chartTurb, tableId: 'tableTurbidity' },
+  oks: { chart: chartOks, tableId: 'tableOksigen' },
+  suhu: { chart: chartSuhu, tableId: 'tableSuhu' }
+};
+
+// === Telemetri WebSocket ===
+// Firmware membroadcast {"t":..,"ph":..,"turb":..,...} setiap detik (job "telemetry")
+function handleTelemetry(data) {
+  const now = Date.now();
+  for (const key in channelViews) {
+    if (typeof data[key] !== 'number') continue;
+    const { chart, tableId } = channelViews[key];
+    chart.data.datasets[0].data.push({ x: now, y: data[key] });
+    updateTable(tableId, key, data[key]);
+  }
+}
+
 // === Memuat Data Historis Saat Halaman Dibuka ===
+// Satu request /snapshot: riwayat, threshold, status relay & mode sekaligus
 async function loadInitialData() {
   try {
     console.log("Memuat data historis...");
-    const response = await fetch('/data');
-    const historicalData = await response.json();
+    const response = await fetch('/snapshot', { cache: 'no-store' });
+    const snapshot = await response.json();
+    const historicalData = snapshot.data || {};
     const now = Date.now();
 
-    const items = {
-      ph: { chart: chartPH, tableId: 'tablePH' },
-      turb: { chart: chartTurb, tableId: 'tableTurbidity' },
-      oks: { chart: chartOks, tableId: 'tableOksigen' },
-      suhu: { chart: chartSuhu, tableId: 'tableSuhu' }
-    };
+    if (snapshot.thresholds) fillThresholds(snapshot.thresholds);
+    if (snapshot.status) updateRelayStatusUI(snapshot.status);
 
     for (const key in historicalData) {
-      if (items[key] && Array.isArray(historicalData[key])) {
-        const { chart, tableId } = items[key];
+      if (channelViews[key] && Array.isArray(historicalData[key])) {
+        const { chart, tableId } = channelViews[key];
         const dataset = chart.data.datasets[0].data;
         const tableBody = document.querySelector(`#${tableId} tbody`);
         tableBody.innerHTML = '';
@@ -130,10 +114,35 @@ async function loadInitialData() {
   }
 }
 
-document.addEventListener('DOMContentLoaded', loadInitialData);
-
 // === WebSocket Logic ===
 let ws;
+// Perintah diberi nomor urut "#n" dan dijawab {"ack":n,"ok":..}, jadi beberapa
+// perintah boleh dikirim beruntun tanpa menunggu jawaban sebelumnya.
+let commandSeq = 0;
+const pendingCommands = new Map();
+
+function sendCommand(tokens) {
+    return new Promise((resolve, reject) => {
+        if(!ws || ws.readyState !== WebSocket.OPEN) return reject(new Error('WebSocket belum terhubung'));
+        const seq = ++commandSeq;
+        const timer = setTimeout(() => {
+            pendingCommands.delete(seq);
+            reject(new Error('timeout'));
+        }, 3000);
+        pendingCommands.set(seq, { resolve, reject, timer });
+        ws.send('#' + seq + ' ' + tokens.join(' '));
+    });
+}
+
+function handleCommandAck(data) {
+    const pending = pendingCommands.get(data.ack);
+    if (!pending) return;
+    pendingCommands.delete(data.ack);
+    clearTimeout(pending.timer);
+    if (data.ok) pending.resolve();
+    else pending.reject(new Error(data.error));
+}
+
 function connectWebSocket() {
     ws = new WebSocket(`ws://${window.location.hostname}:81`);
     
@@ -143,13 +152,37 @@ function connectWebSocket() {
     
     ws.onclose = () => {
         console.log('WebSocket Disconnected');
+        for (const [seq, pending] of pendingCommands) {
+            clearTimeout(pending.timer);
+            pending.reject(new Error('WebSocket terputus'));
+        }
+        pendingCommands.clear();
         setTimeout(connectWebSocket, 1000);
     };
     
     ws.onmessage = (event) => {
         try {
             const data = JSON.parse(event.data);
+            if (typeof data.t === 'number') {
+                // Telemetri per detik; hanya pesan ini yang membawa "t"
+                handleTelemetry(data);
+                return;
+            }
             console.log('Received WebSocket data:', data); // Debug log
+            if (data.ack !== undefined) {
+                handleCommandAck(data);
+                return;
+            }
+            if (data.alarm) {
+                // Alarm kerusakan sensor dari firmware (SensorHealth)
+                console.warn(`Sensor ${data.alarm.sensor}: ${data.alarm.faults.join(', ')} ${data.alarm.active ? 'AKTIF' : 'pulih'}`);
+                return;
+            }
+            if (data.watchdog) {
+                // Loop kontrol sempat macet, relay dipaksa ke pola aman oleh firmware
+                console.warn(`Watchdog: loop macet ${data.watchdog.ms} ms di tahap ${data.watchdog.stage} (total ${data.watchdog.misses})`);
+                return;
+            }
             updateRelayStatusUI(data);
         } catch(e) {
             console.error('WebSocket message error:', e);
@@ -166,7 +199,8 @@ async function sendButton(relay) {
     const current = statusEl ? statusEl.textContent.trim() : 'OFF';
     const desired = (current === 'ON') ? 'off' : 'on';
     
-    ws.send(relay + '_' + desired);
+    sendCommand([relay + '_' + desired])
+        .catch(e => console.warn(`Perintah ${relay}_${desired} ditolak: ${e.message}`));
 }
 
 // ganti fungsi toggleMode
@@ -175,10 +209,11 @@ function toggleMode() {
     
     const modeBtn = document.getElementById('mode-toggle');
     const currentMode = modeBtn.textContent.trim().toLowerCase();
-    ws.send('mode_' + (currentMode === 'auto' ? 'manual' : 'auto'));
+    const next = 'mode_' + (currentMode === 'auto' ? 'manual' : 'auto');
+    sendCommand([next]).catch(e => console.warn(`Perintah ${next} ditolak: ${e.message}`));
 }
 
-// update event listener
+// Satu-satunya registrasi DOMContentLoaded: snapshot awal lalu WebSocket
 window.addEventListener('DOMContentLoaded', () => {
     loadInitialData();
     connectWebSocket();
@@ -228,18 +263,21 @@ function updateRelayStatusUI(status) {
 async function loadThresholds() {
     try {
         const response = await fetch('/thresholds');
-        const thresholds = await response.json();
-        
-        // Update input fields
-        for (const sensor of ['ph', 'turb', 'oks', 'suhu']) {
-            document.getElementById(`${sensor}-min`).value = thresholds[sensor].min;
-            document.getElementById(`${sensor}-max`).value = thresholds[sensor].max;
-        }
+        fillThresholds(await response.json());
     } catch (error) {
         console.error('Failed to load thresholds:', error);
     }
 }
 
+// Isi input threshold dari objek {ph:{min,max}, turb:..., oks:..., suhu:...}
+function fillThresholds(thresholds) {
+    for (const sensor of ['ph', 'turb', 'oks', 'suhu']) {
+        if (!thresholds[sensor]) continue;
+        document.getElementById(`${sensor}-min`).value = thresholds[sensor].min;
+        document.getElementById(`${sensor}-max`).value = thresholds[sensor].max;
+    }
+}
+
 // Function to update threshold
 async function updateThreshold(sensor) {
     const minVal = parseFloat(document.getElementById(`${sensor}-min`).value);
@@ -277,8 +315,36 @@ async function updateThreshold(sensor) {
     }
 }
 
-// Load thresholds when page loads
-document.addEventListener('DOMContentLoaded', () => {
-    loadThresholds();
-    // ... existing DOMContentLoaded handlers ...
-});
\ No newline at end of file
+// Simpan keempat threshold dalam satu POST; firmware memvalidasi semuanya
+// dan hanya menerapkan jika seluruhnya valid
+async function updateAllThresholds() {
+    const body = {};
+    for (const sensor of ['ph', 'turb', 'oks', 'suhu']) {
+        const minVal = parseFloat(document.getElementById(`${sensor}-min`).value);
+        const maxVal = parseFloat(document.getElementById(`${sensor}-max`).value);
+        if (isNaN(minVal) || isNaN(maxVal) || minVal >= maxVal) {
+            alert(`Invalid range for ${sensor}`);
+            return;
+        }
+        body[sensor] = { min: minVal, max: maxVal };
+    }
+
+    try {
+        const response = await fetch('/thresholds', {
+            method: 'POST',
+            headers: {
+                'Content-Type': 'application/json',
+            },
+            body: JSON.stringify(body)
+        });
+
+        if (!response.ok) throw new Error(await response.text());
+
+        alert('Thresholds updated successfully');
+    } catch (error) {
+        console.error('Error updating thresholds:', error);
+        alert('Failed to update thresholds');
+    }
+}
+
+// Threshold sudah dimuat lewat /snapshot di loadInitialData()
\ No newline at end of file
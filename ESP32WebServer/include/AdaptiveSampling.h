@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+// Sampling dan pencatatan adaptif per kanal, O(1) per sampel tanpa alokasi.
+//
+// Sampling: interval mulai dari fastMs. Aktivitas dinilai dari laju perubahan
+// (selisih nilai per jendela) dan simpangan baku terhadap rata-rata bergerak
+// (EWMA), keduanya dengan jendela 4 x slowMs. Jika salah satu melewati
+// batasnya, interval langsung kembali ke fastMs. Jika satu jendela penuh
+// tenang, interval digandakan sampai slowMs.
+//
+// Pencatatan: sampel masuk riwayat hanya jika berubah lebih dari deadband
+// sejak sampel tercatat terakhir, atau heartbeatMs sudah lewat.
+
+struct SamplingConfig
+{
+  uint16_t fastMs;      // interval sampling saat aktif
+  uint16_t slowMs;      // interval terlama saat stabil
+  float activeRate;     // |perubahan| per detik (satuan akhir) di atas ini = aktif
+  float activeStdDev;   // simpangan baku di atas ini = aktif
+  float deadband;       // perubahan minimum untuk dicatat ke riwayat
+  uint32_t heartbeatMs; // catat paling lambat setiap ini walaupun tidak berubah
+};
+
+class AdaptiveSampler
+{
+public:
+  explicit AdaptiveSampler(const SamplingConfig &c) : cfg(c), interval(c.fastMs) {}
+
+  /// @brief sudah waktunya mengambil sampel baru
+  bool due(uint32_t nowMs) const { return !started || (int32_t)(nowMs - nextMs) >= 0; }
+
+  /// @brief ms sampai sampel berikutnya jatuh tempo (0 jika sudah)
+  uint32_t msUntilDue(uint32_t nowMs) const
+  {
+    int32_t d = (int32_t)(nextMs - nowMs);
+    return started && d > 0 ? (uint32_t)d : 0;
+  }
+
+  /// @brief ms sejak sampel sebelumnya, 0 untuk sampel pertama
+  uint32_t sinceLast(uint32_t nowMs) const { return started ? nowMs - lastMs : 0; }
+
+  /// @brief masukkan sampel baru lalu sesuaikan interval
+  /// @param v nilai akhir, NaN (sensor tidak valid) dianggap aktif
+  void observe(uint32_t nowMs, float v)
+  {
+    if (isnan(v))
+    {
+      busy = true;
+      interval = cfg.fastMs;
+      nextMs = nowMs + interval;
+      return;
+    }
+    const uint32_t window = 4u * cfg.slowMs;
+    if (!started || isnan(mean))
+    {
+      started = true;
+      mean = refValue = v;
+      variance = rate = 0;
+      refMs = nowMs;
+    }
+    else
+    {
+      float a = 1.0f - expf(-(float)(nowMs - lastMs) / (float)window);
+      float d = v - mean;
+      mean += a * d;
+      variance = (1.0f - a) * (variance + a * d * d);
+    }
+    lastMs = nowMs;
+
+    bool windowDone = nowMs - refMs >= window;
+    if (windowDone)
+    {
+      rate = fabsf(v - refValue) * 1000.0f / (float)(nowMs - refMs);
+      refValue = v;
+      refMs = nowMs;
+    }
+    busy = rate > cfg.activeRate || variance > cfg.activeStdDev * cfg.activeStdDev;
+    if (busy)
+      interval = cfg.fastMs;
+    else if (windowDone)
+      interval = interval * 2u > cfg.slowMs ? cfg.slowMs : interval * 2u;
+    nextMs = nowMs + interval;
+  }
+
+  /// @brief nilai v perlu dicatat (melewati deadband atau heartbeat)
+  bool shouldLog(uint32_t nowMs, float v) const
+  {
+    if (!hasLogged || nowMs - loggedMs >= cfg.heartbeatMs)
+      return true;
+    if (isnan(v) || isnan(loggedValue))
+      return isnan(v) != isnan(loggedValue);
+    return fabsf(v - loggedValue) >= cfg.deadband;
+  }
+
+  void logged(uint32_t nowMs, float v)
+  {
+    hasLogged = true;
+    loggedMs = nowMs;
+    loggedValue = v;
+  }
+
+  uint32_t intervalMs() const { return interval; }
+  bool active() const { return busy; }
+  float ratePerSec() const { return rate; }
+  float stdDev() const { return sqrtf(variance); }
+
+private:
+  const SamplingConfig cfg;
+  uint32_t interval;
+  bool started = false;
+  bool busy = true;
+  uint32_t lastMs = 0;
+  uint32_t nextMs = 0;
+  float mean = 0;
+  float variance = 0;
+  float rate = 0;
+  float refValue = 0; // nilai awal jendela laju
+  uint32_t refMs = 0;
+
+  bool hasLogged = false;
+  uint32_t loggedMs = 0;
+  float loggedValue = 0;
+};
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// Driver ADS1115 (ADC I2C 16 bit, 4 input single-ended) tanpa menunggu konversi.
+//
+// Chip dipakai dalam mode single-shot dan mengonversi input yang diaktifkan
+// bergiliran. Pin ALERT/RDY dikonfigurasi sebagai sinyal conversion-ready
+// (Hi_thresh MSB = 1, Lo_thresh MSB = 0) dan memicu interrupt yang hanya
+// menyetel flag. poll() dipanggil dari job "adc": jika flag belum menyala
+// langsung kembali; jika sudah, hasil dibaca dan konversi input berikutnya
+// dimulai. Loop tidak pernah menunggu ADC, hanya membayar transaksi I2C
+// pendek (~0.9 ms per konversi pada 100 kHz). Tanpa pin RDY (rdyPin = -1)
+// bit OS register config dicek setelah waktu konversi nominal lewat.
+class Ads1115
+{
+public:
+  enum Gain : uint16_t // rentang skala penuh (PGA)
+  {
+    FSR_6V144 = 0x0000,
+    FSR_4V096 = 0x0200,
+    FSR_2V048 = 0x0400,
+    FSR_1V024 = 0x0600,
+    FSR_0V512 = 0x0800,
+    FSR_0V256 = 0x0A00,
+  };
+
+  enum Rate : uint16_t // sampel per detik
+  {
+    SPS_8 = 0x0000,
+    SPS_16 = 0x0020,
+    SPS_32 = 0x0040,
+    SPS_64 = 0x0060,
+    SPS_128 = 0x0080,
+    SPS_250 = 0x00A0,
+    SPS_475 = 0x00C0,
+    SPS_860 = 0x00E0,
+  };
+
+  /// @brief inisialisasi chip dan mulai konversi pertama
+  /// @param address 0x48..0x4B (pin ADDR)
+  /// @param rdyPin pin ESP32 yang terhubung ke ALERT/RDY, -1 = tanpa interrupt
+  /// @param channelMask bit 0..3 = AIN0..AIN3 yang dikonversi
+  /// @return false jika chip tidak menjawab
+  bool begin(TwoWire &wire, uint8_t address, int rdyPin, uint8_t channelMask, Gain gain = FSR_4V096, Rate rate = SPS_64)
+  {
+    bus = &wire;
+    addr = address;
+    rdy = rdyPin;
+    mask = channelMask & 0x0F;
+    pga = gain;
+    dr = rate;
+    static const uint16_t sps[8] = {8, 16, 32, 64, 128, 250, 475, 860};
+    conversionUs = 1100000UL / sps[(rate >> 5) & 7] + 100; // osilator internal +-10%
+
+    if (!mask || !writeReg(REG_LO_THRESH, 0x0000) || !writeReg(REG_HI_THRESH, 0x8000))
+      return false;
+    if (rdy >= 0)
+    {
+      pinMode(rdy, INPUT_PULLUP); // ALERT/RDY open drain
+      attachInterruptArg(digitalPinToInterrupt(rdy), onReady, this, FALLING);
+    }
+    current = 3;
+    return startNext();
+  }
+
+  /// @brief panggil sesering mungkin; tidak pernah menunggu konversi
+  /// @return true jika ada hasil baru untuk input `channel`
+  bool poll(uint8_t &channel, int16_t &raw)
+  {
+    if (!mask || !bus)
+      return false;
+    uint32_t elapsed = micros() - startedUs;
+    if (rdy >= 0)
+    {
+      // Interrupt terlewat (mis. glitch saat start): pulihkan setelah 2x waktu konversi
+      if (!ready && elapsed < 2 * conversionUs)
+        return false;
+    }
+    else
+    {
+      uint16_t config;
+      if (elapsed < conversionUs)
+        return false;
+      if (!readReg(REG_CONFIG, config))
+        return fail();
+      if (!(config & CONFIG_OS))
+        return false; // masih mengonversi
+    }
+
+    uint16_t value;
+    if (!readReg(REG_CONVERSION, value))
+      return fail();
+    channel = current;
+    raw = (int16_t)value;
+    conversions++;
+    startNext();
+    return true;
+  }
+
+  /// @brief volt per count untuk gain yang dipakai
+  float lsbVolts() const
+  {
+    static const float fsr[6] = {6.144f, 4.096f, 2.048f, 1.024f, 0.512f, 0.256f};
+    return fsr[pga >> 9] / 32768.0f;
+  }
+
+  uint32_t conversionCount() const { return conversions; }
+  uint32_t errorCount() const { return errors; }
+
+private:
+  static const uint8_t REG_CONVERSION = 0x00;
+  static const uint8_t REG_CONFIG = 0x01;
+  static const uint8_t REG_LO_THRESH = 0x02;
+  static const uint8_t REG_HI_THRESH = 0x03;
+  static const uint16_t CONFIG_OS = 0x8000;   // tulis: mulai konversi; baca: 1 = idle
+  static const uint16_t CONFIG_MODE = 0x0100; // single-shot
+  // COMP_MODE/POL/LAT = 0, COMP_QUE = 00: ALERT/RDY aktif low setiap akhir konversi
+
+  static void IRAM_ATTR onReady(void *arg)
+  {
+    static_cast<Ads1115 *>(arg)->ready = true;
+  }
+
+  bool startNext()
+  {
+    do
+      current = (current + 1) & 3;
+    while (!(mask & (1 << current)));
+
+    // MUX 1xx = AINx terhadap GND
+    uint16_t config = CONFIG_OS | (uint16_t)((4 + current) << 12) | pga | CONFIG_MODE | dr;
+    ready = false;
+    startedUs = micros();
+    if (!writeReg(REG_CONFIG, config))
+      return fail();
+    return true;
+  }
+
+  bool fail()
+  {
+    errors++;
+    startedUs = micros(); // coba lagi setelah satu periode konversi
+    ready = false;
+    writeReg(REG_CONFIG, CONFIG_OS | (uint16_t)((4 + current) << 12) | pga | CONFIG_MODE | dr);
+    return false;
+  }
+
+  bool writeReg(uint8_t reg, uint16_t value)
+  {
+    bus->beginTransmission(addr);
+    bus->write(reg);
+    bus->write((uint8_t)(value >> 8));
+    bus->write((uint8_t)value);
+    return bus->endTransmission() == 0;
+  }
+
+  bool readReg(uint8_t reg, uint16_t &value)
+  {
+    bus->beginTransmission(addr);
+    bus->write(reg);
+    if (bus->endTransmission() != 0 || bus->requestFrom(addr, (size_t)2) != 2)
+      return false;
+    value = (uint16_t)(bus->read() << 8);
+    value |= (uint16_t)bus->read();
+    return true;
+  }
+
+  TwoWire *bus = nullptr;
+  uint8_t addr = 0x48;
+  int rdy = -1;
+  uint8_t mask = 0;
+  uint16_t pga = FSR_4V096;
+  uint16_t dr = SPS_64;
+  uint8_t current = 0;
+  uint32_t conversionUs = 0;
+  uint32_t startedUs = 0;
+  uint32_t conversions = 0;
+  uint32_t errors = 0;
+  volatile bool ready = false;
+};
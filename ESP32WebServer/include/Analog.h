@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+// Input analog dengan filter EMA. Di firmware update() membaca ADC langsung;
+// update(raw) dipakai replay di host (tools/replay) dengan nilai ADC dari jejak.
+class Analog
+{
+public:
+  enum VarType
+  {
+    VOLTAGE,
+    FINAL,
+    PERCENT,
+    ADC
+  };
+  /// @brief inisialisasi pin analog dengan filter alpha
+  /// @param p pin analog, -1 = tanpa pin (sampel diberikan lewat update(raw))
+  /// @param a variabel alpha (0 < a < 1), semakin kecil semakin halus
+  Analog(int p, float a) : pin(p), alpha(a), voltage(0.0), final(0.0), percent(0.0), smoothedRaw(0.0)
+  {
+#ifdef ARDUINO
+    if (p >= 0)
+      pinMode(pin, INPUT);
+#endif
+  }
+#ifdef ARDUINO
+  /// @brief panggil di loop utama
+  void update()
+  {
+    update(analogRead(pin));
+  }
+#endif
+  /// @brief filter satu sampel ADC mentah (0..4095)
+  void update(int raw)
+  {
+    if (firstRead)
+    {
+      smoothedRaw = (float)raw;
+      firstRead = false;
+    }
+    else
+    {
+      smoothedRaw = (alpha * (float)raw) + ((1 - alpha) * smoothedRaw);
+    }
+
+    voltage = (round(smoothedRaw) / 4095.0f) * 3.3f;
+    percent = (round(smoothedRaw) / 4095.0f) * 100.0f;
+    // percent = smoothedRaw;
+  }
+
+  /// @brief seperti update(raw), tetapi alpha disetarakan untuk `periods` periode
+  /// dasar sehingga konstanta waktu filter (dalam ms) tidak berubah saat laju sampling turun.
+  /// Alpha setara dibatasi maxCatchUpAlpha: tanpa batas nilainya mendekati 1 di
+  /// mode jarang dan satu sampel menggantikan seluruh state filter (derau lolos).
+  void updateAfter(int raw, uint32_t periods)
+  {
+    if (periods <= 1)
+    {
+      update(raw);
+      return;
+    }
+    float a = alpha;
+    alpha = 1.0f - powf(1.0f - alpha, (float)periods);
+    if (alpha > maxCatchUpAlpha)
+      alpha = maxCatchUpAlpha;
+    if (alpha < a)
+      alpha = a;
+    update(raw);
+    alpha = a;
+  }
+
+  /// @brief batas alpha setara updateAfter(); dengan rata-rata 8 bacaan, derau
+  /// keluaran di mode jarang kira-kira sama dengan mode cepat (alpha 0.1)
+  static constexpr float maxCatchUpAlpha = 0.5f;
+
+  /// @brief mendapatkan pin analog
+  uint8_t getPin() { return pin; }
+
+  /// @brief mengambil nilai variabel (alpha, voltage, final)
+  float getVar(VarType var) const
+  { // Tambahkan 'const' karena fungsi ini tidak mengubah state objek
+    switch (var)
+    {
+    case VOLTAGE:
+      return voltage;
+    case FINAL:
+      return final;
+    case PERCENT:
+      return percent;
+    case ADC:
+      return smoothedRaw;
+    default:
+      return 0.0; // Nilai default jika ada case yang tidak terduga
+    }
+  }
+
+  void setFinal(float v)
+  {
+    final = v;
+  }
+
+private:
+  const uint8_t pin;
+  float alpha;
+  float voltage;
+  float final;
+  float percent;
+  float smoothedRaw;
+  bool firstRead = true;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdint.h>
+#include "DoTrend.h"
+#include "PhDosing.h"
+
+// Aturan relay mode otomatis, terpisah dari hardware supaya bisa diputar ulang
+// di host (tools/replay) dengan jam simulasi.
+
+struct threshold_t
+{
+  float min;
+  float max;
+};
+
+enum SensorChannel
+{
+  CH_PH = 1 << 0,
+  CH_TURB = 1 << 1,
+  CH_OKS = 1 << 2,
+  CH_SUHU = 1 << 3,
+};
+
+// Relay -> kanal yang menjadi dasar keputusannya, dan state aman saat kanal itu rusak.
+// DO dihitung dari suhu, jadi aerator juga bergantung pada CH_SUHU.
+struct RelaySafeState
+{
+  uint8_t channels;
+  bool safeState;
+};
+const RelaySafeState relaySafeStates[5] = {
+    {CH_PH, false},          // relay1: dosing basa (pH naik)
+    {CH_PH, false},          // relay2: dosing asam (pH turun)
+    {CH_TURB, false},        // relay3: pompa sirkulasi/filter
+    {CH_OKS | CH_SUHU, true}, // relay4: aerator tetap nyala
+    {CH_SUHU, false},        // relay5: heater
+};
+
+struct ControlThresholds
+{
+  threshold_t ph;
+  threshold_t turbidity;
+  threshold_t oksigen;
+  threshold_t suhu;
+};
+
+struct ControlReading
+{
+  float ph;
+  float turb;
+  float oks;
+  float suhu;
+  uint8_t invalid; // bitmask SensorChannel yang sedang rusak
+};
+
+/// @brief keputusan satu tick logika otomatis
+/// @param turbidityCycleOn fase siklus pompa saat kekeruhan di dalam band
+/// @param dosing kontroler dosing pH untuk relay1/relay2
+/// @param out state relay yang diinginkan (hanya untuk bit yang dikembalikan)
+/// @return bitmask relay yang diputuskan pada tick ini; relay lain dibiarkan
+inline uint8_t autoRelayDecide(const ControlReading &r, const ControlThresholds &th,
+                               bool turbidityCycleOn, DoTrend &trend, PhDosing &dosing,
+                               uint32_t nowMs, bool out[5])
+{
+  uint8_t driven = 0;
+  for (int i = 0; i < 5; i++)
+  {
+    // paksa relay ke state aman jika sensor yang menjadi dasarnya rusak
+    if (relaySafeStates[i].channels & r.invalid)
+    {
+      out[i] = relaySafeStates[i].safeState;
+      driven |= 1 << i;
+    }
+  }
+
+  // Heater: nyala jika suhu di bawah min
+  if (!(driven & (1 << 4)))
+  {
+    out[4] = r.suhu < th.suhu.min;
+    driven |= 1 << 4;
+  }
+
+  // Pompa: nyala jika keruh, mati jika jernih, di dalam band mengikuti siklus timer
+  if (!(driven & (1 << 2)))
+  {
+    if (r.turb > th.turbidity.max)
+      out[2] = true;
+    else if (r.turb < th.turbidity.min)
+      out[2] = false;
+    else
+      out[2] = turbidityCycleOn;
+    driven |= 1 << 2;
+  }
+
+  // Dosing pH: PI time-proportional menuju tengah band setelah pH keluar band dalam (include/PhDosing.h)
+  if (!(driven & 0x03))
+  {
+    uint8_t dose = dosing.update(nowMs, r.ph, th.ph.min, th.ph.max);
+    out[0] = dose & PH_DOSE_BASE;
+    out[1] = dose & PH_DOSE_ACID;
+    driven |= 0x03;
+  }
+  else
+    dosing.reset(nowMs);
+
+  // Aerator: nyala di bawah min, atau lebih awal jika tren memprediksi DO akan
+  // jatuh di bawah min; ditahan sampai min + releaseMargin (DoTrend::shouldAerate)
+  if (driven & (1 << 3))
+    trend.latchAerating();
+  else
+  {
+    out[3] = trend.shouldAerate(th.oksigen.min, th.oksigen.max, r.oks);
+    driven |= 1 << 3;
+  }
+  return driven;
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "Analog.h"
+#include "AutoRelay.h"
+#include "SensorHealth.h"
+#include "AdaptiveSampling.h"
+
+// Registry kanal sensor. Satu tabel descriptor (constexpr di src/main.cpp)
+// menentukan jumlah kanal, sumber nilai, konversi, threshold awal, konfigurasi
+// deteksi fault, kunci JSON/CSV dan label LCD. Penyimpanan riwayat, endpoint
+// HTTP, MQTT dan LCD mengiterasi tabel ini, sehingga menambah probe cukup
+// menambah satu baris. Indeks kanal dicari saat kompilasi dengan indexOf().
+
+enum ChannelSource : uint8_t
+{
+  SRC_INTERNAL_ADC, // pin ADC ESP32, difilter EMA oleh Analog
+  SRC_ADS1115,      // ADC I2C eksternal (include/Ads1115.h); input = chip * 4 + kanal
+  SRC_EXTERNAL,     // diisi kode lain lewat setValue() (mis. DS18B20)
+};
+
+/// @brief tegangan (V) -> nilai akhir (pH, NTU, mg/L, ...)
+typedef float (*ChannelConvert)(float voltage);
+
+struct ChannelDesc
+{
+  const char *key;        // kunci JSON/CSV/MQTT, mis. "ph"
+  const char *label;      // label LCD, maks 3 karakter
+  uint8_t decimals;       // digit desimal di LCD
+  ChannelSource source;
+  uint8_t input;          // pin (SRC_INTERNAL_ADC) atau chip * 4 + kanal (SRC_ADS1115)
+  ChannelConvert convert; // nullptr untuk SRC_EXTERNAL
+  threshold_t threshold;  // threshold awal
+  SensorHealthConfig health;
+  SamplingConfig sampling; // sampling & pencatatan adaptif (include/AdaptiveSampling.h)
+};
+
+template <int N>
+struct ChannelTable
+{
+  static_assert(N > 0, "minimal satu kanal");
+
+  ChannelDesc ch[N];
+
+  static constexpr int size() { return N; }
+  constexpr const ChannelDesc &operator[](int i) const { return ch[i]; }
+
+  /// @brief indeks kanal untuk key, -1 jika tidak ada (bisa dievaluasi saat kompilasi)
+  constexpr int indexOf(const char *key, int i = 0) const
+  {
+    return !key || i >= N ? -1 : (keyEquals(ch[i].key, key) ? i : indexOf(key, i + 1));
+  }
+
+  /// @brief semua baris terisi, key unik, dan kanal ADC punya fungsi konversi
+  constexpr bool valid(int i = 0) const
+  {
+    return i >= N || (ch[i].key && ch[i].label && indexOf(ch[i].key) == i &&
+                      (ch[i].convert || ch[i].source == SRC_EXTERNAL) && valid(i + 1));
+  }
+
+private:
+  static constexpr bool keyEquals(const char *a, const char *b)
+  {
+    return *a == *b && (*a == '\0' || keyEquals(a + 1, b + 1));
+  }
+};
+
+// Urutan indeks 0..N-1 untuk menginisialisasi array anggota dari tabel (C++11)
+template <int... I>
+struct ChannelIndices
+{
+};
+template <int N, int... I>
+struct MakeChannelIndices : MakeChannelIndices<N - 1, N - 1, I...>
+{
+};
+template <int... I>
+struct MakeChannelIndices<0, I...>
+{
+  typedef ChannelIndices<I...> type;
+};
+
+// State runtime semua kanal: filter, nilai akhir, nilai mentah, kesehatan, threshold,
+// laju sampling adaptif.
+template <int N>
+class ChannelBank
+{
+public:
+  explicit ChannelBank(const ChannelTable<N> &t) : ChannelBank(t, typename MakeChannelIndices<N>::type()) {}
+
+  const ChannelTable<N> &table;
+  Analog filter[N];        // hanya dipakai kanal SRC_INTERNAL_ADC
+  SensorHealth health[N];  // kanal SRC_EXTERNAL diperbarui oleh pengisinya
+  threshold_t threshold[N];
+  float value[N];          // nilai akhir terakhir
+  float raw[N];            // nilai mentah untuk deteksi fault (ADC count)
+  AdaptiveSampler sampler[N];
+  uint32_t sampledMs[N];   // waktu sampel terakhir
+  bool fresh[N];           // ada sampel baru yang belum dievaluasi kesehatannya
+
+  /// @brief baca dan konversi kanal ADC internal yang jatuh tempo (dipanggil dari job "adc").
+  /// Kanal yang lama tidak dibaca dirata-rata dari beberapa bacaan (maks 8)
+  /// menggantikan sampel yang dilewati, lalu alpha disetarakan (Analog::updateAfter).
+  /// @param baseMs periode dasar filter Analog (periode job "adc" saat semua kanal aktif)
+  /// @param read int read(int kanal): satu bacaan ADC mentah 0..4095 (analogRead di
+  ///        firmware, jejak di tools/replay)
+  /// @return ms sampai kanal ADC internal berikutnya jatuh tempo
+  template <class Read>
+  uint32_t sampleInternal(uint32_t nowMs, uint32_t baseMs, Read read)
+  {
+    uint32_t wait = 0xFFFFFFFFUL;
+    for (int i = 0; i < N; i++)
+    {
+      if (table[i].source != SRC_INTERNAL_ADC)
+        continue;
+      if (sampler[i].due(nowMs))
+      {
+        uint32_t periods = sampler[i].sinceLast(nowMs) / baseMs;
+        int n = periods < 8 ? (periods ? (int)periods : 1) : 8;
+        int32_t sum = 0;
+        for (int k = 0; k < n; k++)
+          sum += read(i);
+        filter[i].updateAfter((int)((sum + n / 2) / n), periods);
+        convertFiltered(i, nowMs);
+        sampler[i].observe(nowMs, value[i]);
+      }
+      uint32_t w = sampler[i].msUntilDue(nowMs);
+      wait = w < wait ? w : wait;
+    }
+    return wait;
+  }
+
+#ifdef ARDUINO
+  uint32_t sampleInternal(uint32_t nowMs, uint32_t baseMs)
+  {
+    return sampleInternal(nowMs, baseMs, [this](int i) { return (int)analogRead(table[i].input); });
+  }
+#endif
+
+  /// @brief filter satu sampel ADC internal mentah (0..4095), dipakai juga di host
+  void updateInternal(int i, int adc, uint32_t nowMs)
+  {
+    filter[i].update(adc);
+    convertFiltered(i, nowMs);
+  }
+
+  /// @brief hasil konversi ADC eksternal (sudah difilter oleh ADC itu sendiri;
+  /// lajunya diatur ADC tersebut, sampler hanya menilai aktivitas)
+  void setVoltage(int i, float voltage, float rawCount, uint32_t nowMs)
+  {
+    raw[i] = rawCount;
+    value[i] = table[i].convert ? table[i].convert(voltage) : voltage;
+    markSampled(i, nowMs);
+    sampler[i].observe(nowMs, value[i]);
+  }
+
+  /// @brief nilai kanal SRC_EXTERNAL; pengisi memakai sampler[i].due() untuk laju bacanya
+  void setValue(int i, float v, uint32_t nowMs)
+  {
+    value[i] = v;
+    raw[i] = v;
+    markSampled(i, nowMs);
+    sampler[i].observe(nowMs, v);
+  }
+
+  /// @brief ada kanal yang melewati deadband atau heartbeat sejak pencatatan terakhir
+  bool logDue(uint32_t nowMs) const
+  {
+    for (int i = 0; i < N; i++)
+      if (sampler[i].shouldLog(nowMs, value[i]))
+        return true;
+    return false;
+  }
+
+  /// @brief semua kanal baru saja dicatat (riwayat menyimpan satu baris semua kanal)
+  void markLogged(uint32_t nowMs)
+  {
+    for (int i = 0; i < N; i++)
+      sampler[i].logged(nowMs, value[i]);
+  }
+
+  /// @brief evaluasi kesehatan kanal yang nilainya berasal dari ADC, hanya jika
+  /// ada sampel baru sejak evaluasi terakhir dan dengan waktu sampel itu,
+  /// sehingga cek laju memakai jarak antar sampel yang sebenarnya dan nilai
+  /// yang ditahan saat sampling jarang tidak dihitung "stuck". Kanal
+  /// SRC_EXTERNAL dievaluasi oleh pengisinya; di sini hanya status terakhirnya.
+  uint8_t updateHealth(int i)
+  {
+    if (table[i].source == SRC_EXTERNAL || !fresh[i])
+      return health[i].faults();
+    fresh[i] = false;
+    return health[i].update(value[i], raw[i], sampledMs[i]);
+  }
+
+private:
+  template <int... I>
+  ChannelBank(const ChannelTable<N> &t, ChannelIndices<I...>)
+      : table(t),
+        filter{Analog(t[I].source == SRC_INTERNAL_ADC ? t[I].input : -1, 0.1f)...},
+        health{SensorHealth(t[I].health)...},
+        threshold{t[I].threshold...},
+        value{},
+        raw{},
+        sampler{AdaptiveSampler(t[I].sampling)...},
+        sampledMs{},
+        fresh{}
+  {
+  }
+
+  void markSampled(int i, uint32_t nowMs)
+  {
+    sampledMs[i] = nowMs;
+    fresh[i] = true;
+  }
+
+  void convertFiltered(int i, uint32_t nowMs)
+  {
+    raw[i] = filter[i].getVar(Analog::ADC);
+    float voltage = filter[i].getVar(Analog::VOLTAGE);
+    value[i] = table[i].convert ? table[i].convert(voltage) : voltage;
+    filter[i].setFinal(value[i]);
+    markSampled(i, nowMs);
+  }
+};
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Perintah kontrol dari WebSocket. Frame teks di-parse tanpa alokasi menjadi
+// satu Command, lalu dititipkan ke antrian lock-free yang dikonsumsi loop
+// kontrol. Satu frame boleh berisi beberapa token (batch) yang diterapkan
+// sekaligus dalam satu tick:
+//
+//   relay3_on                          format lama, tanpa ack
+//   #17 relay1_on relay2_off mode_manual
+//
+// "#<seq>" (opsional, di awal) meminta ack {"ack":seq,"ok":..} sehingga client
+// bisa mengirim beberapa perintah tanpa menunggu round trip satu per satu.
+// Token dipisah spasi, koma, titik koma atau newline.
+
+enum CommandMode : int8_t
+{
+  CMD_MODE_KEEP = -1,
+  CMD_MODE_MANUAL = 0,
+  CMD_MODE_AUTO = 1,
+};
+
+struct Command
+{
+  uint32_t seq;      // nomor urut dari client, 0 = tanpa ack
+  uint8_t client;    // nomor client WebSocket
+  uint8_t relayMask; // bit i = relay i+1 diubah
+  uint8_t relayOn;   // state baru untuk bit di relayMask
+  int8_t mode;       // CommandMode
+};
+
+enum CommandStatus : uint8_t
+{
+  CMD_OK,
+  CMD_INVALID,   // token tidak dikenal, batch ditolak seluruhnya
+  CMD_AUTO_MODE, // relay tidak boleh diubah saat mode otomatis
+  CMD_BUSY,      // antrian penuh
+};
+
+struct CommandAck
+{
+  uint32_t seq;
+  uint8_t client;
+  uint8_t status; // CommandStatus
+};
+
+inline const char *commandStatusName(uint8_t status)
+{
+  switch (status)
+  {
+  case CMD_OK:
+    return "ok";
+  case CMD_INVALID:
+    return "invalid";
+  case CMD_AUTO_MODE:
+    return "auto mode";
+  case CMD_BUSY:
+    return "busy";
+  default:
+    return "unknown";
+  }
+}
+
+enum CommandParse : uint8_t
+{
+  PARSE_OK,
+  PARSE_EMPTY,
+  PARSE_INVALID,
+};
+
+inline bool commandTokenIs(const char *tok, size_t n, const char *word)
+{
+  size_t i = 0;
+  for (; i < n && word[i]; i++)
+    if (tok[i] != word[i])
+      return false;
+  return i == n && word[i] == '\0';
+}
+
+/// @brief parse satu frame teks (tidak harus diakhiri null)
+/// @param relayCount jumlah relay yang valid (relay1..relayN, maks 8)
+/// @return PARSE_INVALID jika ada token yang salah; out.seq tetap terisi bila sudah terbaca
+inline CommandParse parseCommand(const uint8_t *payload, size_t len, uint8_t relayCount, Command &out)
+{
+  out.seq = 0;
+  out.relayMask = 0;
+  out.relayOn = 0;
+  out.mode = CMD_MODE_KEEP;
+
+  const char *p = (const char *)payload;
+  const char *end = p + len;
+  bool any = false;
+  while (p < end)
+  {
+    if (*p == ' ' || *p == ',' || *p == ';' || *p == '\n' || *p == '\r' || *p == '\t')
+    {
+      p++;
+      continue;
+    }
+    const char *tok = p;
+    while (p < end && *p != ' ' && *p != ',' && *p != ';' && *p != '\n' && *p != '\r' && *p != '\t')
+      p++;
+    size_t n = p - tok;
+
+    if (tok[0] == '#')
+    {
+      if (any || out.seq || n < 2 || n > 10)
+        return PARSE_INVALID;
+      uint32_t seq = 0;
+      for (size_t i = 1; i < n; i++)
+      {
+        if (tok[i] < '0' || tok[i] > '9')
+          return PARSE_INVALID;
+        seq = seq * 10 + (tok[i] - '0');
+      }
+      out.seq = seq;
+      continue;
+    }
+
+    any = true;
+    if (commandTokenIs(tok, n, "mode_auto"))
+      out.mode = CMD_MODE_AUTO;
+    else if (commandTokenIs(tok, n, "mode_manual"))
+      out.mode = CMD_MODE_MANUAL;
+    else if (n >= 9 && commandTokenIs(tok, 5, "relay") && tok[5] >= '1' && tok[5] < '1' + relayCount && tok[5] <= '8' &&
+             tok[6] == '_' && (commandTokenIs(tok + 7, n - 7, "on") || commandTokenIs(tok + 7, n - 7, "off")))
+    {
+      uint8_t bit = 1 << (tok[5] - '1');
+      out.relayMask |= bit;
+      if (n == 9)
+        out.relayOn |= bit;
+      else
+        out.relayOn &= ~bit;
+    }
+    else
+      return PARSE_INVALID;
+  }
+  return any ? PARSE_OK : (out.seq ? PARSE_INVALID : PARSE_EMPTY); // "#n" tanpa token tetap dijawab
+}
+
+// Antrian bounded single-producer/single-consumer tanpa lock. Producer dan
+// consumer masing-masing hanya menulis satu indeks; slot dipublikasikan
+// dengan release/acquire sehingga aman walaupun keduanya berjalan di task
+// atau core berbeda.
+template <typename T, uint32_t Capacity>
+class SpscQueue
+{
+  static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "Capacity harus pangkat dua");
+
+public:
+  bool push(const T &item)
+  {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= Capacity)
+      return false;
+    slots[h & (Capacity - 1)] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T &item)
+  {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire))
+      return false;
+    item = slots[t & (Capacity - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const
+  {
+    return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+  }
+
+private:
+  T slots[Capacity];
+  std::atomic<uint32_t> head{0}; // ditulis producer
+  std::atomic<uint32_t> tail{0}; // ditulis consumer
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+#include "HistoryStore.h"
+#include "ChannelRegistry.h"
+
+// Riwayat sampel semua kanal (HistoryStore terkompresi) plus serialisasi data
+// grafik /data dan /snapshot. Timestamp diberikan pemanggil (millis() di
+// firmware) sehingga kelas ini juga bisa diukur di host (tools/bench).
+template <int N, int BlockBytes, int Blocks>
+class DataList
+{
+public:
+  typedef HistoryStore<N, BlockBytes, Blocks> Store;
+  typedef typename Store::Sample Sample;
+  typedef typename Store::Reader Reader;
+
+  // Konstruktor: chartPoints = jumlah titik terakhir untuk grafik
+  DataList(const ChannelTable<N> &table, float resolution, int chartPoints)
+      : table(table), store(resolution), chartPoints(chartPoints) {}
+
+  void addData(uint32_t t, const float *values)
+  {
+    Sample sample;
+    sample.t = t;
+    memcpy(sample.v, values, sizeof(sample.v));
+    store.append(sample);
+  }
+
+  // Jumlah sampel yang tersimpan
+  int getCount() const
+  {
+    return store.count();
+  }
+
+#ifdef ARDUINO
+  // Data grafik (chartPoints terakhir) sebagai string berformat
+  String getChartData(const String &sensor) const
+  {
+    char buf[chartBufSize];
+    size_t len = 0;
+    if (!writeChartData(sensor.c_str(), buf, sizeof(buf), len))
+      return "[]";
+    return String(buf);
+  }
+#endif
+
+  /// @brief sama seperti getChartData() tetapi ditulis ke buffer tetap (tanpa String)
+  /// @return false jika buffer tidak cukup
+  bool writeChartData(const char *sensor, char *buf, size_t size, size_t &len) const
+  {
+    int ch = table.indexOf(sensor);
+    if (ch < 0 || len + 1 >= size)
+      return false;
+    buf[len++] = '[';
+    uint32_t skip = store.count() > (uint32_t)chartPoints ? store.count() - chartPoints : 0;
+    bool first = true;
+    for (Reader r = store.fromIndex(skip); r.get(); r.next())
+    {
+      int n = snprintf(buf + len, size - len, first ? "%.2f" : ",%.2f", r.get()->v[ch]);
+      if (n < 0 || len + n >= size)
+        return false;
+      len += n;
+      first = false;
+    }
+    if (len + 1 >= size)
+      return false;
+    buf[len++] = ']';
+    buf[len] = '\0';
+    return true;
+  }
+
+  // Sampel terakhir (nilai asli, tanpa kuantisasi), nullptr jika kosong
+  const Sample *getLastNode() const
+  {
+    return store.last();
+  }
+
+  /// @brief iterator dari sampel tertua
+  Reader begin() const
+  {
+    return store.begin();
+  }
+
+  /// @brief iterator ke sampel pertama dengan timestamp > t (untuk melanjutkan
+  /// iterasi setelah riwayat berubah, tanpa menyimpan posisi blok yang mungkin sudah dibuang)
+  Reader firstAfter(uint32_t t, bool inclusive = false) const
+  {
+    return store.firstAfter(t, inclusive);
+  }
+
+private:
+  static const size_t chartBufSize = 512;
+  const ChannelTable<N> &table;
+  Store store;
+  int chartPoints;
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+// Lookup table for Dissolved Oxygen (DO) in mg/L at different temperatures (0-40°C)
+// (nilai x1000, yaitu µg/L pada saturasi 100%)
+const uint16_t DO_Table[41] = {
+    14460, 14220, 13820, 13440, 13090, 12740, 12420, 12110, 11810, 11530,
+    11260, 11010, 10770, 10530, 10300, 10080, 9860, 9660, 9460, 9270,
+    9080, 8900, 8730, 8570, 8410, 8250, 8110, 7960, 7820, 7690,
+    7560, 7430, 7300, 7180, 7070, 6950, 6840, 6730, 6630, 6530, 6410};
+
+/// @brief DO saturasi (mg/L) pada suhu tertentu, interpolasi linear DO_Table
+inline float doSaturation(float tempC)
+{
+  if (!(tempC > 0.0f)) // termasuk NaN
+    return DO_Table[0] / 1000.0f;
+  if (tempC >= 40.0f)
+    return DO_Table[40] / 1000.0f;
+  int i = (int)tempC;
+  float frac = tempC - i;
+  return (DO_Table[i] + (DO_Table[i + 1] - DO_Table[i]) * frac) / 1000.0f;
+}
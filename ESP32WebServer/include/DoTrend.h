@@ -0,0 +1,174 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#include "DoTable.h"
+
+// Regresi linear bergulir (sliding window) dengan jumlah berjalan, O(1) per sampel.
+// x = indeks sampel di dalam window (0..n-1), sampel diasumsikan berjarak sama.
+// Jumlah disimpan dalam double supaya penambahan/pengurangan berulang tidak drift.
+template <int W>
+class RollingRegression
+{
+public:
+  void reset()
+  {
+    n = 0;
+    head = 0;
+    sy = sxy = syy = 0;
+  }
+
+  void add(float y)
+  {
+    if (n < W)
+    {
+      // indeks baru = n
+      sy += y;
+      sxy += (double)n * y;
+      syy += (double)y * y;
+      ring[(head + n) % W] = y;
+      n++;
+      return;
+    }
+    // Window penuh: buang sampel tertua, semua indeks bergeser -1
+    float y0 = ring[head];
+    ring[head] = y;
+    head = (head + 1) % W;
+    sxy = sxy - (sy - y0) + (double)(W - 1) * y;
+    sy = sy - y0 + y;
+    syy = syy - (double)y0 * y0 + (double)y * y;
+  }
+
+  int count() const { return n; }
+
+  /// @brief kemiringan per sampel
+  float slope() const
+  {
+    if (n < 2)
+      return 0;
+    double sx = n * (n - 1) / 2.0;
+    double sxx = (n - 1) * n * (2.0 * n - 1) / 6.0;
+    return (float)((n * sxy - sx * sy) / (n * sxx - sx * sx));
+  }
+
+  /// @brief nilai garis regresi pada sampel terbaru (lebih halus dari sampel mentah)
+  float fittedLast() const
+  {
+    if (n == 0)
+      return 0;
+    double sx = n * (n - 1) / 2.0;
+    double intercept = (sy - slope() * sx) / n;
+    return (float)(intercept + slope() * (n - 1));
+  }
+
+  /// @brief koefisien determinasi R² (0..1), ukuran seberapa linear trennya
+  float r2() const
+  {
+    if (n < 3)
+      return 0;
+    double sx = n * (n - 1) / 2.0;
+    double sxx = (n - 1) * n * (2.0 * n - 1) / 6.0;
+    double num = n * sxy - sx * sy;
+    double den = (n * sxx - sx * sx) * (n * syy - sy * sy);
+    return den > 0 ? (float)(num * num / den) : 0;
+  }
+
+private:
+  float ring[W];
+  int n = 0;
+  int head = 0;
+  double sy = 0, sxy = 0, syy = 0;
+};
+
+struct DoTrendConfig
+{
+  uint32_t sampleIntervalMs; // jarak antar sampel ke estimator
+  int minSamples;            // sampel minimum sebelum prediksi dipakai
+  float minR2;               // kualitas fit minimum agar tren dipercaya
+  float leadSec;             // nyalakan aerator jika DO diprediksi < min dalam waktu ini
+  float releaseMargin;       // mg/L di atas min sebelum aerator dilepas
+};
+
+// Estimator tren DO malam hari. Regresi dilakukan pada fraksi saturasi
+// (DO / DOsat(T)) sehingga perubahan suhu tidak terbaca sebagai tren DO,
+// lalu prediksi dikembalikan ke mg/L dengan suhu hasil regresi.
+class DoTrend
+{
+public:
+  static const int Window = 30; // 30 sampel x 10 s = 5 menit
+
+  explicit DoTrend(const DoTrendConfig &c) : cfg(c) {}
+
+  void reset()
+  {
+    sat.reset();
+    temp.reset();
+    aerating = false;
+  }
+
+  /// @brief tambahkan satu sampel (panggil setiap cfg.sampleIntervalMs)
+  void update(float doMgL, float tempC)
+  {
+    sat.add(doMgL / doSaturation(tempC));
+    temp.add(tempC);
+  }
+
+  bool ready() const { return sat.count() >= cfg.minSamples && sat.r2() >= cfg.minR2; }
+
+  /// @brief laju perubahan DO dalam mg/L per jam (berdasarkan saturasi x DOsat suhu sekarang)
+  float slopePerHour() const
+  {
+    float perSec = sat.slope() * 1000.0f / cfg.sampleIntervalMs;
+    return perSec * 3600.0f * doSaturation(temp.fittedLast());
+  }
+
+  /// @brief prediksi DO (mg/L) h detik ke depan
+  float forecast(float hSec) const
+  {
+    float samples = hSec * 1000.0f / cfg.sampleIntervalMs;
+    float s = sat.fittedLast() + sat.slope() * samples;
+    float t = temp.fittedLast() + temp.slope() * samples;
+    return s * doSaturation(t);
+  }
+
+  /// @brief perkiraan detik sampai DO menyentuh threshold; -1 jika tidak turun / belum siap
+  float secondsToThreshold(float thresholdMgL) const
+  {
+    if (!ready() || sat.slope() >= 0)
+      return -1;
+    float sThr = thresholdMgL / doSaturation(temp.fittedLast());
+    float sNow = sat.fittedLast();
+    if (sNow <= sThr)
+      return 0;
+    return (sNow - sThr) / -sat.slope() * cfg.sampleIntervalMs / 1000.0f;
+  }
+
+  /// @brief keputusan aerator (reaktif dan prediktif) dengan hysteresis.
+  /// Nyala jika DO < min atau diprediksi < min dalam leadSec; setelah nyala
+  /// baru dilepas saat DO > min + releaseMargin dan tren tidak lagi turun
+  /// (atau belum bisa dinilai). Di atas max selalu mati.
+  /// @param doNow DO terukur saat ini (mg/L)
+  bool shouldAerate(float minMgL, float maxMgL, float doNow)
+  {
+    float eta = secondsToThreshold(minMgL);
+    if (doNow > maxMgL)
+      aerating = false;
+    else if (!aerating)
+      aerating = doNow < minMgL || (eta >= 0 && eta <= cfg.leadSec);
+    else if (doNow > minMgL + cfg.releaseMargin && (!ready() || sat.slope() >= 0))
+      aerating = false;
+    return aerating;
+  }
+
+  /// @brief aerator sedang dipaksa nyala (state aman sensor rusak); setelah
+  /// sensor pulih dilepas dengan hysteresis yang sama
+  void latchAerating() { aerating = true; }
+
+  bool isAerating() const { return aerating; }
+
+private:
+  const DoTrendConfig cfg;
+  RollingRegression<Window> sat;
+  RollingRegression<Window> temp;
+  bool aerating = false;
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Jurnal kejadian relay dan mode: record biner 16 byte di ring RAM berukuran
+// tetap. append() O(1) tanpa alokasi sehingga aman dipanggil dari setRelay().
+// Penulisan ke flash dilakukan terpisah per batch (lihat journalFlush() di
+// src/main.cpp); ring hanya mencatat sampai nomor urut mana yang sudah
+// tersimpan. Jika ring penuh sebelum sempat di-flush, kejadian tertua yang
+// belum tersimpan dibuang dan dihitung di dropped().
+
+enum JournalSource : uint8_t
+{
+  JS_BOOT,     // kit menyala (pemisah sesi, t dihitung ulang dari 0)
+  JS_AUTO,     // autoRelayLogic()
+  JS_HTTP,     // /button, /mode
+  JS_WS,       // perintah WebSocket
+  JS_MQTT,     // topik cmd MQTT
+  JS_MODBUS,   // coil Modbus TCP
+  JS_WATCHDOG, // relay dipaksa ke pola aman oleh watchdog
+  JS_FS,       // SPIFFS gagal mount atau diformat lewat POST /spiffs/format (relay tidak berubah)
+};
+
+const char *const journalSourceNames[] = {"boot", "auto", "http", "ws", "mqtt", "modbus", "watchdog", "fs"};
+
+// Bit 0..4 = relay1..relay5, bit 7 = mode otomatis
+const uint8_t JOURNAL_AUTO_BIT = 0x80;
+
+struct JournalEvent
+{
+  uint32_t seq;     // nomor urut global, naik terus melewati reboot
+  uint32_t t;       // millis() saat kejadian
+  uint8_t source;   // JournalSource
+  uint8_t before;   // relay + mode sebelum
+  uint8_t after;    // relay + mode sesudah
+  uint8_t channel;  // kanal pemicu, 0xFF = tidak ada
+  int16_t reading;  // nilai kanal pemicu x100, INT16_MIN = tidak valid
+  uint16_t reserved;
+};
+
+static_assert(sizeof(JournalEvent) == 16, "record jurnal harus 16 byte");
+
+template <int Capacity>
+class EventJournal
+{
+  static_assert(Capacity >= 2, "minimal dua record");
+
+public:
+  /// @brief lanjutkan penomoran dari jurnal di flash (dipanggil sekali saat boot)
+  void resume(uint32_t nextSeq)
+  {
+    next = flushed = first = nextSeq;
+  }
+
+  /// @brief catat kejadian; seq diisi otomatis
+  /// @return nomor urut kejadian
+  uint32_t append(JournalEvent e)
+  {
+    if (next - first == (uint32_t)Capacity)
+    {
+      if (flushed == first)
+      {
+        flushed++; // belum sempat tersimpan
+        lost++;
+      }
+      first++;
+    }
+    e.seq = next;
+    ring[next % Capacity] = e;
+    return next++;
+  }
+
+  /// @brief record dengan nomor urut seq, nullptr jika sudah keluar dari ring
+  const JournalEvent *at(uint32_t seq) const
+  {
+    if ((int32_t)(seq - first) < 0 || (int32_t)(seq - next) >= 0)
+      return nullptr;
+    return &ring[seq % Capacity];
+  }
+
+  /// @brief potongan kontigu record yang belum tersimpan (maks dua potong karena ring)
+  /// @return jumlah record di ptr, 0 jika semua sudah tersimpan
+  size_t pendingSpan(const JournalEvent *&ptr) const
+  {
+    if (flushed == next)
+      return 0;
+    uint32_t idx = flushed % Capacity;
+    uint32_t n = next - flushed;
+    if (idx + n > (uint32_t)Capacity)
+      n = Capacity - idx;
+    ptr = &ring[idx];
+    return n;
+  }
+
+  void markFlushed(size_t n) { flushed += n; }
+
+  uint32_t pending() const { return next - flushed; }
+  uint32_t oldestSeq() const { return first; }
+  uint32_t nextSeq() const { return next; }
+  uint32_t dropped() const { return lost; }
+
+private:
+  JournalEvent ring[Capacity] = {};
+  uint32_t first = 0;   // record tertua di ring
+  uint32_t flushed = 0; // record pertama yang belum tersimpan
+  uint32_t next = 0;    // nomor urut berikutnya
+  uint32_t lost = 0;
+};
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#include "AutoRelay.h"
+
+// Indeks agregat riwayat per kanal: min, max, rata-rata, durasi dan jumlah
+// sampel di luar threshold untuk jendela waktu apa pun, tanpa memindai sampel.
+//
+// Waktu dibagi ke bucket tetap bucketMs dalam ring Buckets slot (mis. 144 x 10
+// menit = 24 jam, jauh lebih panjang dari sampel mentah di HistoryStore). Di
+// atas ring dibangun segment tree (array 2 x Buckets, daun di Buckets + slot):
+// append memperbarui daun bucket berjalan lalu jalur ke akar, O(log Buckets);
+// query menggabungkan O(log Buckets) node. Jendela dibulatkan keluar ke batas
+// bucket, batas yang dipakai ikut dilaporkan.
+//
+// Rata-rata dan durasi berbobot waktu (sample and hold): nilai sampel berlaku
+// sampai sampel berikutnya, karena pencatatan adaptif tidak berinterval tetap.
+// Jeda lebih dari maxGapMs tidak dihitung. NaN (sensor tidak valid) tidak
+// masuk min/max/rata-rata. "Di luar threshold" dinilai dengan threshold yang
+// berlaku saat sampel dicatat. Tanpa alokasi heap.
+
+struct StatsResult
+{
+  uint32_t fromMs;     // awal bucket pertama
+  uint32_t toMs;       // akhir bucket terakhir (sampel terakhir untuk bucket berjalan)
+  uint32_t samples;    // sampel tercatat di jendela
+  float min;           // NaN jika tidak ada nilai valid
+  float max;
+  float mean;          // rata-rata berbobot waktu, NaN jika validMs = 0
+  uint32_t validMs;    // durasi dengan nilai valid
+  uint32_t outMs;      // durasi di luar threshold
+  uint32_t outSamples; // sampel di luar threshold
+};
+
+template <int Channels, int Buckets>
+class HistoryStats
+{
+  static_assert(Buckets >= 2, "minimal dua bucket");
+
+public:
+  HistoryStats(uint32_t bucketMs, uint32_t maxGapMs) : bucketMs(bucketMs), maxGapMs(maxGapMs)
+  {
+    for (int i = 0; i < 2 * Buckets; i++)
+      clearNode(tree[i]);
+  }
+
+  /// @brief catat satu baris riwayat (semua kanal), t tidak boleh mundur
+  void append(uint32_t t, const float *v, const threshold_t *threshold)
+  {
+    if (!started)
+    {
+      started = true;
+      bucketStart = t - t % bucketMs;
+      curSeq = firstSeq = 0;
+    }
+    else
+    {
+      if ((int32_t)(t - prevT) < 0)
+        return;
+      if (t - prevT <= maxGapMs)
+        hold(prevT, t - prevT);
+      advance(t);
+    }
+
+    int slot = curSeq % Buckets;
+    Node &leaf = tree[Buckets + slot];
+    leaf.samples++;
+    for (int c = 0; c < Channels; c++)
+    {
+      prevV[c] = v[c];
+      prevOut[c] = !isnan(v[c]) && (v[c] < threshold[c].min || v[c] > threshold[c].max);
+      if (isnan(v[c]))
+        continue;
+      Cell &x = leaf.c[c];
+      x.min = v[c] < x.min ? v[c] : x.min;
+      x.max = v[c] > x.max ? v[c] : x.max;
+      x.outCount += prevOut[c];
+    }
+    pull(slot);
+    prevT = t;
+  }
+
+  /// @brief agregat kanal ch pada jendela [fromMs, toMs] (timestamp millis())
+  /// @return false jika jendela di luar data yang tersimpan
+  bool query(int ch, uint32_t fromMs, uint32_t toMs, StatsResult &out) const
+  {
+    if (!started || ch < 0 || ch >= Channels || (int32_t)(toMs - fromMs) < 0)
+      return false;
+    int64_t oldest = (int64_t)curSeq - (Buckets - 1);
+    if (oldest < (int64_t)firstSeq)
+      oldest = firstSeq;
+    int64_t lo = seqAt(fromMs), hi = seqAt(toMs);
+    lo = lo < oldest ? oldest : lo;
+    hi = hi > (int64_t)curSeq ? (int64_t)curSeq : hi;
+    if (lo > hi)
+      return false;
+
+    Node acc;
+    clearNode(acc);
+    int l = (int)(lo % Buckets), r = (int)(hi % Buckets);
+    if (l <= r)
+      range(l, r, acc);
+    else
+    {
+      range(l, Buckets - 1, acc);
+      range(0, r, acc);
+    }
+
+    const Cell &x = acc.c[ch];
+    out.fromMs = bucketStart - (uint32_t)((int64_t)curSeq - lo) * bucketMs;
+    out.toMs = hi == (int64_t)curSeq ? prevT : bucketStart - (uint32_t)((int64_t)curSeq - hi - 1) * bucketMs;
+    out.samples = acc.samples;
+    out.min = x.min <= x.max ? x.min : NAN;
+    out.max = x.min <= x.max ? x.max : NAN;
+    out.mean = x.validMs ? x.sum * 1000.0f / (float)x.validMs : NAN;
+    out.validMs = x.validMs;
+    out.outMs = x.outMs;
+    out.outSamples = x.outCount;
+    return true;
+  }
+
+  uint32_t bucketLengthMs() const { return bucketMs; }
+
+  static size_t capacityBytes() { return sizeof(Node) * 2 * Buckets; }
+
+private:
+  struct Cell
+  {
+    float min;
+    float max;
+    float sum; // nilai x detik
+    uint32_t validMs;
+    uint32_t outMs;
+    uint32_t outCount;
+  };
+
+  struct Node
+  {
+    uint32_t samples;
+    Cell c[Channels];
+  };
+
+  static void clearNode(Node &n)
+  {
+    n.samples = 0;
+    for (int c = 0; c < Channels; c++)
+      n.c[c] = {INFINITY, -INFINITY, 0.0f, 0, 0, 0};
+  }
+
+  static void merge(Node &into, const Node &n)
+  {
+    into.samples += n.samples;
+    for (int c = 0; c < Channels; c++)
+    {
+      Cell &a = into.c[c];
+      const Cell &b = n.c[c];
+      a.min = b.min < a.min ? b.min : a.min;
+      a.max = b.max > a.max ? b.max : a.max;
+      a.sum += b.sum;
+      a.validMs += b.validMs;
+      a.outMs += b.outMs;
+      a.outCount += b.outCount;
+    }
+  }
+
+  /// @brief hitung ulang leluhur daun slot, O(log Buckets)
+  void pull(int slot)
+  {
+    for (int i = (Buckets + slot) >> 1; i >= 1; i >>= 1)
+    {
+      tree[i] = tree[2 * i];
+      merge(tree[i], tree[2 * i + 1]);
+    }
+  }
+
+  /// @brief gabungkan slot l..r (tanpa wrap); operasi komutatif sehingga
+  /// Buckets tidak harus pangkat dua
+  void range(int l, int r, Node &acc) const
+  {
+    for (l += Buckets, r += Buckets + 1; l < r; l >>= 1, r >>= 1)
+    {
+      if (l & 1)
+        merge(acc, tree[l++]);
+      if (r & 1)
+        merge(acc, tree[--r]);
+    }
+  }
+
+  /// @brief nomor bucket untuk timestamp t (relatif ke bucket berjalan)
+  int64_t seqAt(uint32_t t) const
+  {
+    int32_t d = (int32_t)(t - bucketStart);
+    if (d >= 0)
+      return (int64_t)curSeq + d / (int64_t)bucketMs;
+    return (int64_t)curSeq - ((int64_t)-(int64_t)d + bucketMs - 1) / (int64_t)bucketMs;
+  }
+
+  /// @brief pindah ke bucket yang memuat t, bucket yang dilewati dikosongkan
+  void advance(uint32_t t)
+  {
+    if ((int32_t)(t - bucketStart) < 0)
+      return;
+    uint32_t k = (t - bucketStart) / bucketMs;
+    if (!k)
+      return;
+    uint32_t clear = k < (uint32_t)Buckets ? k : (uint32_t)Buckets;
+    for (uint32_t i = k - clear + 1; i <= k; i++)
+    {
+      int slot = (curSeq + i) % Buckets;
+      clearNode(tree[Buckets + slot]);
+      pull(slot);
+    }
+    curSeq += k;
+    bucketStart += k * bucketMs;
+    for (int c = 0; c < Channels; c++)
+      openSum[c] = 0;
+  }
+
+  /// @brief kredit durasi [from, from + dur) ke nilai sampel sebelumnya,
+  /// dipecah per bucket jika melewati batas bucket
+  void hold(uint32_t from, uint32_t dur)
+  {
+    while (dur)
+    {
+      advance(from);
+      uint32_t room = bucketStart + bucketMs - from;
+      uint32_t d = dur < room ? dur : room;
+      int slot = curSeq % Buckets;
+      Node &leaf = tree[Buckets + slot];
+      for (int c = 0; c < Channels; c++)
+      {
+        if (isnan(prevV[c]))
+          continue;
+        Cell &x = leaf.c[c];
+        x.min = prevV[c] < x.min ? prevV[c] : x.min;
+        x.max = prevV[c] > x.max ? prevV[c] : x.max;
+        openSum[c] += (double)prevV[c] * d; // presisi penuh selama bucket berjalan
+        x.sum = (float)(openSum[c] / 1000.0);
+        x.validMs += d;
+        if (prevOut[c])
+          x.outMs += d;
+      }
+      pull(slot);
+      from += d;
+      dur -= d;
+    }
+  }
+
+  const uint32_t bucketMs;
+  const uint32_t maxGapMs;
+  Node tree[2 * Buckets];
+  bool started = false;
+  uint32_t firstSeq = 0;    // bucket pertama sejak boot
+  uint32_t curSeq = 0;      // bucket berjalan
+  uint32_t bucketStart = 0; // millis() awal bucket berjalan
+  double openSum[Channels] = {};
+
+  // Sampel sebelumnya, berlaku sampai sampel berikutnya
+  uint32_t prevT = 0;
+  float prevV[Channels] = {};
+  bool prevOut[Channels] = {};
+};
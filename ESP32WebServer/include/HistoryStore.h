@@ -0,0 +1,366 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+// Riwayat sensor terkompresi di RAM, gaya Gorilla, dalam blok berukuran tetap.
+//
+// - Timestamp: delta-of-delta. Interval pencatatan hampir konstan, jadi
+//   kebanyakan sampel cukup 1 bit.
+// - Nilai: dikuantisasi ke `resolution` (mis. 0.01, sama dengan presisi yang
+//   dikirim /data dan /export), lalu delta terhadap sampel sebelumnya dikodekan
+//   dengan prefix panjang variabel. Sinyal yang sudah difilter EMA jarang
+//   berubah lebih dari beberapa step per sampel.
+//
+// Sampel pertama tiap blok disimpan utuh di header sehingga setiap blok bisa
+// didekode sendiri. Sampel baru ditulis langsung di blok terakhir (append in
+// place). Jika blok penuh, blok baru dibuka dan blok tertua dibuang jika
+// semua slot terpakai. Tanpa alokasi heap.
+template <int Channels, int BlockBytes, int Blocks>
+class HistoryStore
+{
+  static_assert(BlockBytes > 0 && BlockBytes * 8 <= 0xFFFF, "offset bit harus muat di uint16_t");
+  static_assert(Blocks >= 2, "minimal dua blok");
+
+public:
+  struct Sample
+  {
+    uint32_t t; // millis() saat sampel dicatat
+    float v[Channels];
+  };
+
+  struct Block
+  {
+    uint32_t t0;          // timestamp sampel pertama
+    uint32_t tLast;       // timestamp sampel terakhir
+    int32_t q0[Channels]; // nilai terkuantisasi sampel pertama
+    uint16_t count;       // jumlah sampel di blok
+    uint16_t bits;        // bit terpakai di data
+    uint8_t data[BlockBytes];
+  };
+
+  explicit HistoryStore(float resolution) : resolution(resolution), scale(1.0f / resolution) {}
+
+  void append(const Sample &s)
+  {
+    int32_t q[Channels];
+    for (int c = 0; c < Channels; c++)
+      q[c] = quantize(s.v[c]);
+    lastSample = s;
+
+    if (nextSeq != firstSeq)
+    {
+      Block &b = blockAt(nextSeq - 1);
+      uint32_t pos = b.bits;
+      int32_t delta = (int32_t)(s.t - prevT);
+      if (encode(b.data, pos, (int32_t)((uint32_t)delta - (uint32_t)prevDelta), q))
+      {
+        b.bits = (uint16_t)pos;
+        b.count++;
+        b.tLast = s.t;
+        prevT = s.t;
+        prevDelta = delta;
+        memcpy(prevQ, q, sizeof(prevQ));
+        samples++;
+        return;
+      }
+      clearFrom(b, b.bits); // buang sisa sampel yang tidak muat
+    }
+    startBlock(s.t, q);
+  }
+
+  uint32_t count() const { return samples; }
+  bool empty() const { return samples == 0; }
+
+  /// @brief sampel terakhir apa adanya (tanpa kuantisasi), nullptr jika kosong
+  const Sample *last() const { return samples ? &lastSample : nullptr; }
+
+  /// @brief byte terpakai oleh data terkompresi (header + bit stream)
+  size_t bytesUsed() const
+  {
+    size_t used = 0;
+    for (uint32_t seq = firstSeq; seq != nextSeq; seq++)
+      used += sizeof(Block) - BlockBytes + (blockAt(seq).bits + 7) / 8;
+    return used;
+  }
+
+  static size_t capacityBytes() { return sizeof(Block) * Blocks; }
+
+  // Iterator dekode berurutan. Aman dipakai selama append berjalan (blok
+  // terakhir hanya bertambah); jika blok yang sedang dibaca sudah dibuang,
+  // get() menjadi nullptr dan pemanggil mencari ulang dengan firstAfter().
+  class Reader
+  {
+  public:
+    const Sample *get() const { return ok ? &cur : nullptr; }
+
+    /// @brief maju satu sampel
+    void next()
+    {
+      if (!ok)
+        return;
+      if ((int32_t)(seq - store->firstSeq) < 0)
+      {
+        ok = false;
+        return;
+      }
+      const Block &b = store->blockAt(seq);
+      if (idx + 1 < b.count)
+      {
+        idx++;
+        decodeNext(b);
+        return;
+      }
+      if (seq + 1 == store->nextSeq)
+      {
+        ok = false; // akhir riwayat
+        return;
+      }
+      seq++;
+      idx = 0;
+      loadHeader(store->blockAt(seq));
+    }
+
+  private:
+    friend class HistoryStore;
+
+    Reader(const HistoryStore *s) : store(s) {}
+
+    void start(uint32_t blockSeq)
+    {
+      seq = blockSeq;
+      idx = 0;
+      ok = seq != store->nextSeq;
+      if (ok)
+        loadHeader(store->blockAt(seq));
+    }
+
+    void loadHeader(const Block &b)
+    {
+      pos = 0;
+      t = b.t0;
+      delta = 0;
+      memcpy(q, b.q0, sizeof(q));
+      fill();
+    }
+
+    void decodeNext(const Block &b)
+    {
+      delta = (int32_t)((uint32_t)delta + (uint32_t)readField(b.data, pos, timeWidths));
+      t += (uint32_t)delta;
+      for (int c = 0; c < Channels; c++)
+        q[c] = (int32_t)((uint32_t)q[c] + (uint32_t)readField(b.data, pos, valueWidths));
+      fill();
+    }
+
+    void fill()
+    {
+      cur.t = t;
+      for (int c = 0; c < Channels; c++)
+        cur.v[c] = store->dequantize(q[c]);
+    }
+
+    const HistoryStore *store;
+    uint32_t seq = 0;
+    uint16_t idx = 0;
+    uint32_t pos = 0;
+    uint32_t t = 0;
+    int32_t delta = 0;
+    int32_t q[Channels] = {};
+    Sample cur = {};
+    bool ok = false;
+  };
+
+  /// @brief iterator dari sampel tertua
+  Reader begin() const
+  {
+    Reader r(this);
+    r.start(firstSeq);
+    return r;
+  }
+
+  /// @brief iterator setelah melewati skip sampel tertua (mis. count() - N untuk N terakhir)
+  Reader fromIndex(uint32_t skip) const
+  {
+    uint32_t seq = firstSeq;
+    while (seq != nextSeq && skip >= blockAt(seq).count)
+    {
+      skip -= blockAt(seq).count;
+      seq++;
+    }
+    Reader r(this);
+    r.start(seq);
+    while (skip-- && r.get())
+      r.next();
+    return r;
+  }
+
+  /// @brief iterator ke sampel pertama dengan timestamp > t (>= t jika inclusive)
+  Reader firstAfter(uint32_t t, bool inclusive = false) const
+  {
+    uint32_t seq = firstSeq;
+    while (seq != nextSeq && !after(blockAt(seq).tLast, t, inclusive))
+      seq++;
+    Reader r(this);
+    r.start(seq);
+    while (r.get() && !after(r.get()->t, t, inclusive))
+      r.next();
+    return r;
+  }
+
+private:
+  // Lebar field bertanda per prefix '10', '110', '1110'; '1111' = 32 bit penuh
+  static constexpr uint8_t timeWidths[3] = {7, 9, 12};
+  static constexpr uint8_t valueWidths[3] = {4, 8, 16};
+
+  static bool after(uint32_t a, uint32_t t, bool inclusive)
+  {
+    return inclusive ? (int32_t)(a - t) >= 0 : (int32_t)(a - t) > 0;
+  }
+
+  // NaN (sensor tidak valid) disimpan sebagai nilai sentinel
+  static const int32_t NanCode = INT32_MIN;
+
+  int32_t quantize(float v) const
+  {
+    if (isnan(v))
+      return NanCode;
+    float x = v * scale;
+    if (x >= 2147483520.0f)
+      return INT32_MAX;
+    if (x <= -2147483520.0f)
+      return INT32_MIN + 1;
+    return (int32_t)lroundf(x);
+  }
+
+  float dequantize(int32_t q) const
+  {
+    return q == NanCode ? NAN : (float)q * resolution;
+  }
+
+  Block &blockAt(uint32_t seq) { return blocks[seq % Blocks]; }
+  const Block &blockAt(uint32_t seq) const { return blocks[seq % Blocks]; }
+
+  void startBlock(uint32_t t, const int32_t *q)
+  {
+    if (nextSeq - firstSeq == (uint32_t)Blocks)
+    {
+      samples -= blockAt(firstSeq).count;
+      firstSeq++;
+    }
+    Block &b = blockAt(nextSeq++);
+    b.t0 = b.tLast = t;
+    memcpy(b.q0, q, sizeof(b.q0));
+    b.count = 1;
+    b.bits = 0;
+    memset(b.data, 0, sizeof(b.data));
+    prevT = t;
+    prevDelta = 0;
+    memcpy(prevQ, q, sizeof(prevQ));
+    samples++;
+  }
+
+  bool encode(uint8_t *data, uint32_t &pos, int32_t dod, const int32_t *q) const
+  {
+    if (!writeField(data, pos, dod, timeWidths))
+      return false;
+    for (int c = 0; c < Channels; c++)
+      if (!writeField(data, pos, (int32_t)((uint32_t)q[c] - (uint32_t)prevQ[c]), valueWidths))
+        return false;
+    return true;
+  }
+
+  static void clearFrom(Block &b, uint32_t pos)
+  {
+    if (pos & 7)
+      b.data[pos >> 3] &= (uint8_t)(0xFF << (8 - (pos & 7)));
+    uint32_t next = (pos + 7) >> 3;
+    if (next < (uint32_t)BlockBytes)
+      memset(b.data + next, 0, BlockBytes - next);
+  }
+
+  static bool fits(int32_t v, int bits)
+  {
+    return v >= -(1 << (bits - 1)) && v < (1 << (bits - 1));
+  }
+
+  static bool writeField(uint8_t *data, uint32_t &pos, int32_t v, const uint8_t *widths)
+  {
+    if (v == 0)
+      return putBits(data, pos, 0, 1);
+    for (int i = 0; i < 3; i++)
+    {
+      if (!fits(v, widths[i]))
+        continue;
+      // prefix: (i + 1) bit '1' diikuti '0'
+      return putBits(data, pos, ((1u << (i + 1)) - 1) << 1, i + 2) &&
+             putBits(data, pos, (uint32_t)v & ((1u << widths[i]) - 1), widths[i]);
+    }
+    return putBits(data, pos, 0xF, 4) && putBits(data, pos, (uint32_t)v, 32);
+  }
+
+  static int32_t readField(const uint8_t *data, uint32_t &pos, const uint8_t *widths)
+  {
+    int ones = 0;
+    while (ones < 4 && getBits(data, pos, 1))
+      ones++;
+    if (ones == 0)
+      return 0;
+    if (ones == 4)
+      return (int32_t)getBits(data, pos, 32);
+    int bits = widths[ones - 1];
+    uint32_t raw = getBits(data, pos, bits);
+    return (int32_t)(raw << (32 - bits)) >> (32 - bits); // sign extend
+  }
+
+  // Bit stream MSB-first; buffer harus sudah nol
+  static bool putBits(uint8_t *data, uint32_t &pos, uint32_t value, int n)
+  {
+    if (pos + n > (uint32_t)BlockBytes * 8)
+      return false;
+    while (n > 0)
+    {
+      int room = 8 - (pos & 7);
+      int take = n < room ? n : room;
+      uint32_t chunk = (value >> (n - take)) & ((1u << take) - 1);
+      data[pos >> 3] |= (uint8_t)(chunk << (room - take));
+      pos += take;
+      n -= take;
+    }
+    return true;
+  }
+
+  static uint32_t getBits(const uint8_t *data, uint32_t &pos, int n)
+  {
+    uint32_t value = 0;
+    while (n > 0)
+    {
+      int room = 8 - (pos & 7);
+      int take = n < room ? n : room;
+      uint32_t chunk = (data[pos >> 3] >> (room - take)) & ((1u << take) - 1);
+      value = (value << take) | chunk;
+      pos += take;
+      n -= take;
+    }
+    return value;
+  }
+
+  Block blocks[Blocks] = {};
+  uint32_t firstSeq = 0; // nomor urut blok tertua
+  uint32_t nextSeq = 0;  // nomor urut blok berikutnya (blok terakhir = nextSeq - 1)
+  uint32_t samples = 0;
+  const float resolution;
+  const float scale;
+
+  // State encoder untuk blok terakhir
+  uint32_t prevT = 0;
+  int32_t prevDelta = 0;
+  int32_t prevQ[Channels] = {};
+  Sample lastSample = {};
+};
+
+template <int Channels, int BlockBytes, int Blocks>
+constexpr uint8_t HistoryStore<Channels, BlockBytes, Blocks>::timeWidths[3];
+template <int Channels, int BlockBytes, int Blocks>
+constexpr uint8_t HistoryStore<Channels, BlockBytes, Blocks>::valueWidths[3];
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ChannelRegistry.h"
+#include "KitConfig.h"
+#include "SensorConversion.h"
+
+// Tabel kanal kit, dipakai bersama firmware (src/main.cpp), tools/replay/control_replay,
+// tools/bench dan tools/collector (daftar kolom penyimpanan).
+
+// ===== Kanal sensor =====
+// Satu baris per kanal (include/ChannelRegistry.h). Urutan baris = urutan kolom
+// /export, array MQTT dan sel LCD. Menambah probe cukup menambah baris dan
+// channelCount; kanal ph/turb/oks/suhu wajib ada karena dipakai autoRelayLogic().
+// health: physMin, physMax, maxRate/s, railLow, railHigh, stuckSamples, stuckEps, blockSamples, maxStdDev, clearSamples
+// (dievaluasi per sampel baru, paling sering tiap 50 ms bersama pencatatan data;
+// jumlah sampel stuck/blok/clear berarti lebih lama saat kanal disampling jarang)
+// sampling: fastMs, slowMs, laju aktif /s, simpangan baku aktif, deadband catat, heartbeat ms
+// (kanal stabil dibaca jarang dan hanya dicatat jika berubah > deadband, lihat include/AdaptiveSampling.h)
+
+/// @brief sumber suhu air untuk kompensasi DO kanal "oks". Program pemakai
+/// mengarahkannya ke nilai kanal suhu ChannelBank-nya; nullptr = suhuFallback.
+inline const float *&oksigenSuhuSource()
+{
+  static const float *source = nullptr;
+  return source;
+}
+
+/// @brief konversi kanal "oks": DO (mg/L) dari tegangan probe, dikompensasi suhu lewat DO_Table
+inline float oksigenFromProbe(float voltage)
+{
+  const float *suhu = oksigenSuhuSource();
+  return oksigenFromVoltage(voltage, suhu ? *suhu : suhuFallback, doCalibration);
+}
+
+const int channelCount = 4;
+constexpr ChannelTable<channelCount> channels = {{
+    // key, label LCD, desimal, sumber, pin/input, konversi, threshold awal, health, sampling
+    {"ph", "pH", 2, SRC_INTERNAL_ADC, PIN_PH, phFromVoltage, {6.5f, 8.5f},
+     {0.0f, 14.0f, 2.0f, 8, 4087, 200, 0.0f, 100, 0.5f, 40},
+     {1, 250, 0.05f, 0.03f, 0.02f, 10000}},
+    {"turb", "Tb", 1, SRC_INTERNAL_ADC, PIN_TURBIDITY, turbidityFromVoltage, {20.0f, 70.0f},
+     {0.0f, 100.0f, 50.0f, 8, 4087, 200, 0.0f, 100, 15.0f, 40},
+     {1, 250, 2.0f, 1.0f, 0.5f, 10000}},
+    {"oks", "O", 1, SRC_INTERNAL_ADC, PIN_OKSIGEN, oksigenFromProbe, {5.0f, 14.0f},
+     {0.0f, 20.0f, 2.0f, 8, 4087, 200, 0.0f, 100, 2.0f, 40},
+     {1, 1000, 0.05f, 0.05f, 0.05f, 10000}},
+    // DS18B20: 85 °C = reset error -> FAULT_RANGE; permintaan baca ikut jarang saat stabil
+    {"suhu", "C", 2, SRC_EXTERNAL, PIN_SUHU, nullptr, {20.0f, 30.0f},
+     {0.0f, 45.0f, 2.0f, -1, 0, 0, 0.0f, 0, 0.0f, 3},
+     {800, 8000, 0.02f, 0.1f, 0.1f, 30000}},
+    // Contoh probe pH kedua di AIN0 ADS1115 (ADS1115_ENABLED 1, channelCount 5):
+    // {"ph2", "pH2", 2, SRC_ADS1115, 0, phFromVoltage, {6.5f, 8.5f},
+    //  {0.0f, 14.0f, 2.0f, 8, 32760, 200, 0.0f, 100, 0.5f, 40},
+    //  {1, 250, 0.05f, 0.03f, 0.02f, 10000}},
+}};
+static_assert(channels.valid(), "tabel channels: baris kosong, key ganda atau konversi hilang");
+
+constexpr int CHI_PH = channels.indexOf("ph");
+constexpr int CHI_TURB = channels.indexOf("turb");
+constexpr int CHI_OKS = channels.indexOf("oks");
+constexpr int CHI_SUHU = channels.indexOf("suhu");
+static_assert(CHI_PH >= 0 && CHI_TURB >= 0 && CHI_OKS >= 0 && CHI_SUHU >= 0, "kanal kontrol wajib ada");
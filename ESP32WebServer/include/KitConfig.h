@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "DoTrend.h"
+#include "PhDosing.h"
+#include "SensorConversion.h"
+
+// Konfigurasi kit: pin, kalibrasi, periode job kontrol dan tuning kontroler
+// (tabel kanal di KitChannels.h). Dipakai bersama oleh firmware (src/main.cpp)
+// dan simulasi host (tools/replay, tools/bench, tools/mqtt), jadi mengubah nilai di sini
+// langsung ikut diuji oleh `make check` tanpa menyalin angka ke tiap alat.
+
+#define TWO_POINT_CALIBRATION 1 // 0 = single point, 1 = two point
+// Single point calibration needs to be filled CAL1_V and CAL1_T
+#define CAL1_V (1100) // mv
+#define CAL1_T (34)   // ℃
+// Two-point calibration needs to be filled CAL2_V and CAL2_T
+// CAL1 High temperature point, CAL2 Low temperature point
+#define CAL2_V (650) // mv
+#define CAL2_T (23)  // ℃
+
+// Pin definitions
+#define PIN_PH 32
+#define PIN_TURBIDITY 33
+#define PIN_OKSIGEN 34
+#define PIN_POTENSIO 35
+#define PIN_SUHU 23
+#define PIN_RELAY_1 14
+#define PIN_RELAY_2 27
+#define PIN_RELAY_3 26
+#define PIN_RELAY_4 25
+#define PIN_RELAY_5 19
+#define PIN_ADS_RDY 18 // ALERT/RDY ADS1115 pertama (conversion ready)
+
+const DoCalibration doCalibration = {TWO_POINT_CALIBRATION, CAL1_V, CAL1_T, CAL2_V, CAL2_T};
+const float suhuFallback = 25.0f; // kompensasi DO jika DS18B20 belum pernah terbaca
+
+// Periode job kontrol (scheduleJobs() di firmware, jam simulasi di tools/replay)
+const long tempRequestInterval = 800;   // Minta suhu setiap 750 ms
+const uint32_t autoIntervalMs = 10;     // periode autoRelayLogic()
+const uint32_t logIntervalMs = 50;      // periode pencatatan riwayat & health check
+const uint32_t turbidityCycleMs = 5000; // pompa on/off bergantian saat kekeruhan di dalam band
+
+// MQTT store-and-forward (include/MqttForwarder.h, broker tiruan di tools/mqtt)
+const uint32_t mqttSampleInterval = 1000;   // satu sampel per detik masuk ke batch
+const int mqttBatchSize = 10;               // satu pesan per 10 sampel
+const int mqttDrainPerSecond = 5;           // laju kirim ulang antrian setelah reconnect
+const size_t mqttSpoolMaxBytes = 64 * 1024; // batas file antrian di SPIFFS
+const size_t mqttQueueSlots = 16;           // slot antrian RAM sebelum pindah ke spool
+
+// ===== Kontroler =====
+// Prediksi tren DO untuk aerator (relay4): sampel tiap 10 s (job "doTrend"),
+// window 5 menit, aerator dinyalakan lebih awal jika DO diprediksi < min dalam 20 menit.
+// sampleIntervalMs, minSamples, minR2, leadSec, releaseMargin
+const DoTrendConfig doTrendConfig = {10000, 12, 0.6f, 1200.0f, 0.5f};
+
+// Dosing pH (relay1 basa, relay2 asam): koreksi dimulai setelah pH keluar band dalam
+// (70% setengah lebar band dari tengah) dan selesai deadband di dalamnya.
+// Gain dan batas diuji dengan tools/replay/ph_dosing_sim (model tangki).
+// kp, ki, kd, deadband, engage, sampleMs, windowMs, minPulseMs, deadTimeMs, reverseLockMs, maxDoseMsPerHour
+const PhDosingConfig phDosingConfig = {0.6f, 0.002f, 0.0f, 0.1f, 0.7f, 1000, 10000, 500, 60000, 600000, 120000};
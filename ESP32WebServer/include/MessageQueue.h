@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Antrian pesan berukuran tetap (ring buffer) untuk store-and-forward MQTT.
+// Tidak ada alokasi dinamis: semua slot dialokasikan saat objek dibuat.
+// Jika penuh, push() mengembalikan slot tertua lewat `evicted` supaya
+// pemanggil bisa memindahkannya ke flash sebelum ditimpa.
+template <size_t Slots, size_t TopicLen, size_t PayloadLen>
+class MessageQueue
+{
+public:
+  struct Message
+  {
+    char topic[TopicLen];
+    char payload[PayloadLen];
+    uint16_t length;
+  };
+
+  MessageQueue() : head(0), count(0) {}
+
+  /// @brief tambahkan pesan ke antrian
+  /// @param evicted diisi pesan tertua jika antrian penuh (boleh nullptr)
+  /// @return false jika pesan terlalu panjang untuk satu slot
+  bool push(const char *topic, const char *payload, size_t length, Message *evicted = nullptr, bool *didEvict = nullptr)
+  {
+    if (didEvict)
+      *didEvict = false;
+    if (strlen(topic) >= TopicLen || length > PayloadLen)
+      return false;
+
+    if (count == Slots)
+    {
+      if (evicted)
+        *evicted = slots[head];
+      if (didEvict)
+        *didEvict = true;
+      head = (head + 1) % Slots;
+      count--;
+    }
+
+    Message &m = slots[(head + count) % Slots];
+    strcpy(m.topic, topic);
+    memcpy(m.payload, payload, length);
+    m.length = (uint16_t)length;
+    count++;
+    return true;
+  }
+
+  /// @brief pesan tertua tanpa menghapusnya (nullptr jika kosong)
+  const Message *front() const
+  {
+    return count ? &slots[head] : nullptr;
+  }
+
+  void pop()
+  {
+    if (!count)
+      return;
+    head = (head + 1) % Slots;
+    count--;
+  }
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  static constexpr size_t capacity() { return Slots; }
+
+private:
+  Message slots[Slots];
+  size_t head;
+  size_t count;
+};
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Inti Modbus TCP slave tanpa ketergantungan jaringan, dipakai firmware
+// (WiFiServer port 502) dan alat uji host (tools/modbus).
+//
+// Nilai dibaca dari register image yang diisi pemanggil sekali per tick
+// kontrol. Register disimpan sudah dalam urutan byte jaringan, sehingga
+// respons baca register cukup memcpy. Penulisan diteruskan ke callback yang
+// memvalidasi dan menerapkan nilai; hasilnya dikembalikan sebagai kode
+// exception Modbus.
+
+enum ModbusException : uint8_t
+{
+  MB_OK = 0x00,
+  MB_ILLEGAL_FUNCTION = 0x01,
+  MB_ILLEGAL_ADDRESS = 0x02,
+  MB_ILLEGAL_VALUE = 0x03,
+  MB_DEVICE_FAILURE = 0x04,
+  MB_BUSY = 0x06,
+};
+
+enum ModbusFunction : uint8_t
+{
+  MB_READ_COILS = 0x01,
+  MB_READ_DISCRETE = 0x02,
+  MB_READ_HOLDING = 0x03,
+  MB_READ_INPUT = 0x04,
+  MB_WRITE_COIL = 0x05,
+  MB_WRITE_REGISTER = 0x06,
+  MB_WRITE_COILS = 0x0F,
+  MB_WRITE_REGISTERS = 0x10,
+};
+
+// Ukuran maksimum ADU Modbus TCP (MBAP 7 byte + PDU 253 byte)
+const size_t modbusMaxAdu = 260;
+
+struct ModbusHandlers
+{
+  /// @brief tulis coil [first, first + count); bit k di values (LSB dulu) = coil first + k
+  uint8_t (*writeCoils)(uint16_t first, uint16_t count, const uint8_t *values);
+  /// @brief tulis holding register [first, first + count); nilai sudah urutan host
+  uint8_t (*writeRegisters)(uint16_t first, uint16_t count, const uint16_t *values);
+};
+
+template <int Inputs, int Holdings, int Coils, int Discretes>
+class ModbusSlave
+{
+public:
+  explicit ModbusSlave(const ModbusHandlers &h) : handlers(h) {}
+
+  // ===== Register image =====
+  void setInput(int i, uint16_t v) { put(input, i, v); }
+  void setHolding(int i, uint16_t v) { put(holding, i, v); }
+  void setCoil(int i, bool on) { setBit(coils, i, on); }
+  void setDiscrete(int i, bool on) { setBit(discrete, i, on); }
+
+  uint32_t requestCount() const { return requests; }
+  uint32_t exceptionCount() const { return exceptions; }
+
+  /// @brief panjang ADU lengkap pertama di buf
+  /// @return 0 jika belum lengkap, -1 jika header tidak valid (putuskan koneksi)
+  static int frameLength(const uint8_t *buf, size_t len)
+  {
+    if (len < 7)
+      return 0;
+    uint16_t protocol = (uint16_t)(buf[2] << 8 | buf[3]);
+    uint16_t length = (uint16_t)(buf[4] << 8 | buf[5]); // unit id + PDU
+    if (protocol != 0 || length < 2 || length > modbusMaxAdu - 6)
+      return -1;
+    return len >= (size_t)(6 + length) ? 6 + length : 0;
+  }
+
+  /// @brief proses satu ADU lengkap (panjang dari frameLength())
+  /// @param resp buffer minimal modbusMaxAdu byte
+  /// @return panjang respons
+  size_t handle(const uint8_t *req, size_t len, uint8_t *resp)
+  {
+    requests++;
+    const uint8_t *pdu = req + 7;
+    size_t pduLen = len - 7;
+    memcpy(resp, req, 7); // transaction id, protocol, unit id diulang
+    uint8_t *out = resp + 7;
+    size_t outLen = 0;
+    uint8_t ex = process(pdu, pduLen, out, outLen);
+    if (ex != MB_OK)
+    {
+      exceptions++;
+      out[0] = pdu[0] | 0x80;
+      out[1] = ex;
+      outLen = 2;
+    }
+    resp[4] = (uint8_t)((outLen + 1) >> 8);
+    resp[5] = (uint8_t)(outLen + 1);
+    return 7 + outLen;
+  }
+
+private:
+  static uint16_t get16(const uint8_t *p) { return (uint16_t)(p[0] << 8 | p[1]); }
+
+  static void put(uint8_t *regs, int i, uint16_t v)
+  {
+    regs[2 * i] = (uint8_t)(v >> 8);
+    regs[2 * i + 1] = (uint8_t)v;
+  }
+
+  static bool getBit(const uint8_t *bits, int i) { return bits[i >> 3] & (1 << (i & 7)); }
+
+  static void setBit(uint8_t *bits, int i, bool on)
+  {
+    if (on)
+      bits[i >> 3] |= (uint8_t)(1 << (i & 7));
+    else
+      bits[i >> 3] &= (uint8_t)~(1 << (i & 7));
+  }
+
+  static bool inRange(uint16_t first, uint16_t count, int size)
+  {
+    return (uint32_t)first + count <= (uint32_t)size;
+  }
+
+  uint8_t readBits(const uint8_t *bits, int size, const uint8_t *pdu, size_t len, uint8_t *out, size_t &outLen)
+  {
+    if (len != 5)
+      return MB_ILLEGAL_VALUE;
+    uint16_t first = get16(pdu + 1), count = get16(pdu + 3);
+    if (count < 1 || count > 2000)
+      return MB_ILLEGAL_VALUE;
+    if (!inRange(first, count, size))
+      return MB_ILLEGAL_ADDRESS;
+    uint8_t bytes = (uint8_t)((count + 7) / 8);
+    out[0] = pdu[0];
+    out[1] = bytes;
+    memset(out + 2, 0, bytes);
+    for (uint16_t k = 0; k < count; k++)
+      if (getBit(bits, first + k))
+        out[2 + (k >> 3)] |= (uint8_t)(1 << (k & 7));
+    outLen = 2 + bytes;
+    return MB_OK;
+  }
+
+  uint8_t readRegisters(const uint8_t *regs, int size, const uint8_t *pdu, size_t len, uint8_t *out, size_t &outLen)
+  {
+    if (len != 5)
+      return MB_ILLEGAL_VALUE;
+    uint16_t first = get16(pdu + 1), count = get16(pdu + 3);
+    if (count < 1 || count > 125)
+      return MB_ILLEGAL_VALUE;
+    if (!inRange(first, count, size))
+      return MB_ILLEGAL_ADDRESS;
+    out[0] = pdu[0];
+    out[1] = (uint8_t)(count * 2);
+    memcpy(out + 2, regs + 2 * first, count * 2);
+    outLen = 2 + count * 2;
+    return MB_OK;
+  }
+
+  uint8_t writeRegisters(uint16_t first, uint16_t count, const uint16_t *values)
+  {
+    if (!inRange(first, count, Holdings))
+      return MB_ILLEGAL_ADDRESS;
+    uint8_t ex = handlers.writeRegisters ? handlers.writeRegisters(first, count, values) : (uint8_t)MB_ILLEGAL_FUNCTION;
+    if (ex == MB_OK)
+      for (uint16_t k = 0; k < count; k++)
+        setHolding(first + k, values[k]); // baca berikutnya langsung melihat nilai baru
+    return ex;
+  }
+
+  uint8_t writeCoils(uint16_t first, uint16_t count, const uint8_t *values)
+  {
+    if (!inRange(first, count, Coils))
+      return MB_ILLEGAL_ADDRESS;
+    return handlers.writeCoils ? handlers.writeCoils(first, count, values) : (uint8_t)MB_ILLEGAL_FUNCTION;
+  }
+
+  uint8_t process(const uint8_t *pdu, size_t len, uint8_t *out, size_t &outLen)
+  {
+    switch (pdu[0])
+    {
+    case MB_READ_COILS:
+      return readBits(coils, Coils, pdu, len, out, outLen);
+    case MB_READ_DISCRETE:
+      return readBits(discrete, Discretes, pdu, len, out, outLen);
+    case MB_READ_HOLDING:
+      return readRegisters(holding, Holdings, pdu, len, out, outLen);
+    case MB_READ_INPUT:
+      return readRegisters(input, Inputs, pdu, len, out, outLen);
+
+    case MB_WRITE_COIL:
+    {
+      if (len != 5)
+        return MB_ILLEGAL_VALUE;
+      uint16_t value = get16(pdu + 3);
+      if (value != 0xFF00 && value != 0x0000)
+        return MB_ILLEGAL_VALUE;
+      uint8_t bit = value ? 1 : 0;
+      uint8_t ex = writeCoils(get16(pdu + 1), 1, &bit);
+      if (ex == MB_OK)
+      {
+        memcpy(out, pdu, 5); // respons = echo permintaan
+        outLen = 5;
+      }
+      return ex;
+    }
+
+    case MB_WRITE_REGISTER:
+    {
+      if (len != 5)
+        return MB_ILLEGAL_VALUE;
+      uint16_t value = get16(pdu + 3);
+      uint8_t ex = writeRegisters(get16(pdu + 1), 1, &value);
+      if (ex == MB_OK)
+      {
+        memcpy(out, pdu, 5);
+        outLen = 5;
+      }
+      return ex;
+    }
+
+    case MB_WRITE_COILS:
+    {
+      if (len < 6)
+        return MB_ILLEGAL_VALUE;
+      uint16_t first = get16(pdu + 1), count = get16(pdu + 3);
+      if (count < 1 || count > 1968 || pdu[5] != (count + 7) / 8 || len != 6u + pdu[5])
+        return MB_ILLEGAL_VALUE;
+      uint8_t ex = writeCoils(first, count, pdu + 6);
+      if (ex == MB_OK)
+      {
+        memcpy(out, pdu, 5);
+        outLen = 5;
+      }
+      return ex;
+    }
+
+    case MB_WRITE_REGISTERS:
+    {
+      if (len < 6)
+        return MB_ILLEGAL_VALUE;
+      uint16_t first = get16(pdu + 1), count = get16(pdu + 3);
+      if (count < 1 || count > 123 || pdu[5] != count * 2 || len != 6u + pdu[5])
+        return MB_ILLEGAL_VALUE;
+      uint16_t values[123];
+      for (uint16_t k = 0; k < count; k++)
+        values[k] = get16(pdu + 6 + 2 * k);
+      uint8_t ex = writeRegisters(first, count, values);
+      if (ex == MB_OK)
+      {
+        memcpy(out, pdu, 5);
+        outLen = 5;
+      }
+      return ex;
+    }
+
+    default:
+      return MB_ILLEGAL_FUNCTION;
+    }
+  }
+
+  const ModbusHandlers handlers;
+  uint8_t input[Inputs * 2] = {};
+  uint8_t holding[Holdings * 2] = {};
+  uint8_t coils[(Coils + 7) / 8] = {};
+  uint8_t discrete[(Discretes + 7) / 8] = {};
+  uint32_t requests = 0;
+  uint32_t exceptions = 0;
+};
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <limits.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "ChannelRegistry.h"
+#include "MessageQueue.h"
+#include "StatusJson.h"
+
+// Store-and-forward MQTT tanpa ketergantungan ke PubSubClient atau SPIFFS,
+// sehingga bisa diuji di host (tools/mqtt) dengan broker tiruan.
+//
+// Sampel dikumpulkan per BatchSize lalu dikirim sebagai satu pesan <prefix>/data:
+//   {"t0":<ms>,"dt":<ms>,"ph":[...],"turb":[...],...}
+// Saat broker tidak terjangkau, pesan menumpuk di antrian RAM; jika penuh,
+// pesan tertua dipindah ke spool (file baris "topic\tpayload\n"). drain()
+// mengirim spool lebih dulu (urutan tetap), lalu RAM, maksimal drainPerSecond
+// pesan per jendela (newWindow() dipanggil setiap detik). Firmware memanggil
+// drain() dengan limit 1 dari setiap loop(), sehingga satu putaran paling banyak
+// membaca satu baris spool dan mengirim satu pesan (batas waktu watchdog).
+//
+// Spool adalah kelas dengan:
+//   size_t size()                                   ukuran file, 0 jika tidak ada
+//   bool append(const char *data, size_t len)       tambahkan satu baris utuh
+//   int readLine(size_t offset, char *buf, size_t n) isi baris mulai offset tanpa '\n',
+//                                                   -1 jika offset di akhir file
+//   void remove()
+// Publish untuk drain(): bool publish(const char *topic, const uint8_t *payload, size_t len)
+
+/// @brief panjang maksimum payload satu batch: {"t0":..,"dt":..} lalu per kanal
+/// ,"<key>":[...] berisi BatchSize nilai %.2f (maks 8 karakter dengan koma)
+constexpr size_t mqttBatchPayloadLen(int channels, int batchSize)
+{
+  return 64 + channels * (16 + batchSize * 8);
+}
+
+// PayloadLen mengikuti jumlah kanal dan BatchSize, jadi kanal baru di tabel
+// tidak membuat setiap pesan data ditolak antrian (dan hanya menaikkan dropped)
+template <int Channels, int BatchSize, class Spool, size_t Slots = 16, size_t TopicLen = 48,
+          size_t PayloadLen = mqttBatchPayloadLen(Channels, BatchSize)>
+class MqttForwarder
+{
+  static_assert(mqttBatchPayloadLen(Channels, BatchSize) <= PayloadLen,
+                "PayloadLen lebih kecil dari satu batch: semua pesan data akan dibuang");
+
+public:
+  typedef MessageQueue<Slots, TopicLen, PayloadLen> Queue;
+
+  /// @brief ukuran buffer paket klien MQTT untuk pesan terbesar
+  /// (header tetap 5 byte + panjang topic 2 byte + topic + payload)
+  static const size_t maxPacketLen = 5 + 2 + TopicLen + PayloadLen;
+
+  MqttForwarder(const ChannelTable<Channels> &table, Spool &spool, const char *prefix,
+                uint32_t sampleIntervalMs, int drainPerSecond, size_t spoolMaxBytes)
+      : table(table), spool(spool), prefix(prefix), sampleIntervalMs(sampleIntervalMs),
+        drainPerSecond(drainPerSecond), spoolMaxBytes(spoolMaxBytes)
+  {
+  }
+
+  /// @brief lanjutkan spool sisa dari sebelum reboot
+  void begin()
+  {
+    spoolPending = spool.size() > 0;
+    spoolOffset = 0;
+  }
+
+  /// @brief satu sampel semua kanal; batch penuh langsung masuk antrian.
+  /// Dipanggil walaupun broker putus, supaya data tetap tersimpan.
+  void sample(uint32_t now, const float *values)
+  {
+    if (batchCount == 0)
+      batchT0 = now;
+    memcpy(batch[batchCount], values, sizeof(batch[0]));
+    if (++batchCount >= BatchSize)
+      flushBatch();
+  }
+
+  void enqueue(const char *subtopic, const char *payload, size_t length)
+  {
+    char topic[TopicLen];
+    snprintf(topic, sizeof(topic), "%s/%s", prefix, subtopic);
+
+    bool didEvict = false;
+    if (!queue.push(topic, payload, length, &evicted, &didEvict))
+    {
+      dropped++;
+      return;
+    }
+    if (didEvict)
+      spoolWrite(evicted);
+  }
+
+  /// @brief mulai jendela laju drain baru (setiap detik)
+  void newWindow() { drainedInWindow = 0; }
+
+  /// @brief kirim antrian selama kuota jendela masih ada; berhenti pada publish gagal
+  /// @param limit maksimal pesan pada panggilan ini
+  /// @return jumlah pesan terkirim
+  template <class Publish>
+  int drain(Publish publish, int limit = INT_MAX)
+  {
+    int sent = 0;
+    while (drainedInWindow < drainPerSecond && sent < limit)
+    {
+      int r = drainSpool(publish);
+      if (r < 0)
+        break;
+      if (r == 0)
+      {
+        const typename Queue::Message *m = queue.front();
+        if (!m || !publish(m->topic, (const uint8_t *)m->payload, m->length))
+          break;
+        queue.pop();
+      }
+      drainedInWindow++;
+      sent++;
+    }
+    return sent;
+  }
+
+  size_t queued() const { return queue.size(); }
+  bool spoolPendingNow() const { return spoolPending; }
+  uint32_t droppedCount() const { return dropped; }
+
+private:
+  void flushBatch()
+  {
+    char payload[mqttBatchPayloadLen(Channels, BatchSize)];
+    size_t len = 0;
+    bool ok = appendf(payload, sizeof(payload), len, "{\"t0\":%lu,\"dt\":%lu",
+                      (unsigned long)batchT0, (unsigned long)sampleIntervalMs);
+    for (int ch = 0; ok && ch < Channels; ch++)
+    {
+      ok = appendf(payload, sizeof(payload), len, ",\"%s\":[", table[ch].key);
+      for (int i = 0; ok && i < batchCount; i++)
+        ok = appendf(payload, sizeof(payload), len, i ? ",%.2f" : "%.2f", batch[i][ch]);
+      ok = ok && appendf(payload, sizeof(payload), len, "]");
+    }
+    if (ok && appendf(payload, sizeof(payload), len, "}"))
+      enqueue("data", payload, len);
+    batchCount = 0;
+  }
+
+  void spoolWrite(const typename Queue::Message &m)
+  {
+    size_t topicLen = strlen(m.topic);
+    size_t n = topicLen + 1 + m.length + 1;
+    if (spool.size() + n > spoolMaxBytes)
+    {
+      dropped++;
+      return;
+    }
+    memcpy(line, m.topic, topicLen);
+    line[topicLen] = '\t';
+    memcpy(line + topicLen + 1, m.payload, m.length);
+    line[n - 1] = '\n';
+    if (!spool.append(line, n))
+    {
+      dropped++;
+      return;
+    }
+    spoolPending = true;
+  }
+
+  /// @brief kirim maksimal satu baris spool
+  /// @return 1 terkirim, 0 spool kosong, -1 publish gagal (offset tidak maju)
+  template <class Publish>
+  int drainSpool(Publish &publish)
+  {
+    if (!spoolPending)
+      return 0;
+    int n = spool.readLine(spoolOffset, line, sizeof(line) - 1);
+    if (n < 0)
+    {
+      spool.remove();
+      spoolOffset = 0;
+      spoolPending = false;
+      return 0;
+    }
+    line[n] = '\0';
+
+    char *tab = strchr(line, '\t');
+    if (tab)
+    {
+      *tab = '\0';
+      if (!publish(line, (const uint8_t *)(tab + 1), n - (tab + 1 - line)))
+        return -1;
+    }
+    spoolOffset += n + 1;
+    return 1;
+  }
+
+  const ChannelTable<Channels> &table;
+  Spool &spool;
+  const char *prefix;
+  const uint32_t sampleIntervalMs;
+  const int drainPerSecond;
+  const size_t spoolMaxBytes;
+
+  Queue queue;
+  typename Queue::Message evicted;
+  char line[TopicLen + PayloadLen + 2];
+  bool spoolPending = false; // ada isi spool yang belum terkirim
+  size_t spoolOffset = 0;    // posisi baca spool (byte)
+  uint32_t dropped = 0;      // pesan dibuang karena terlalu panjang atau spool penuh
+
+  float batch[BatchSize][Channels];
+  uint32_t batchT0 = 0;
+  int batchCount = 0;
+  int drainedInWindow = 0;
+};
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+// Kontrol dosing pH: PI(D) dengan keluaran time-proportional ke dua relay
+// pompa dosing (relay1 = basa/pH naik, relay2 = asam/pH turun).
+//
+// - Dosing hanya dimulai jika pH keluar dari band dalam (tengah band +-
+//   engage x setengah lebar band) dan berhenti setelah pH kembali deadband ke
+//   dalamnya. Air yang tetap di band dalam tidak pernah didosing; pH tidak
+//   dipaksa ke tengah band, sehingga ayunan harian tidak dibalas dosis.
+// - Besar koreksi tetap dihitung dari error terhadap tengah band.
+// - PID dievaluasi dengan periode tetap sampleMs dari nilai pH terfilter.
+//   Keluaran u (-1..1) adalah fraksi window: u > 0 dosing basa, u < 0 asam.
+// - Setiap window (windowMs) relay nyala |u| * windowMs lalu mati. Pulsa di
+//   bawah minPulseMs dilewati supaya relay/pompa tidak dihentak.
+// - Setelah pulsa, dosing ditahan deadTimeMs (waktu pencampuran) dan integral
+//   dibekukan, karena pH belum merespons dosis yang baru masuk.
+// - Anti-windup: integral dibatasi -1..1 dan tidak diakumulasi saat keluaran
+//   jenuh ke arah error yang sama.
+// - Arah berlawanan dikunci reverseLockMs setelah pulsa terakhir, supaya
+//   overshoot kecil tidak langsung dibalas dosis asam setelah basa (dan
+//   sebaliknya) sebelum tangki tenang.
+// - Total waktu nyala per relay dalam 60 menit terakhir dibatasi
+//   maxDoseMsPerHour (ember per menit), tidak ikut di-reset.
+
+struct PhDosingConfig
+{
+  float kp;                  // fraksi window per pH error
+  float ki;                  // fraksi window per (pH error x detik)
+  float kd;                  // fraksi window per (pH / detik), derivatif dari pengukuran
+  float deadband;            // pH, koreksi selesai setelah sejauh ini di dalam band dalam
+  float engage;              // band dalam = tengah +- engage x setengah lebar band (0..1)
+  uint32_t sampleMs;         // periode evaluasi PID
+  uint32_t windowMs;         // panjang window time-proportional
+  uint32_t minPulseMs;       // pulsa lebih pendek dilewati
+  uint32_t deadTimeMs;       // jeda pencampuran setelah pulsa
+  uint32_t reverseLockMs;    // arah berlawanan dikunci selama ini setelah pulsa
+  uint32_t maxDoseMsPerHour; // batas waktu nyala per relay dalam 60 menit
+};
+
+enum PhDoseRelay : uint8_t
+{
+  PH_DOSE_BASE = 1 << 0, // relay1: pH naik
+  PH_DOSE_ACID = 1 << 1, // relay2: pH turun
+};
+
+class PhDosing
+{
+public:
+  explicit PhDosing(const PhDosingConfig &config) : cfg(config) {}
+
+  /// @brief satu langkah kontrol; panggil sesering mungkin (mis. tiap job "auto")
+  /// @param ph pH terfilter, NaN jika sensor tidak valid (dosing berhenti)
+  /// @param bandMin, bandMax band threshold pH; target = tengah band
+  /// @return bitmask PhDoseRelay yang harus nyala
+  uint8_t update(uint32_t nowMs, float ph, float bandMin, float bandMax)
+  {
+    rollBuckets(nowMs);
+    // Celah panjang (mode manual, sensor rusak): mulai ulang tanpa membawa state lama
+    if (started && nowMs - lastUpdateMs > cfg.sampleMs)
+      reset(lastUpdateMs);
+    if (isnan(ph))
+    {
+      reset(nowMs);
+      return 0;
+    }
+    if (!started)
+    {
+      started = true;
+      nextSampleMs = nowMs;
+      nextWindowMs = nowMs;
+      prevPh = ph;
+    }
+    lastUpdateMs = nowMs;
+
+    if ((int32_t)(nowMs - nextSampleMs) >= 0)
+    {
+      pidStep(ph, (bandMin + bandMax) * 0.5f, cfg.engage * (bandMax - bandMin) * 0.5f);
+      nextSampleMs += cfg.sampleMs;
+      if ((int32_t)(nowMs - nextSampleMs) >= 0)
+        nextSampleMs = nowMs + cfg.sampleMs; // tertinggal: jangan mengejar
+    }
+
+    if (pulseDir && nowMs - pulseStartMs >= pulseMs)
+    {
+      endPulse(nowMs);
+      nextWindowMs = nowMs + cfg.deadTimeMs;
+    }
+    if (!pulseDir && (int32_t)(nowMs - nextWindowMs) >= 0)
+      startWindow(nowMs);
+    return pulseDir;
+  }
+
+  /// @brief hentikan pulsa dan kosongkan state PID; riwayat dosis tetap
+  void reset(uint32_t nowMs)
+  {
+    if (pulseDir)
+      endPulse(nowMs);
+    started = false;
+    correcting = false;
+    integral = 0;
+    u = 0;
+  }
+
+  float output() const { return u; }
+  bool active() const { return correcting; }
+  bool mixing(uint32_t nowMs) const { return !pulseDir && started && (int32_t)(nowMs - nextWindowMs) < 0; }
+
+  /// @brief total waktu nyala relay (PH_DOSE_BASE/PH_DOSE_ACID) dalam 60 menit terakhir
+  uint32_t dosedLastHourMs(uint8_t relay) const
+  {
+    const uint16_t *b = relay == PH_DOSE_ACID ? acidBuckets : baseBuckets;
+    uint32_t sum = 0;
+    for (int i = 0; i < 60; i++)
+      sum += b[i];
+    return sum;
+  }
+
+private:
+  void pidStep(float ph, float setpoint, float engageError)
+  {
+    const float dt = cfg.sampleMs * 0.001f;
+    float e = setpoint - ph;
+    float d = -(ph - prevPh) / dt;
+    prevPh = ph;
+    float engageAt = engageError > cfg.deadband ? engageError : cfg.deadband;
+    float releaseAt = engageAt - cfg.deadband > cfg.deadband ? engageAt - cfg.deadband : cfg.deadband;
+    if (!correcting && fabsf(e) > engageAt)
+    {
+      correcting = true;
+      if (integral * e < 0)
+        integral = 0; // sisa koreksi arah sebaliknya tidak dibawa
+    }
+    else if (correcting && fabsf(e) < releaseAt)
+      correcting = false;
+    if (!correcting)
+    {
+      u = 0; // di band dalam: tidak dosing, integral ditahan
+      return;
+    }
+    // Dosis yang belum tercampur belum terlihat di pH: jangan akumulasi
+    bool hold = pulseDir || (int32_t)(lastUpdateMs - nextWindowMs) < 0;
+    float p = cfg.kp * e;
+    float next = integral;
+    if (!hold)
+      next = clamp(integral + cfg.ki * e * dt);
+    float out = p + next + cfg.kd * d;
+    // Anti-windup: tolak akumulasi yang mendorong keluaran lebih jauh ke saturasi
+    if ((out > 1 && e > 0) || (out < -1 && e < 0))
+      out = p + integral + cfg.kd * d;
+    else
+      integral = next;
+    u = clamp(out);
+  }
+
+  void startWindow(uint32_t nowMs)
+  {
+    nextWindowMs = nowMs + cfg.windowMs;
+    uint8_t dir = u > 0 ? PH_DOSE_BASE : (u < 0 ? PH_DOSE_ACID : 0);
+    if (!dir)
+      return;
+    if (lastDir && dir != lastDir && nowMs - lastPulseEndMs < cfg.reverseLockMs)
+      return; // tangki belum tenang dari dosis arah sebaliknya
+    uint32_t want = (uint32_t)(fabsf(u) * cfg.windowMs);
+    uint32_t used = dosedLastHourMs(dir);
+    uint32_t room = used < cfg.maxDoseMsPerHour ? cfg.maxDoseMsPerHour - used : 0;
+    if (want > room)
+      want = room;
+    if (want < cfg.minPulseMs)
+      return;
+    pulseDir = dir;
+    pulseStartMs = nowMs;
+    pulseMs = want;
+  }
+
+  void endPulse(uint32_t nowMs)
+  {
+    uint32_t on = nowMs - pulseStartMs;
+    if (on > pulseMs)
+      on = pulseMs;
+    uint16_t &b = (pulseDir == PH_DOSE_ACID ? acidBuckets : baseBuckets)[bucketMinute % 60];
+    b = on > 0xFFFFu - b ? 0xFFFF : b + on;
+    lastDir = pulseDir;
+    lastPulseEndMs = nowMs;
+    pulseDir = 0;
+  }
+
+  // Ember per menit untuk jendela 60 menit bergulir
+  void rollBuckets(uint32_t nowMs)
+  {
+    uint32_t minute = nowMs / 60000;
+    if (!bucketsValid)
+    {
+      bucketsValid = true;
+      bucketMinute = minute;
+      return;
+    }
+    for (int i = 0; i < 60 && bucketMinute != minute; i++)
+    {
+      bucketMinute++;
+      acidBuckets[bucketMinute % 60] = 0;
+      baseBuckets[bucketMinute % 60] = 0;
+    }
+    bucketMinute = minute;
+  }
+
+  static float clamp(float v) { return v > 1 ? 1 : (v < -1 ? -1 : v); }
+
+  const PhDosingConfig cfg;
+  bool started = false;
+  uint32_t lastUpdateMs = 0;
+  uint32_t nextSampleMs = 0;
+  uint32_t nextWindowMs = 0;
+  float prevPh = 0;
+  float integral = 0;
+  float u = 0;
+  bool correcting = false; // pH keluar band dalam, belum kembali sejauh deadband
+
+  uint8_t pulseDir = 0; // PhDoseRelay yang sedang nyala, 0 = tidak ada
+  uint32_t pulseStartMs = 0;
+  uint32_t pulseMs = 0;
+  uint8_t lastDir = 0; // arah pulsa terakhir, untuk reverseLockMs (tidak ikut di-reset)
+  uint32_t lastPulseEndMs = 0;
+
+  bool bucketsValid = false;
+  uint32_t bucketMinute = 0;
+  uint16_t acidBuckets[60] = {};
+  uint16_t baseBuckets[60] = {};
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdint.h>
+
+// Penjadwal job periodik dan one-shot dengan slot tetap, tanpa alokasi.
+// Deadline phase-locked: deadline berikutnya = deadline sebelumnya + periode
+// (bukan millis() saat job dilayani), sehingga interval tidak drift walaupun
+// loop sesekali terlambat. Jika job terlambat satu periode penuh atau lebih,
+// tick yang terlewat tidak dikejar beruntun melainkan dibuang dan dihitung
+// sebagai overrun. Semua perbandingan waktu aman terhadap wrap millis().
+template <int MaxJobs>
+class Scheduler
+{
+public:
+  typedef void (*JobFn)();
+
+  struct Job
+  {
+    const char *name;
+    JobFn fn;
+    uint32_t period;    // ms, 0 = one-shot
+    uint32_t deadline;  // millis() saat job berikutnya jatuh tempo
+    uint32_t runs;      // jumlah eksekusi
+    uint32_t overruns;  // jumlah tick yang terlewat
+    uint32_t maxLateMs; // keterlambatan terbesar terhadap deadline
+    bool active;
+  };
+
+  static const uint32_t Idle = 0xFFFFFFFFUL; // tidak ada job aktif
+
+  /// @brief daftarkan job periodik
+  /// @param phaseMs offset tick pertama dari nowMs (untuk menyebar job dengan periode sama)
+  /// @return id job, -1 jika slot penuh
+  int every(const char *name, uint32_t periodMs, JobFn fn, uint32_t nowMs, uint32_t phaseMs = 0)
+  {
+    if (periodMs == 0)
+      return -1;
+    return add(name, periodMs, fn, nowMs + phaseMs);
+  }
+
+  /// @brief daftarkan job yang dijalankan sekali setelah delayMs
+  int after(const char *name, uint32_t delayMs, JobFn fn, uint32_t nowMs)
+  {
+    return add(name, 0, fn, nowMs + delayMs);
+  }
+
+  /// @brief ubah periode job periodik. Deadline berikutnya = tick terakhir + periode
+  /// baru; boleh dipanggil dari dalam fn job itu sendiri (mis. laju sampling adaptif).
+  void setPeriod(int id, uint32_t periodMs)
+  {
+    if (id < 0 || id >= MaxJobs || !jobs[id].active || !jobs[id].period || !periodMs)
+      return;
+    jobs[id].deadline += periodMs - jobs[id].period;
+    jobs[id].period = periodMs;
+  }
+
+  void cancel(int id)
+  {
+    if (id >= 0 && id < MaxJobs)
+      jobs[id].active = false;
+  }
+
+  /// @brief jalankan semua job yang jatuh tempo, urut sesuai urutan pendaftaran
+  /// @return ms sampai deadline berikutnya (0 jika ada yang sudah jatuh tempo, Idle jika kosong)
+  uint32_t run(uint32_t nowMs)
+  {
+    if (running)
+      return msUntilNext(nowMs); // dipanggil ulang dari dalam job
+    running = true;
+    for (int i = 0; i < MaxJobs; i++)
+    {
+      Job &j = jobs[i];
+      if (!j.active || (int32_t)(nowMs - j.deadline) < 0)
+        continue;
+
+      uint32_t late = nowMs - j.deadline;
+      if (late > j.maxLateMs)
+        j.maxLateMs = late;
+
+      if (j.period)
+      {
+        uint32_t missed = late / j.period;
+        j.overruns += missed;
+        j.deadline += (missed + 1) * j.period;
+      }
+      else
+        j.active = false; // one-shot boleh mendaftarkan ulang dirinya dari fn
+
+      j.runs++;
+      j.fn();
+    }
+    running = false;
+    return msUntilNext(nowMs);
+  }
+
+  uint32_t msUntilNext(uint32_t nowMs) const
+  {
+    uint32_t best = Idle;
+    for (int i = 0; i < MaxJobs; i++)
+    {
+      if (!jobs[i].active)
+        continue;
+      int32_t d = (int32_t)(jobs[i].deadline - nowMs);
+      uint32_t wait = d > 0 ? (uint32_t)d : 0;
+      if (wait < best)
+        best = wait;
+    }
+    return best;
+  }
+
+  int capacity() const { return MaxJobs; }
+  const Job &job(int id) const { return jobs[id]; }
+
+private:
+  int add(const char *name, uint32_t period, JobFn fn, uint32_t deadline)
+  {
+    for (int i = 0; i < MaxJobs; i++)
+    {
+      if (jobs[i].active)
+        continue;
+      jobs[i] = {name, fn, period, deadline, 0, 0, 0, true};
+      return i;
+    }
+    return -1;
+  }
+
+  Job jobs[MaxJobs] = {};
+  bool running = false;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#include "DoTable.h"
+
+// Konversi tegangan sensor (hasil filter Analog) ke satuan akhir. Dipakai
+// firmware dan replay di host (tools/replay), jadi tanpa akses hardware.
+
+/// @brief pH dari tegangan modul (divider 5 V -> 3.3 V)
+inline float phFromVoltage(float voltage)
+{
+  const float calibration_value = 1.85f;
+  return 3.5 * voltage * (5.0 / 3.3) + calibration_value;
+}
+
+inline float map_float(float x, float in_min, float in_max, float out_min, float out_max)
+{
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+/// @brief kekeruhan 0..100 (%, 100 = paling keruh) dari tegangan modul
+inline float turbidityFromVoltage(float voltage)
+{
+  const float clear_point = 1.53;
+  const float dirty_point = 0.8;
+
+  const float adc_max = 1860;
+  const float adc_min = 960;
+
+  // float ntu = -1120.4*sq(voltage)+5742.3*voltage-4353.8;
+  if (voltage > clear_point)
+    voltage = clear_point;
+  else if (voltage < dirty_point)
+    voltage = dirty_point;
+
+  float ntu = adc_min + ((voltage - dirty_point) / (clear_point - dirty_point) * (adc_max - adc_min));
+  return map_float(ntu, adc_min, adc_max, 100, 0);
+}
+
+// Kalibrasi probe DO (DFRobot). Satu titik: CAL1 saja; dua titik: CAL1 suhu
+// tinggi, CAL2 suhu rendah.
+struct DoCalibration
+{
+  bool twoPoint;
+  uint16_t cal1V; // mV
+  uint8_t cal1T;  // °C
+  uint16_t cal2V; // mV
+  uint8_t cal2T;  // °C
+};
+
+/// @brief DO dalam µg/L
+inline int16_t readDO(uint32_t voltage_mv, uint8_t temperature_c, const DoCalibration &cal)
+{
+  uint16_t V_saturation;
+  if (!cal.twoPoint)
+    V_saturation = (uint32_t)cal.cal1V + (uint32_t)35 * temperature_c - (uint32_t)cal.cal1T * 35;
+  else
+    V_saturation = (int16_t)((int8_t)temperature_c - cal.cal2T) * ((uint16_t)cal.cal1V - cal.cal2V) / ((uint8_t)cal.cal1T - cal.cal2T) + cal.cal2V;
+  return (voltage_mv * DO_Table[temperature_c] / V_saturation);
+}
+
+/// @brief DO (mg/L) dari tegangan probe dan suhu air
+inline float oksigenFromVoltage(float voltage_v, float suhu, const DoCalibration &cal)
+{
+  uint16_t voltage_mv = (uint16_t)(voltage_v * 1000.0);
+  // DO_Table hanya 0..40 °C; jangan sampai indeks keluar tabel
+  float suhuClamped = suhu < 0.0f ? 0.0f : (suhu > 40.0f ? 40.0f : suhu);
+  uint8_t currentTemperature = (uint8_t)round(suhuClamped);
+  return readDO(voltage_mv, currentTemperature, cal) / 1000.0f; // Konversi ke mg/L
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+// Deteksi kerusakan sensor per kanal, O(1) per sampel tanpa alokasi.
+// Dipanggil pada laju sampling tetap (bukan setiap putaran loop) supaya
+// hitungan "stuck" dan statistik blok punya arti waktu yang konsisten.
+
+enum SensorFault : uint8_t
+{
+  FAULT_NONE = 0,
+  FAULT_RANGE = 1 << 0,        // di luar rentang fisik
+  FAULT_RATE = 1 << 1,         // berubah lebih cepat dari yang mungkin secara fisik
+  FAULT_STUCK = 1 << 2,        // nilai mentah tidak berubah sama sekali terlalu lama
+  FAULT_RAIL = 1 << 3,         // ADC menempel di 0 atau 4095 (kabel putus/short)
+  FAULT_NOISY = 1 << 4,        // simpangan baku blok terlalu besar (input mengambang)
+  FAULT_DISCONNECTED = 1 << 5, // sensor digital tidak menjawab
+};
+
+struct SensorHealthConfig
+{
+  float physMin;       // batas rentang fisik (satuan akhir)
+  float physMax;
+  float maxRatePerSec; // perubahan maksimum per detik (satuan akhir), 0 = nonaktif
+  float railLow;       // ADC mentah <= railLow dianggap menempel di rail, <0 = nonaktif
+  float railHigh;
+  uint16_t stuckSamples; // jumlah sampel identik berturut-turut, 0 = nonaktif
+  float stuckEpsilon;    // toleransi "identik" pada nilai mentah
+  uint16_t blockSamples; // ukuran blok Welford untuk cek FAULT_NOISY, 0 = nonaktif
+  float maxStdDev;       // simpangan baku maksimum dalam satu blok (satuan akhir)
+  uint16_t clearSamples; // sampel sehat berturut-turut sebelum fault dilepas
+};
+
+class SensorHealth
+{
+public:
+  explicit SensorHealth(const SensorHealthConfig &c) : cfg(c) {}
+
+  /// @brief evaluasi satu sampel
+  /// @param value nilai akhir (pH, NTU, mg/L, °C)
+  /// @param raw nilai mentah (ADC count, atau sama dengan value untuk sensor digital)
+  /// @param nowMs millis() saat sampel diambil
+  /// @return bitmask SensorFault yang aktif (sudah termasuk hysteresis)
+  uint8_t update(float value, float raw, uint32_t nowMs)
+  {
+    uint8_t now = FAULT_NONE;
+
+    if (isnan(value) || value < cfg.physMin || value > cfg.physMax)
+      now |= FAULT_RANGE;
+
+    if (cfg.railLow >= 0 && (raw <= cfg.railLow || raw >= cfg.railHigh))
+      now |= FAULT_RAIL;
+
+    if (hasPrev && cfg.maxRatePerSec > 0)
+    {
+      uint32_t dt = nowMs - prevMs;
+      if (dt > 0 && fabsf(value - prevValue) * 1000.0f / dt > cfg.maxRatePerSec)
+        now |= FAULT_RATE;
+    }
+
+    if (cfg.stuckSamples)
+    {
+      if (hasPrev && fabsf(raw - prevRaw) <= cfg.stuckEpsilon)
+      {
+        if (stuckCount < cfg.stuckSamples)
+          stuckCount++;
+      }
+      else
+        stuckCount = 0;
+      if (stuckCount >= cfg.stuckSamples)
+        now |= FAULT_STUCK;
+    }
+
+    // Welford per blok: mean/M2 diperbarui O(1); di akhir blok simpangan baku
+    // dievaluasi lalu blok direset. Hasil blok terakhir berlaku sampai blok berikut.
+    if (cfg.blockSamples)
+    {
+      n++;
+      float delta = value - mean;
+      mean += delta / n;
+      m2 += delta * (value - mean);
+      if (n >= cfg.blockSamples)
+      {
+        blockNoisy = sqrtf(m2 / (n - 1)) > cfg.maxStdDev;
+        n = 0;
+        mean = 0;
+        m2 = 0;
+      }
+      if (blockNoisy)
+        now |= FAULT_NOISY;
+    }
+
+    prevValue = value;
+    prevRaw = raw;
+    prevMs = nowMs;
+    hasPrev = true;
+    return latch(now);
+  }
+
+  /// @brief tandai sensor digital tidak menjawab (nilai terakhir tidak diperbarui)
+  uint8_t markDisconnected()
+  {
+    hasPrev = false; // jangan hitung laju perubahan melewati celah data
+    stuckCount = 0;
+    return latch(FAULT_DISCONNECTED);
+  }
+
+  uint8_t faults() const { return active; }
+  bool valid() const { return active == FAULT_NONE; }
+  float blockMean() const { return mean; }
+
+  /// @brief nama fault untuk pesan alarm
+  static const char *faultName(uint8_t bit)
+  {
+    switch (bit)
+    {
+    case FAULT_RANGE:
+      return "range";
+    case FAULT_RATE:
+      return "rate";
+    case FAULT_STUCK:
+      return "stuck";
+    case FAULT_RAIL:
+      return "rail";
+    case FAULT_NOISY:
+      return "noisy";
+    case FAULT_DISCONNECTED:
+      return "disconnected";
+    default:
+      return "unknown";
+    }
+  }
+
+private:
+  // Fault langsung aktif, tetapi baru dilepas setelah clearSamples sampel sehat
+  uint8_t latch(uint8_t now)
+  {
+    if (now)
+    {
+      active |= now;
+      goodCount = 0;
+    }
+    else if (active && ++goodCount >= cfg.clearSamples)
+    {
+      active = FAULT_NONE;
+      goodCount = 0;
+    }
+    return active;
+  }
+
+  const SensorHealthConfig cfg;
+  uint8_t active = FAULT_NONE;
+  uint16_t goodCount = 0;
+  uint16_t stuckCount = 0;
+  bool hasPrev = false;
+  bool blockNoisy = false;
+  float prevValue = 0;
+  float prevRaw = 0;
+  uint32_t prevMs = 0;
+  uint16_t n = 0;
+  float mean = 0;
+  float m2 = 0;
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include "AutoRelay.h"
+#include "ChannelRegistry.h"
+#include "EventJournal.h"
+#include "HistoryStats.h"
+
+// Serialisasi JSON ke buffer tetap, tanpa alokasi. Dipakai endpoint tunggal
+// (/last, /thresholds, /relay-status), /snapshot, /events dan /stats supaya isinya
+// selalu sama. State diberikan lewat parameter sehingga bisa diukur di host
+// (tools/bench); pembungkus dengan state global ada di src/main.cpp.
+
+/// @brief tambahkan teks terformat ke buf; false jika buffer penuh
+inline bool appendf(char *buf, size_t size, size_t &len, const char *fmt, ...)
+{
+  if (len >= size)
+    return false;
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf + len, size - len, fmt, args);
+  va_end(args);
+  if (n < 0 || len + n >= size)
+    return false;
+  len += n;
+  return true;
+}
+
+inline bool writeRelayStatusJson(char *buf, size_t size, size_t &len, const bool *relay, int count, bool autoMode)
+{
+  bool ok = appendf(buf, size, len, "{");
+  for (int i = 0; i < count; ++i)
+    ok = ok && appendf(buf, size, len, "\"relay%d\":%s,", i + 1, relay[i] ? "true" : "false");
+  return ok && appendf(buf, size, len, "\"mode\":\"%s\"}", autoMode ? "auto" : "manual");
+}
+
+template <int N>
+bool writeThresholdsJson(char *buf, size_t size, size_t &len, const ChannelTable<N> &table, const threshold_t *threshold)
+{
+  bool ok = appendf(buf, size, len, "{");
+  for (int i = 0; ok && i < N; i++)
+    ok = appendf(buf, size, len, "%s\"%s\":{\"min\":%.2f,\"max\":%.2f}", i ? "," : "",
+                 table[i].key, threshold[i].min, threshold[i].max);
+  return ok && appendf(buf, size, len, "}");
+}
+
+// Ringkasan /last di luar nilai kanal
+struct LastStatus
+{
+  float oksSlope;         // tren DO, mg/L per jam
+  float oksEta;           // detik sampai DO < threshold min, -1 = tidak turun
+  float duty;             // duty cycle CPU
+  float mA;               // perkiraan arus
+  unsigned long wdMisses; // jumlah watchdog terlewat
+  bool spiffs;            // SPIFFS ter-mount (jurnal & spool MQTT aktif)
+};
+
+/// @param last nilai sampel terakhir per kanal, nullptr jika riwayat kosong
+template <int N>
+bool writeLastJson(char *buf, size_t size, size_t &len, const ChannelTable<N> &table, const float *last,
+                   const SensorHealth *health, const LastStatus &s)
+{
+  bool ok = appendf(buf, size, len, "{");
+  for (int i = 0; ok && i < N; i++)
+    ok = last ? appendf(buf, size, len, "\"%s\":%.2f,", table[i].key, last[i])
+              : appendf(buf, size, len, "%s\"%s\":null", i ? "," : "", table[i].key);
+  if (!last)
+    return ok && appendf(buf, size, len, "}");
+
+  ok = ok && appendf(buf, size, len, "\"faults\":{");
+  for (int i = 0; ok && i < N; i++)
+    ok = appendf(buf, size, len, "%s\"%s\":%u", i ? "," : "", table[i].key, health[i].faults());
+
+  return ok && appendf(buf, size, len,
+                       "},\"oksSlope\":%.2f,\"oksEta\":%.0f,\"duty\":%.3f,\"mA\":%.0f,\"wdMisses\":%lu,\"spiffs\":%s}",
+                       s.oksSlope, s.oksEta, s.duty, s.mA, s.wdMisses, s.spiffs ? "true" : "false");
+}
+
+template <int N>
+bool writeJournalEventJson(char *buf, size_t size, size_t &len, const ChannelTable<N> &table,
+                           const JournalEvent &e, bool first)
+{
+  const char *source = e.source < sizeof(journalSourceNames) / sizeof(journalSourceNames[0])
+                           ? journalSourceNames[e.source]
+                           : "?";
+  bool ok = appendf(buf, size, len, "%s{\"seq\":%lu,\"t\":%lu,\"src\":\"%s\",\"before\":%u,\"after\":%u",
+                    first ? "" : ",", (unsigned long)e.seq, (unsigned long)e.t, source, e.before, e.after);
+  if (ok && e.channel < N)
+    ok = e.reading == INT16_MIN
+             ? appendf(buf, size, len, ",\"ch\":\"%s\",\"v\":null", table[e.channel].key)
+             : appendf(buf, size, len, ",\"ch\":\"%s\",\"v\":%.2f", table[e.channel].key, e.reading / 100.0f);
+  return ok && appendf(buf, size, len, "}");
+}
+
+/// @brief satu kanal /stats: "key":{min,max,mean,validS,outS,outSamples}, null jika tanpa nilai valid
+inline bool writeStatsJson(char *buf, size_t size, size_t &len, const char *key, const StatsResult &r, bool first)
+{
+  bool ok = appendf(buf, size, len, "%s\"%s\":{", first ? "" : ",", key);
+  ok = ok && (isnan(r.min) ? appendf(buf, size, len, "\"min\":null,\"max\":null,")
+                           : appendf(buf, size, len, "\"min\":%.2f,\"max\":%.2f,", r.min, r.max));
+  ok = ok && (isnan(r.mean) ? appendf(buf, size, len, "\"mean\":null,")
+                            : appendf(buf, size, len, "\"mean\":%.3f,", r.mean));
+  return ok && appendf(buf, size, len, "\"validS\":%.1f,\"outS\":%.1f,\"outSamples\":%lu}",
+                       r.validMs / 1000.0f, r.outMs / 1000.0f, (unsigned long)r.outSamples);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// File dasbor yang ditanam ke firmware saat build oleh tools/embed_assets.py
+// (extra_script PlatformIO, sumber dari folder data/). Isi disimpan sebagai
+// array const di .rodata, yang pada ESP32 dibaca langsung dari flash yang
+// di-map ke memori: respons dikirim dari pointer ini tanpa membuka SPIFFS
+// dan tanpa menyalin ke RAM. Tabel terurut menurut path.
+
+struct WebAsset
+{
+  const char *path;    // "/chart.js"
+  const char *mime;    // Content-Type
+  const uint8_t *data; // isi (gzip jika gzip = true)
+  uint32_t length;     // byte di data
+  uint32_t size;       // ukuran asli sebelum kompresi
+  bool gzip;           // kirim dengan Content-Encoding: gzip
+  const char *etag;    // "\"<16 hex SHA-256 isi asli>\""
+};
+
+extern const WebAsset webAssets[];
+extern const size_t webAssetCount;
+
+/// @brief cari aset menurut path (binary search), nullptr jika tidak ada
+inline const WebAsset *findWebAsset(const char *path)
+{
+  size_t lo = 0, hi = webAssetCount;
+  while (lo < hi)
+  {
+    size_t mid = (lo + hi) / 2;
+    int c = strcmp(webAssets[mid].path, path);
+    if (c == 0)
+      return &webAssets[mid];
+    if (c < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return nullptr;
+}
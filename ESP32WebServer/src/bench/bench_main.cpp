@@ -0,0 +1,38 @@
+// Firmware benchmark (env:bench): menjalankan kasus tools/bench/BenchCases.h
+// di ESP32 lalu mencetak hasil JSON ke serial, format sama dengan
+// `tools/bench/bench --json`. Tanpa WiFi/server supaya hasil tidak terganggu.
+//
+//   pio run -e bench -t upload && pio device monitor -e bench
+//
+// Di target juga diukur getChartData() (String) sebagai pembanding
+// writeChartData().
+
+#include <Arduino.h>
+#include "Bench.h"
+#include "BenchCases.h"
+
+const uint64_t benchMinNs = 200000000ULL; // 200 ms per kasus
+
+void setup()
+{
+  Serial.begin(115200);
+  delay(1000);
+  bench::setup();
+
+  char line[256];
+  Serial.printf("{\"suite\":\"firmware\",\"target\":\"esp32\",\"cpu_mhz\":%lu,\"free_heap\":%lu,\"results\":[\n",
+                (unsigned long)getCpuFrequencyMhz(), (unsigned long)ESP.getFreeHeap());
+  for (int i = 0; i < benchCaseCount; i++)
+  {
+    BenchResult r = benchMeasure(benchCases[i], benchMinNs);
+    benchFormatJson(line, sizeof(line), r, i == 0);
+    Serial.println(line);
+    delay(1); // beri kesempatan task lain (watchdog idle)
+  }
+  Serial.println("]}");
+}
+
+void loop()
+{
+  delay(1000);
+}
@@ -4,6 +4,7 @@
 #include <ESPmDNS.h>
 #include <esp_system.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <OneWire.h>
 #include <DallasTemperature.h>
 #include <LiquidCrystal_I2C.h>
@@ -13,6 +14,32 @@
 #include <SPIFFS.h>
 #include <WebSocketsServer.h>
 #include <ArduinoJson.h>
+#include <PubSubClient.h>
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <esp_timer.h>
+#include <mbedtls/sha256.h>
+#include <esp_pm.h>
+#include <esp_idf_version.h>
+#include "MqttForwarder.h"
+#include "SensorHealth.h"
+#include "DoTable.h"
+#include "DoTrend.h"
+#include "Scheduler.h"
+#include "Analog.h"
+#include "SensorConversion.h"
+#include "AutoRelay.h"
+#include "HistoryStore.h"
+#include "ChannelRegistry.h"
+#include "KitChannels.h"
+#include "Ads1115.h"
+#include "CommandQueue.h"
+#include "ModbusTcp.h"
+#include "EventJournal.h"
+#include "WebAssets.h"
+#include "DataList.h"
+#include "HistoryStats.h"
+#include "StatusJson.h"
 
 // ===== User defined constants =====
 // sudah terdefinisi di header esp32-hal-gpio.h
@@ -20,35 +47,33 @@
 // #define GPIO_OUT_W1TC_REG 0x3FF4400C
 
 #define MODE_STA_OR_AP "ap"     // "sta" atau "ap"
-#define TWO_POINT_CALIBRATION 1 // 0 = single point, 1 = two point
-// Single point calibration needs to be filled CAL1_V and CAL1_T
-#define CAL1_V (1100) // mv
-#define CAL1_T (34)   // ℃
-// Two-point calibration needs to be filled CAL2_V and CAL2_T
-// CAL1 High temperature point, CAL2 Low temperature point
-#define CAL2_V (650) // mv
-#define CAL2_T (23)  // ℃
-
-// Pin definitions
-#define PIN_PH 32
-#define PIN_TURBIDITY 33
-#define PIN_OKSIGEN 34
-#define PIN_POTENSIO 35
-#define PIN_SUHU 23
-#define PIN_RELAY_1 14
-#define PIN_RELAY_2 27
-#define PIN_RELAY_3 26
-#define PIN_RELAY_4 25
-#define PIN_RELAY_5 19
-
-// Lookup table for Dissolved Oxygen (DO) in mg/L at different temperatures (0-40°C)
-const uint16_t DO_Table[41] = {
-    14460, 14220, 13820, 13440, 13090, 12740, 12420, 12110, 11810, 11530,
-    11260, 11010, 10770, 10530, 10300, 10080, 9860, 9660, 9460, 9270,
-    9080, 8900, 8730, 8570, 8410, 8250, 8110, 7960, 7820, 7690,
-    7560, 7430, 7300, 7180, 7070, 6950, 6840, 6730, 6630, 6530, 6410};
-
-const long tempRequestInterval = 800; // Minta suhu setiap 750 ms
+
+#define MQTT_ENABLED 0 // 1 = kirim data ke broker MQTT pusat (butuh mode "sta")
+#define LOW_POWER_MODE 0 // 1 = hemat daya: sampling via timer, CPU turun frekuensi & light sleep saat idle
+#define ADS1115_ENABLED 0 // 1 = ADC I2C eksternal ADS1115 untuk kanal SRC_ADS1115 (lihat tabel channels)
+
+const unsigned long telemetryInterval = 1000; // broadcast telemetri WebSocket (untuk collector host)
+
+// Periode sampling ADC; filter EMA kelas Analog maju sekali per periode
+const uint32_t adcIntervalMs = LOW_POWER_MODE ? 50 : 1;
+const unsigned long lcdPageMs = 3000;            // ganti halaman LCD jika kanal lebih dari empat
+
+// jika LOW_POWER_MODE
+const uint32_t relayLatencyMs = 100;             // loop tidak pernah tidur lebih lama dari ini
+const uint32_t lpCpuMaxMhz = 80;                 // frekuensi maksimum saat hemat daya
+const uint32_t lpCpuMinMhz = 40;                 // frekuensi saat idle (XTAL)
+const unsigned long lcdIdleTimeoutMs = 60000;    // backlight LCD mati setelah 60 s tanpa aktivitas
+
+// Watchdog loop kontrol: jika controlTick() tidak berjalan selama watchdogDeadlineMs
+// (mis. handleClient() atau stream SPIFFS macet), ISR timer hardware memaksa relay
+// ke pola aman di bawah ini sampai loop pulih
+const uint32_t watchdogDeadlineMs = 500;
+const uint32_t watchdogCheckUs = 50000; // periode ISR pemeriksa
+const bool watchdogSafePattern[5] = {false, false, false, true, false}; // aerator nyala, lainnya mati
+
+// OTA: firmware baru harus lolos health check sebelum ditandai valid
+const unsigned long otaHealthWindowMs = 30000;   // loop harus berjalan sehat selama 30 s
+const uint64_t otaHealthTimeoutUs = 120000000ULL; // belum valid setelah 120 s (mis. macet di setup) -> rollback
 
 // jika mode STA
 const char *ssid = "Pertanian IPB utama";
@@ -58,218 +83,151 @@ const char *password = "pertanian dan pangan";
 const char *ap_ssid = "Trainer_Akuaponik";
 const char *ap_password = "12345678";
 
-const int maxDataPoints = 30;
+const int maxDataPoints = 30; // jumlah titik grafik di /data dan /snapshot
+
+// Riwayat sensor terkompresi (include/HistoryStore.h): ~2 byte/sampel pada
+// pencatatan 50 ms, 32 blok x 256 byte menyimpan ~3.5 menit (/export) jika
+// semua kanal aktif; saat stabil hanya heartbeat/deadband yang dicatat (jam-an).
+// Nilai disimpan dengan resolusi 0.01, sama dengan presisi output JSON/CSV.
+const float historyResolution = 0.01f;
+const int historyBlockBytes = 256;
+const int historyBlocks = 32;
+
+// Indeks agregat /stats (include/HistoryStats.h): 144 bucket x 10 menit = 24 jam,
+// segment tree ~29 KB RAM. Jeda pencatatan lebih dari statsMaxGapMs tidak dihitung
+// (heartbeat terlama kanal 30 s).
+const uint32_t statsBucketMs = 600000;
+const int statsBuckets = 144;
+const uint32_t statsMaxGapMs = 60000;
+
+// jika MQTT_ENABLED
+const char *mqtt_host = "192.168.1.10";
+const uint16_t mqtt_port = 1883;
+const char *mqtt_client_id = "kit-kolam-01";
+const char *mqtt_topic_prefix = "kolam/kit-01"; // topic: <prefix>/data, <prefix>/relay, <prefix>/cmd/#
+// batch, laju drain, spool dan slot antrian: include/KitConfig.h
+const int32_t mqttConnectTimeoutMs = 200;       // batas TCP connect ke broker (di bawah watchdogDeadlineMs)
+
+// Ukuran buffer tetap untuk streaming /export (chunked transfer encoding)
+const size_t exportChunkSize = 512;
+// Potongan pengiriman aset dasbor dari flash; controlTick() di antaranya
+const size_t assetChunkSize = 4096;
+
+// Modbus TCP slave untuk SCADA (include/ModbusTcp.h, peta register di README)
+const uint16_t modbusPort = 502;
+const int modbusMaxClients = 2;
+const unsigned long modbusIdleTimeoutMs = 60000; // koneksi tanpa permintaan diputus
+
+// Jurnal kejadian relay/mode (include/EventJournal.h): record 16 byte di RAM,
+// ditulis ke SPIFFS per batch. Dua file bergantian (aktif + .old) membatasi
+// pemakaian flash ke 2 x journalMaxBytes (~4000 kejadian).
+const int journalCapacity = 128;                // record di RAM (2 KB)
+const uint32_t journalFlushBatch = 32;          // tulis ke flash jika sebanyak ini menunggu
+const uint32_t journalFlushMaxAgeMs = 30000;    // ... atau kejadian tertua sudah selama ini
+const size_t journalMaxBytes = 32 * 1024;       // per file
+const uint32_t journalPageMax = 100;            // batas ?limit= di /events
+
+// jika ADS1115_ENABLED: satu chip per elemen; input kanal SRC_ADS1115 = chip * 4 + AINx
+const uint8_t adsAddress[] = {0x48};
+const int adsRdyPin[] = {PIN_ADS_RDY};
+const Ads1115::Rate adsRate = Ads1115::SPS_64; // per chip, dibagi bergiliran ke input aktif
+const uint32_t adsPollMs = 5;                  // job "adc" tidak melambat di atas ini selama ADS aktif
+
+// Pin, kalibrasi DO dan tuning kontroler ada di include/KitConfig.h, tabel kanal
+// (channels, CHI_*) di include/KitChannels.h; keduanya dipakai bersama tools/replay dan tools/bench.
 
 // ===== User defined classes =====
-class Analog
-{
-public:
-  enum VarType
-  {
-    VOLTAGE,
-    FINAL,
-    PERCENT,
-    ADC
-  };
-  /// @brief inisialisasi pin analog dengan filter alpha
-  /// @param p pin analog
-  /// @param a variabel alpha (0 < a < 1), semakin kecil semakin halus
-  Analog(int p, float a) : pin(p), alpha(a), voltage(0.0), final(0.0), percent(0.0), smoothedRaw(0.0)
-  {
-    pinMode(pin, INPUT);
-  }
-  /// @brief panggil di loop utama
-  void update()
-  {
-    if (firstRead)
-    {
-      smoothedRaw = (float)analogRead(pin);
-      firstRead = false;
-    }
-    else
-    {
-      smoothedRaw = (alpha * (float)analogRead(pin)) + ((1 - alpha) * smoothedRaw);
-    }
-
-    voltage = (round(smoothedRaw) / 4095.0f) * 3.3f;
-    percent = (round(smoothedRaw) / 4095.0f) * 100.0f;
-    // percent = smoothedRaw;
-  }
-  /// @brief mendapatkan pin analog
-  uint8_t getPin() { return pin; }
-
-  /// @brief mengambil nilai variabel (alpha, voltage, final)
-  float getVar(VarType var) const
-  { // Tambahkan 'const' karena fungsi ini tidak mengubah state objek
-    switch (var)
-    {
-    case VOLTAGE:
-      return voltage;
-    case FINAL:
-      return final;
-    case PERCENT:
-      return percent;
-    case ADC:
-      return smoothedRaw;
-    default:
-      return 0.0; // Nilai default jika ada case yang tidak terduga
-    }
-  }
-
-  void setFinal(float v)
-  {
-    final = v;
-  }
-
-private:
-  const uint8_t pin;
-  float alpha;
-  float voltage;
-  float final;
-  float percent;
-  float smoothedRaw;
-  bool firstRead = true;
-};
-
-// Struktur data untuk menyimpan data sensor
-struct DataNode
-{
-  float ph;
-  float turbidity;
-  float oksigen;
-  float suhu;
-  DataNode *next;
-};
-
-class DataList
-{
-public:
-  // Konstruktor: Inisialisasi linked list dan batas data
-  DataList(int maxPoints) : head(nullptr), tail(nullptr), count(0), maxDataPoints(maxPoints) {}
-
-  // Destruktor: Menghapus semua node di list untuk mencegah memory leak
-  ~DataList()
-  {
-    DataNode *current = head;
-    while (current)
-    {
-      DataNode *next = current->next;
-      delete current;
-      current = next;
-    }
-  }
-
-  void addData(float ph, float turb, float oks, float suhu)
-  {
-    // 1. Buat node baru
-    DataNode *newNode = new DataNode{ph, turb, oks, suhu, nullptr};
-
-    // 2. Tambahkan node ke akhir list
-    if (tail)
-    {
-      tail->next = newNode;
-      tail = newNode;
-    }
-    else
-    {
-      // Jika list kosong, head dan tail menunjuk ke node baru
-      head = tail = newNode;
-    }
-
-    // 3. Perbarui jumlah node
-    count++;
-
-    // 4. Pangkas list jika melebihi batas
-    if (count > maxDataPoints)
-    {
-      DataNode *oldHead = head;
-      head = head->next;
-      delete oldHead;
-      count--;
-    }
-  }
-
-  // Metode untuk mendapatkan jumlah data saat ini (opsional)
-  int getCount() const
-  {
-    return count;
-  }
-
-  // Metode baru untuk mengambil data sebagai string berformat
-  String getChartData(const String &sensor) const
-  {
-    String data = "[";
-    DataNode *current = head;
-
-    while (current)
-    {
-      if (sensor == "ph")
-        data += String(current->ph, 2);
-      else if (sensor == "turb")
-        data += String(current->turbidity, 2);
-      else if (sensor == "oks")
-        data += String(current->oksigen, 2);
-      else if (sensor == "suhu")
-        data += String(current->suhu, 2);
-
-      if (current->next)
-        data += ",";
-
-      current = current->next;
-    }
-
-    data += "]";
-    return data;
-  }
-  // Metode baru untuk mendapatkan node terakhir
-  DataNode *getLastNode() const
-  {
-    return tail;
-  }
-
-private:
-  DataNode *head;
-  DataNode *tail;
-  int maxDataPoints;
-  int count; // Menghitung node secara efisien
-};
+typedef HistoryStore<channelCount, historyBlockBytes, historyBlocks> History;
+typedef History::Sample DataNode; // sampel hasil dekode: t + v[indeks kanal]
+typedef DataList<channelCount, historyBlockBytes, historyBlocks> SensorHistory; // include/DataList.h
 
-struct threshold_t
-{
-  float min;
-  float max;
-};
 
 // ===== User Global variables =====
-Analog phSensor = Analog(PIN_PH, 0.1f);
-Analog turbiditySensor = Analog(PIN_TURBIDITY, 0.1f);
-Analog oksigenSensor = Analog(PIN_OKSIGEN, 0.1f);
+// Nilai, filter, threshold dan kesehatan semua kanal di tabel channels
+ChannelBank<channelCount> sensors(channels);
 Analog potensiometer = Analog(PIN_POTENSIO, 0.1f);
 
-static float suhuValue = 0;
 
-threshold_t phThreshold = {6.5f, 8.5f};
-threshold_t turbidityThreshold = {20.0f, 70.0f}; //
-threshold_t oksigenThreshold = {5.0f, 14.0f};
-threshold_t suhuThreshold = {20.0f, 30.0f};
+const int adsCount = sizeof(adsAddress) / sizeof(adsAddress[0]);
+Ads1115 ads[adsCount];
+int8_t adsChannel[adsCount * 4]; // input ADS (chip * 4 + AINx) -> indeks kanal, -1 = tidak dipakai
 
-unsigned long lastTempRequest = 0;
+// Aerator prediktif (relay4) dan dosing pH (relay1/2), konfigurasi di include/KitConfig.h
+DoTrend doTrend(doTrendConfig);
+PhDosing phDosing(phDosingConfig);
 
 OneWire oneWire(PIN_SUHU);
 DallasTemperature sensorSuhu(&oneWire);
 
-unsigned long lastUpdate_sensor = 0;
-
 LiquidCrystal_I2C lcd(0x27, 16, 2);
 
 WebServer server(80);
 WebSocketsServer webSocket = WebSocketsServer(81); // WebSocket di port 81
 
-DataList sensorData(maxDataPoints);
+SensorHistory sensorData(channels, historyResolution, maxDataPoints);
+HistoryStats<channelCount, statsBuckets> sensorStats(statsBucketMs, statsMaxGapMs);
 
 bool relayState[5] = {false, false, false, false, false};
 bool autoMode = true; // true = otomatis, false = manual
 
+EventJournal<journalCapacity> journal;
+const char *journalPath = "/events.bin";
+const char *journalOldPath = "/events.old";
+// Kanal yang menjadi dasar keputusan tiap relay (nilai dicatat di jurnal)
+const int relayChannel[5] = {CHI_PH, CHI_PH, CHI_TURB, CHI_OKS, CHI_SUHU};
+
+// Perintah WebSocket: callback hanya mem-parse dan menitipkan, controlTick()
+// menerapkan satu batch utuh per perintah, loop() mengirim ack dan status.
+SpscQueue<Command, 16> commandQueue; // webSocketEvent() -> controlTick()
+SpscQueue<CommandAck, 16> ackQueue;  // controlTick() -> flushCommandAcks()
+bool commandBroadcastPending = false; // ada perintah diterapkan, status perlu di-broadcast
+
+// Penjadwal: job kontrol dijalankan dari controlTick() (termasuk di sela respons
+// panjang), job layanan (LCD, telemetri, MQTT, OTA) hanya dari loop()
+Scheduler<8> controlJobs;
+Scheduler<8> serviceJobs;
+int adcJobId = -1; // periode job "adc" mengikuti kanal tercepat (sampling adaptif)
+bool tempReady = false;        // DS18B20 sudah diminta mengukur
+bool turbidityCycleOn = false; // siklus pompa saat kekeruhan di dalam band
+
+// Watchdog loop kontrol (diakses dari ISR)
+enum LoopStage : uint8_t
+{
+  STAGE_CONTROL,
+  STAGE_HTTP,
+  STAGE_WS,
+  STAGE_MQTT,
+  STAGE_MODBUS,
+  STAGE_SERVICE,
+  STAGE_IDLE,
+};
+const char *const loopStageNames[] = {"control", "http", "ws", "mqtt", "modbus", "service", "idle"};
+hw_timer_t *watchdogTimer = nullptr;
+volatile uint32_t watchdogHeartbeatUs = 0;
+volatile uint8_t loopStage = STAGE_CONTROL;
+volatile bool watchdogTripped = false;
+volatile uint8_t watchdogTripStage = STAGE_CONTROL;
+volatile uint32_t watchdogTripUs = 0;
+volatile uint32_t watchdogMisses = 0;
+uint32_t watchdogSetMask = 0;   // pin relay yang di-HIGH-kan (relay mati, aktif LOW)
+uint32_t watchdogClearMask = 0; // pin relay yang di-LOW-kan (relay nyala)
+
+// Hemat daya
+bool lightSleepEnabled = false;
+bool modemSleepEnabled = false;
+bool lcdBacklightOn = true;
+unsigned long lastActivity = 0;
+
+// Statistik duty cycle (jendela 10 s) untuk telemetri
+uint32_t powerBusyUs = 0;
+uint32_t powerWindowStartUs = 0;
+float powerDuty = 1.0f;
+
+// status untuk health check OTA
+bool networkOk = false;
+bool spiffsOk = false;
+bool serverStarted = false;
+
 // new globals for client connection tracking
 unsigned long lastClientPing = 0;
 const unsigned long clientTimeoutMs = 6000; // jika tidak ada ping dalam 6s -> dianggap tidak connected
@@ -277,23 +235,60 @@ const unsigned long clientTimeoutMs = 6000; // jika tidak ada ping dalam 6s -> d
 // ===== User defined functions =====
 // ===== Web =====
 void webSocketEvent(uint8_t num, WStype_t type, uint8_t *payload, size_t length);
+void applyCommands();
+void modbusBegin();
+void modbusPoll();
+void updateModbusImage();
+void flushCommandAcks();
+void sendCommandAck(uint8_t client, uint32_t seq, uint8_t status);
+void journalBegin();
+void journalFlush();
+void handleEvents();
+void handleStats();
+bool spiffsMount();
+void handleSpiffsFormat();
 
 void handleRoot();
+void handleStatic();
 void handleData();
 void handleLast();
+void handleSnapshot();
+void handleScheduler();
 void handleRelayStatus();
-// Handler untuk mengirim file script.js
-void handleScriptJs();
-void handleChartJs();
-void handleLuxonJs();
-void handleAdapterLuxonJs();
-void handleStreamingPluginJs();
-void handleSbAdmin2Css();
 void handleGetThresholds();
 void handleSetThresholds();
+void handleExport();
+bool writeRelayStatusJson(char *buf, size_t size, size_t &len);
+// ===== MQTT =====
+void mqttInit();
+void mqttSample();
+void mqttConnect();
+void mqttDrainWindow();
+void mqttLoop();
+void mqttPublishRelay(int idx, bool state);
+void broadcastTelemetry();
+// ===== OTA =====
+void handleUpdateUpload();
+void handleUpdateDone();
+void otaBootCheck();
+void otaHealthCheck();
+void otaRestart();
+void updateSensorHealth();
+void updateDoTrend();
+// ===== Watchdog =====
+void watchdogInit();
+void watchdogFeed();
+// ===== Hemat daya =====
+void powerInit();
+void powerIdle(uint32_t loopStartUs, uint32_t waitMs);
+void updatePowerStats();
+void noteActivity();
+float estimateCurrentMa();
 // ===== LCD I2C =====
 void timerLcdI2c();
 
+void setRelay(int idx, bool state, uint8_t source = JS_AUTO);
+
 void fastWrite(uint8_t pin, uint8_t value)
 {
   // Buat bitmask: 1 digeser ke kiri sebanyak 'pin'
@@ -316,105 +311,72 @@ void fastWrite(uint8_t pin, uint8_t value)
   }
 }
 
-void handlePhSensor()
-{
-  const float calibration_value = 1.85f;
-  float voltage = phSensor.getVar(Analog::VOLTAGE);
-
-  float adc = phSensor.getVar(Analog::ADC);
-  // Serial.print(voltage*1000.0f);
-  // Serial.print(" ");
-  // Serial.println(int(adc));
-
-  float phValue = 3.5 * voltage * (5.0 / 3.3) + calibration_value;
-  phSensor.setFinal(phValue);
-}
-
-float map_float(float x, float in_min, float in_max, float out_min, float out_max)
+/// @brief aktifkan ADS1115 untuk input yang dipakai kanal SRC_ADS1115
+void adsInit()
 {
-  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+  uint8_t masks[adsCount] = {};
+  memset(adsChannel, -1, sizeof(adsChannel));
+  for (int i = 0; i < channelCount; i++)
+  {
+    if (channels[i].source != SRC_ADS1115 || channels[i].input >= adsCount * 4)
+      continue;
+    adsChannel[channels[i].input] = i;
+    masks[channels[i].input / 4] |= 1 << (channels[i].input % 4);
+  }
+  for (int c = 0; c < adsCount; c++)
+  {
+    if (masks[c] && !ads[c].begin(Wire, adsAddress[c], adsRdyPin[c], masks[c], Ads1115::FSR_4V096, adsRate))
+      Serial.printf("ADS1115 0x%02X tidak menjawab\n", adsAddress[c]);
+  }
 }
 
-void handleTurbiditySensor()
+/// @brief ambil hasil konversi ADS1115 yang sudah siap (tidak menunggu)
+void adsPoll()
 {
-  float voltage = turbiditySensor.getVar(Analog::VOLTAGE);
-
-  const float clear_point = 1.53;
-  const float dirty_point = 0.8;
-  const float NTU_MAX = 100.0f;
-
-  const float adc_max = 1860;
-  const float adc_min = 960;
-
-  float a = -NTU_MAX / ((clear_point - dirty_point) *
-                        (clear_point - dirty_point));
-
-  // float ntu = a * (voltage - dirty_point) * (voltage - dirty_point) + NTU_MAX;
-  // float voltage_adjusted = voltage * (5.0 / 3.3);
-  // float ntu = -1120.4*sq(voltage)+5742.3*voltage-4353.8;
-
-  if (voltage > clear_point)
-    voltage = clear_point;
-  else if (voltage < dirty_point)
-    voltage = dirty_point;
-
-  // float ntu = map_float(voltage, 0, clear_point, 3000, 0);
-  float ntu = adc_min + ((voltage - dirty_point) / (clear_point - dirty_point) * (adc_max - adc_min));
-
-  // if (ntu < 0)
-  //   ntu = 0;
-  // if (ntu > NTU_MAX)
-  //   ntu = NTU_MAX;
-  ntu = map_float(ntu, adc_min, adc_max, 100, 0);
-
-  // int adcturbidity = turbiditySensor.getVar(Analog::PERCENT);
-  // Serial.print(voltage);
-  // Serial.print(" ");
-  // Serial.println(adcturbidity);
-
-  turbiditySensor.setFinal(ntu);
+  for (int c = 0; c < adsCount; c++)
+  {
+    uint8_t input;
+    int16_t raw;
+    if (!ads[c].poll(input, raw))
+      continue;
+    int idx = adsChannel[c * 4 + input];
+    if (idx >= 0)
+      sensors.setVoltage(idx, raw * ads[c].lsbVolts(), raw, millis());
+  }
 }
 
-int16_t readDO(uint32_t voltage_mv, uint8_t temperature_c)
+/// @brief relay (bit 0..4) + mode otomatis (bit 7) untuk jurnal
+uint8_t journalState()
 {
-
-#if TWO_POINT_CALIBRATION == 0
-  uint16_t V_saturation = (uint32_t)CAL1_V + (uint32_t)35 * temperature_c - (uint32_t)CAL1_T * 35;
-  return (voltage_mv * DO_Table[temperature_c] / V_saturation);
-#else
-  uint16_t V_saturation = (int16_t)((int8_t)temperature_c - CAL2_T) * ((uint16_t)CAL1_V - CAL2_V) / ((uint8_t)CAL1_T - CAL2_T) + CAL2_V;
-  return (voltage_mv * DO_Table[temperature_c] / V_saturation);
-#endif
+  uint8_t mask = autoMode ? JOURNAL_AUTO_BIT : 0;
+  for (int i = 0; i < 5; i++)
+    mask |= relayState[i] << i;
+  return mask;
 }
 
-void handleOksigenSensor()
+/// @brief catat kejadian ke jurnal RAM (O(1), tanpa alokasi)
+/// @param channel kanal pemicu (indeks tabel channels), -1 = tidak ada
+void journalRecord(uint8_t source, uint8_t before, uint8_t after, int channel, uint32_t t)
 {
-  float voltage_v = oksigenSensor.getVar(Analog::VOLTAGE);
-
-  uint16_t voltage_mv = (uint16_t)(voltage_v * 1000.0);
-
-  uint8_t currentTemperature = (uint8_t)round(suhuValue);
-  // Serial.println(analogRead(PIN_OKSIGEN));
-  // Serial.println(voltage_mv);
-  int tes = analogRead(PIN_OKSIGEN);
-  static int anjay = 0;
-  if (tes > 0)
+  JournalEvent e = {0, t, source, before, after, 0xFF, INT16_MIN, 0};
+  if (channel >= 0)
   {
-    // Serial.println(tes);
+    e.channel = (uint8_t)channel;
+    float v = sensors.value[channel];
+    if (!isnan(v) && v < 327.67f && v > -327.67f)
+      e.reading = (int16_t)lroundf(v * 100.0f);
   }
-  // Serial.println(voltage_mv);
-
-  // 4. Panggil fungsi readDO() untuk menghitung nilai Dissolved Oxygen (mg/L).
-  float o2Value = readDO(voltage_mv, currentTemperature) / 1000.0f; // Konversi ke mg/L
-
-  oksigenSensor.setFinal(o2Value);
+  journal.append(e);
 }
 
 // helper: set relay state and immediately update pin (uses fastWrite)
-void setRelay(int idx, bool state)
+/// @param source JournalSource pemicu perubahan (dicatat di jurnal)
+void setRelay(int idx, bool state, uint8_t source)
 {
   if (idx < 0 || idx > 4)
     return;
+  bool changed = relayState[idx] != state;
+  uint8_t before = journalState();
   relayState[idx] = state;
   int pin;
   switch (idx)
@@ -427,10 +389,113 @@ void setRelay(int idx, bool state)
   default: return;
   }
   fastWrite(pin, relayState[idx] ? LOW : HIGH);
+  if (!changed)
+    return;
+
+  mqttPublishRelay(idx, state);
+  noteActivity();
+  journalRecord(source, before, journalState(), relayChannel[idx], millis());
 
   // Broadcast perubahan state relay
-  String status = "{\"relay" + String(idx + 1) + "\":" + (state ? "true" : "false") + "}";
-  webSocket.broadcastTXT(status);
+  char status[24];
+  int n = snprintf(status, sizeof(status), "{\"relay%d\":%s}", idx + 1, state ? "true" : "false");
+  webSocket.broadcastTXT(status, n);
+}
+
+// ===== Perintah bersama (HTTP, WebSocket, MQTT) =====
+/// @brief "relay1".."relay5" -> 0..4, selain itu -1
+int relayIndexFromName(const char *name)
+{
+  if (strncmp(name, "relay", 5) != 0 || name[5] < '1' || name[5] > '5' || name[6] != '\0')
+    return -1;
+  return name[5] - '1';
+}
+
+/// @brief ubah mode; perubahan dicatat di jurnal
+void setMode(bool automatic, uint8_t source)
+{
+  if (autoMode == automatic)
+    return;
+  uint8_t before = journalState();
+  autoMode = automatic;
+  journalRecord(source, before, journalState(), -1, millis());
+}
+
+/// @brief ubah mode dari teks "auto"/"manual"; false jika teks tidak valid
+bool applyMode(const char *mode, uint8_t source)
+{
+  if (strcmp(mode, "auto") == 0)
+    setMode(true, source);
+  else if (strcmp(mode, "manual") == 0)
+    setMode(false, source);
+  else
+    return false;
+  return true;
+}
+
+/// @brief set threshold satu kanal (key dari tabel channels); false jika tidak valid
+bool applyThreshold(const char *sensor, float min_val, float max_val)
+{
+  int i = channels.indexOf(sensor);
+  if (i < 0 || min_val >= max_val)
+    return false;
+  sensors.threshold[i] = {min_val, max_val};
+  return true;
+}
+
+/// @brief terapkan threshold dari JSON, format tunggal {"sensor":"ph","min":..,"max":..}
+/// atau massal {"ph":{"min":..,"max":..},"turb":{..},...} (key kanal dari tabel channels).
+/// Format massal divalidasi seluruhnya dulu; jika satu kanal salah tidak ada yang diubah.
+/// @param error pesan kesalahan untuk klien (boleh nullptr)
+bool applyThresholdsJson(JsonVariantConst doc, const char **error)
+{
+  const char *dummy;
+  if (!error)
+    error = &dummy;
+
+  if (!doc["sensor"].isNull())
+  {
+    if (!doc["min"].is<float>() || !doc["max"].is<float>() || !applyThreshold(doc["sensor"], doc["min"], doc["max"]))
+    {
+      *error = "Invalid sensor or range";
+      return false;
+    }
+    return true;
+  }
+
+  threshold_t next[channelCount];
+  bool present[channelCount];
+  int count = 0;
+  for (int i = 0; i < channelCount; i++)
+  {
+    JsonVariantConst ch = doc[channels[i].key];
+    present[i] = !ch.isNull();
+    if (!present[i])
+      continue;
+    if (!ch["min"].is<float>() || !ch["max"].is<float>())
+    {
+      *error = "Missing min/max";
+      return false;
+    }
+    next[i] = {ch["min"].as<float>(), ch["max"].as<float>()};
+    if (!isfinite(next[i].min) || !isfinite(next[i].max) || next[i].min >= next[i].max)
+    {
+      *error = "Invalid range";
+      return false;
+    }
+    count++;
+  }
+  if (count == 0)
+  {
+    *error = "No thresholds";
+    return false;
+  }
+
+  // Semua valid: terapkan sekaligus (controlTick() tidak berjalan di tengah handler ini)
+  for (int i = 0; i < channelCount; i++)
+    if (present[i])
+      sensors.threshold[i] = next[i];
+  return true;
 }
 
 void handleButton()
@@ -449,17 +514,7 @@ void handleButton()
 
   String relay = server.arg("relay");
   String state = server.arg("state"); // expected "on" or "off"
-  int idx = -1;
-  if (relay == "relay1")
-    idx = 0;
-  else if (relay == "relay2")
-    idx = 1;
-  else if (relay == "relay3")
-    idx = 2;
-  else if (relay == "relay4")
-    idx = 3;
-  else if (relay == "relay5")
-    idx = 4; // Tambahkan ini
+  int idx = relayIndexFromName(relay.c_str());
 
   if (idx == -1)
   {
@@ -469,9 +524,9 @@ void handleButton()
 
   // server is authoritative: apply requested state
   if (state == "on")
-    setRelay(idx, true);
+    setRelay(idx, true, JS_HTTP);
   else if (state == "off")
-    setRelay(idx, false);
+    setRelay(idx, false, JS_HTTP);
   else
   {
     server.send(400, "application/json", "{\"error\":\"Invalid state\"}");
@@ -490,25 +545,24 @@ void handleButton()
   server.send(200, "application/json", json);
 }
 
+/// @brief bitmask SensorChannel yang sedang rusak
+uint8_t invalidChannels()
+{
+  uint8_t mask = 0;
+  if (!sensors.health[CHI_PH].valid())
+    mask |= CH_PH;
+  if (!sensors.health[CHI_TURB].valid())
+    mask |= CH_TURB;
+  if (!sensors.health[CHI_OKS].valid())
+    mask |= CH_OKS;
+  if (!sensors.health[CHI_SUHU].valid())
+    mask |= CH_SUHU;
+  return mask;
+}
+
 // contoh otomatis: ubah relay berdasarkan kondisi sensor / jadwal
 void autoRelayLogic()
 {
-  static unsigned long lastAutoMillis = 0;
-
-  static unsigned long lastSuhuMillis = 0;
-  static unsigned long lastPhMillis = 0;
-  static unsigned long lastTurbidityMillis = 0;
-  static unsigned long lastOksigenMillis = 0;
-
-  static bool actSuhu = false;
-  static int actPh = -1;
-  static bool actTurbidity = false;
-  static bool actOksigen = false;
-
-  if (millis() - lastAutoMillis < 10)
-    return;
-  lastAutoMillis = millis();
-
   bool stateChanged = false;
   bool oldStates[5];
   for (int i = 0; i < 5; i++)
@@ -516,74 +570,23 @@ void autoRelayLogic()
     oldStates[i] = relayState[i];
   }
 
-  // Contoh 1: jika suhu > 30C -> nyalakan relay1, else matikan
-  if (suhuValue < suhuThreshold.min) setRelay(4, true);
-  else setRelay(4, false);
-
-  if (turbiditySensor.getVar(Analog::FINAL) > turbidityThreshold.max) setRelay(2, true);
-  else if (turbiditySensor.getVar(Analog::FINAL) < turbidityThreshold.min) setRelay(2, false);
-  else {
-    // hidupkan matikan berdasarkan timer setiap 5 detik
-    if (millis() - lastTurbidityMillis > 5000)
-    {
-      lastTurbidityMillis = millis();
-      actTurbidity = !actTurbidity;
-      setRelay(2, actTurbidity);
-    }
-  }
-
-float ph = phSensor.getVar(Analog::FINAL);
-unsigned long now = millis();
-
-// if (ph < phThreshold.min) {                    // pH terlalu rendah → Aktuator 0
-//     if (actPh != 0) {
-//         actPh = 0;
-//         lastPhMillis = now;                   // mulai timer baru
-//     }
-
-//     if (now - lastPhMillis <= 5000) {
-//         setRelay(0, true);
-//     } else {
-//         setRelay(0, false);
-//     }
-//     setRelay(1, false);                       // relay lain dimatikan
-// } else if (ph > phThreshold.max) {               // pH terlalu tinggi → Aktuator 1
-//     if (actPh != 1) {
-//         actPh = 1;
-//         lastPhMillis = now;
-//     }
-
-//     if (now - lastPhMillis <= 5000) {
-//         setRelay(1, true);
-//     } else {
-//         setRelay(1, false);
-//     }
-//     setRelay(0, false);
-// } else {                                         // pH normal
-//     actPh = -1;                                // tidak dalam kondisi koreksi
-//     setRelay(0, false);
-//     setRelay(1, false);
-//     lastPhMillis = now;                        // reset timer
-// }
-
-
-  if (oksigenSensor.getVar(Analog::FINAL) < oksigenThreshold.min) setRelay(3, true);
-  else if (oksigenSensor.getVar(Analog::FINAL) > oksigenThreshold.max) setRelay(3, false);
-  else
+  // Aturan ada di include/AutoRelay.h (dipakai juga oleh tools/replay)
+  ControlReading reading = {
+      sensors.value[CHI_PH],
+      sensors.value[CHI_TURB],
+      sensors.value[CHI_OKS],
+      sensors.value[CHI_SUHU],
+      invalidChannels()};
+  ControlThresholds th = {sensors.threshold[CHI_PH], sensors.threshold[CHI_TURB],
+                          sensors.threshold[CHI_OKS], sensors.threshold[CHI_SUHU]};
+  bool next[5];
+  uint8_t driven = autoRelayDecide(reading, th, turbidityCycleOn, doTrend, phDosing, millis(), next);
+  for (int i = 0; i < 5; i++)
   {
-    setRelay(3, false);
-    // hidupkan matikan berdasarkan timer setiap 5 detik
-    // if ((millis() - lastOksigenMillis > 2000) && actOksigen)
-    // {
-    //   lastOksigenMillis = millis();
-    //   actOksigen = !actOksigen;
-    //   setRelay(3, actOksigen);
-    // } else if ((millis() - lastOksigenMillis > 5000) && !actOksigen) {
-    //   lastOksigenMillis = millis();
-    //   actOksigen = !actOksigen;
-    //   setRelay(3, actOksigen);
-    // }
+    if (driven & (1 << i))
+      setRelay(i, next[i], JS_AUTO);
   }
+
   // Contoh 2: jika potensiometer (percent) > 50 -> nyalakan relay2
   // float potPercent = potensiometer.getVar(Analog::PERCENT);
   // if (potPercent > 50.0) setRelay(1, true);
@@ -602,15 +605,10 @@ unsigned long now = millis();
   // Jika ada perubahan, kirim update ke semua client
   if (stateChanged)
   {
-    String status = "{";
-    for (int i = 0; i < 5; i++)
-    {
-      status += "\"relay" + String(i + 1) + "\":" + (relayState[i] ? "true" : "false");
-      if (i < 4)
-        status += ",";
-    }
-    status += ",\"mode\":\"" + String(autoMode ? "auto" : "manual") + "\"}";
-    webSocket.broadcastTXT(status);
+    char status[128];
+    size_t len = 0;
+    writeRelayStatusJson(status, sizeof(status), len);
+    webSocket.broadcastTXT(status, len);
   }
 }
 
@@ -634,6 +632,7 @@ void modeSTA()
   lcd.clear();
   lcd.setCursor(0, 0);
   lcd.print("WiFi Terhubung");
+  networkOk = true;
 }
 
 void modeAP()
@@ -653,6 +652,7 @@ void modeAP()
     delay(2000);
     return;
   }
+  networkOk = true;
   IPAddress IP = WiFi.softAPIP();
   Serial.print("AP IP address: ");
   Serial.println(IP);
@@ -677,22 +677,28 @@ void hostingStart()
 
 void handleModeGet();
 void handleModePost();
+void controlTick();
+void scheduleJobs();
 
 void setup()
 {
   // ===== User Initialization =====
+  oksigenSuhuSource() = &sensors.value[CHI_SUHU]; // kompensasi DO kanal "oks"
   Serial.println(analogRead(PIN_PH));
   Serial.begin(115200);
+  otaBootCheck();
+  scheduleJobs();
   lcd.init();
   lcd.backlight();
 
   hostingStart();
 
-  if (!SPIFFS.begin(true))
-  {
-    Serial.println("SPIFFS Mount Failed");
-    return;
-  }
+  // SPIFFS hanya untuk data (jurnal, antrian MQTT); dasbor ada di firmware
+  // (include/WebAssets.h), jadi kit tetap bisa dipakai walaupun mount gagal
+  spiffsOk = spiffsMount();
+  journalBegin();
+  if (!spiffsOk)
+    journalRecord(JS_FS, journalState(), journalState(), -1, millis()); // terlihat di /events (ring RAM)
 
   if (MDNS.begin("esp32"))
     Serial.println("mDNS: http://esp32.local");
@@ -703,33 +709,39 @@ void setup()
   lcd.print("esp32.local");
   delay(2000);
 
-  server.on("/sb-admin-2.css", handleSbAdmin2Css);
-  server.on("/chart.js", HTTP_GET, handleChartJs);
-  server.on("/luxon.js", HTTP_GET, handleLuxonJs);
-  server.on("/chartjs-adapter-luxon.js", HTTP_GET, handleAdapterLuxonJs);
-  server.on("/chartjs-plugin-streaming.js", HTTP_GET, handleStreamingPluginJs);
-  server.on("/script.js", handleScriptJs);
+  const char *assetHeaders[] = {"If-None-Match"};
+  server.collectHeaders(assetHeaders, 1);
+  server.onNotFound(handleStatic); // aset dasbor lain (/chart.js, /script.js, ...)
   server.on("/button", HTTP_POST, handleButton);
   server.on("/relay-status", HTTP_GET, handleRelayStatus);
   server.on("/mode", HTTP_GET, handleModeGet);
   server.on("/mode", HTTP_POST, handleModePost);
-  server.on("/", handleRoot);
+  server.on("/", HTTP_GET, handleRoot);
   server.on("/data", handleData); // historis (opsional)
   server.on("/last", handleLast); // realtime
+  server.on("/snapshot", HTTP_GET, handleSnapshot); // semua state dasbor dalam satu respons
   // Tambahkan handler untuk thresholds
   server.on("/thresholds", HTTP_GET, handleGetThresholds);
   server.on("/thresholds", HTTP_POST, handleSetThresholds);
+  server.on("/export", HTTP_GET, handleExport);
+  server.on("/update", HTTP_POST, handleUpdateDone, handleUpdateUpload);
+  server.on("/scheduler", HTTP_GET, handleScheduler);
+  server.on("/events", HTTP_GET, handleEvents);
+  server.on("/stats", HTTP_GET, handleStats);
+  server.on("/spiffs/format", HTTP_POST, handleSpiffsFormat);
   server.begin();
+  serverStarted = true;
 
   webSocket.begin();
   webSocket.onEvent(webSocketEvent);
+  modbusBegin();
 
   Wire.begin();
   sensorSuhu.begin();
+  if (ADS1115_ENABLED)
+    adsInit();
 
-  phSensor.update();
-  turbiditySensor.update();
-  oksigenSensor.update();
+  sensors.sampleInternal(millis(), adcIntervalMs);
   potensiometer.update();
 
   pinMode(PIN_RELAY_1, OUTPUT);
@@ -745,13 +757,20 @@ void setup()
   fastWrite(PIN_RELAY_5, HIGH);
 
   sensorSuhu.requestTemperatures();
-  suhuValue = sensorSuhu.getTempCByIndex(0);
+  float suhuAwal = sensorSuhu.getTempCByIndex(0);
+  powerInit();
+  watchdogInit();
+  if (suhuAwal == DEVICE_DISCONNECTED_C)
+  {
+    suhuAwal = suhuFallback;
+    sensors.health[CHI_SUHU].markDisconnected();
+  }
+  sensors.setValue(CHI_SUHU, suhuAwal, millis());
 }
 
 void loop()
 {
-  // Serial.println(phSensor.getVar(Analog::VOLTAGE));
-  static bool tempReady = false;
+  uint32_t loopStartUs = micros();
   static bool firstRun = false;
   if (!firstRun)
   {
@@ -759,6 +778,36 @@ void loop()
     firstRun = true;
   }
 
+  // loopStage dicatat supaya watchdog bisa melaporkan tahap yang macet
+  loopStage = STAGE_CONTROL;
+  controlTick();
+
+  loopStage = STAGE_HTTP;
+  server.handleClient();
+  loopStage = STAGE_WS;
+  webSocket.loop();
+  if (!commandQueue.empty())
+    controlTick(); // perintah baru langsung diterapkan, tidak menunggu putaran berikutnya
+  flushCommandAcks();
+  loopStage = STAGE_MQTT;
+  mqttLoop();
+  loopStage = STAGE_MODBUS;
+  modbusPoll();
+  loopStage = STAGE_SERVICE;
+  uint32_t wait = serviceJobs.run(millis());
+  uint32_t controlWait = controlJobs.msUntilNext(millis());
+  loopStage = STAGE_IDLE;
+  powerIdle(loopStartUs, controlWait < wait ? controlWait : wait);
+}
+
+/// @brief satu putaran kontrol: tulis relay, logika otomatis, baca sensor, catat data.
+/// Dipanggil dari loop() dan juga di sela-sela respons panjang (mis. /export)
+/// supaya aerator/heater tetap dikendalikan selama server sibuk.
+void controlTick()
+{
+  watchdogFeed();
+  applyCommands();
+
   fastWrite(PIN_RELAY_1, relayState[0] ? LOW : HIGH);
   fastWrite(PIN_RELAY_2, relayState[1] ? LOW : HIGH);
   fastWrite(PIN_RELAY_3, relayState[2] ? LOW : HIGH);
@@ -769,221 +818,373 @@ void loop()
   // printf(relayState[4] ? "0" : "1");
   // printf("\n");
 
+  controlJobs.run(millis());
+  updateModbusImage();
+}
+
+// ===== Job terjadwal =====
+// Urutan pendaftaran = urutan eksekusi jika beberapa job jatuh tempo bersamaan.
+void jobAuto()
+{
   // Panggil auto logic hanya saat autoMode = true
   if (autoMode)
   {
     autoRelayLogic();
   }
+}
 
-  server.handleClient();
-  webSocket.loop();
-  phSensor.update();
-  turbiditySensor.update();
-  oksigenSensor.update();
+void jobAdc()
+{
+  uint32_t now = millis();
+  float potBefore = potensiometer.getVar(Analog::PERCENT);
+  // baca, filter dan konversi kanal ADC internal yang jatuh tempo
+  uint32_t wait = sensors.sampleInternal(now, adcIntervalMs);
+  if (ADS1115_ENABLED)
+  {
+    adsPoll();
+    wait = wait < adsPollMs ? wait : adsPollMs;
+  }
   potensiometer.update();
+  // Memutar potensiometer dianggap aktivitas operator (menyalakan backlight)
+  if (fabsf(potensiometer.getVar(Analog::PERCENT) - potBefore) > 5.0f)
+    noteActivity();
+  // Job berikutnya saat kanal tercepat jatuh tempo: semua kanal stabil = CPU jarang bangun
+  controlJobs.setPeriod(adcJobId, wait > adcIntervalMs ? wait : adcIntervalMs);
+}
 
-  handlePhSensor();
-  handleTurbiditySensor();
-  handleOksigenSensor();
+void jobTempRequest()
+{
+  if (!sensors.sampler[CHI_SUHU].due(millis()))
+    return; // suhu stabil: DS18B20 dibaca dengan interval lebih jarang
+  sensorSuhu.requestTemperatures(); // Langkah 1: Minta sensor mulai mengukur (tidak menunggu)
+  // Serial.println("Meminta pembacaan suhu baru...");
+  tempReady = true; // Tandai bahwa kita sudah boleh mengambil data nanti
+}
 
-  if (millis() - lastTempRequest >= tempRequestInterval)
+void jobLog()
+{
+  if (tempReady)
   {
-    lastTempRequest = millis();
-    sensorSuhu.requestTemperatures(); // Langkah 1: Minta sensor mulai mengukur (tidak menunggu)
-    // Serial.println("Meminta pembacaan suhu baru...");
-    tempReady = true; // Tandai bahwa kita sudah boleh mengambil data nanti
+    tempReady = false;
+    float suhuBaru = sensorSuhu.getTempCByIndex(0);
+
+    if (suhuBaru == DEVICE_DISCONNECTED_C)
+    {
+      // Pertahankan nilai valid terakhir; kanal ditandai rusak sehingga
+      // aerator/heater dipaksa ke state aman oleh autoRelayLogic()
+      sensors.health[CHI_SUHU].markDisconnected();
+      // Serial.println("Sensor suhu tidak terhubung!");
+    }
+    else if (sensors.health[CHI_SUHU].update(suhuBaru, suhuBaru, millis()) & FAULT_RANGE)
+    {
+      // 85 °C (reset error) atau nilai mustahil lain tidak dipakai
+    }
+    else
+    {
+      sensors.setValue(CHI_SUHU, suhuBaru, millis());
+    }
   }
 
-  if (millis() - lastUpdate_sensor >= 50)
+  updateSensorHealth();
+
+  // Hanya dicatat jika ada kanal yang melewati deadband-nya atau heartbeat
+  uint32_t now = millis();
+  if (sensors.logDue(now))
   {
-    lastUpdate_sensor = millis();
+    sensorData.addData(now, sensors.value);
+    sensorStats.append(now, sensors.value, sensors.threshold);
+    sensors.markLogged(now);
+  }
+}
 
-    if (tempReady)
-    {
-      tempReady = false;
-      suhuValue = sensorSuhu.getTempCByIndex(0);
+void jobTurbidityCycle()
+{
+  turbidityCycleOn = !turbidityCycleOn;
+}
 
-      if (suhuValue == DEVICE_DISCONNECTED_C)
-      {
-        suhuValue = 0;
-        // Serial.println("Sensor suhu tidak terhubung!");
-      }
-      else
-      {
-        // Print nilai suhu (sekarang tidak akan memblokir lagi)
-        // Serial.printf("Suhu: %.2f °C\n", suhuValue);
-      }
-    }
+void otaRestart()
+{
+  ESP.restart();
+}
 
-    sensorData.addData(
-        phSensor.getVar(Analog::FINAL),
-        turbiditySensor.getVar(Analog::FINAL),
-        oksigenSensor.getVar(Analog::FINAL),
-        suhuValue);
+/// @brief daftarkan semua pekerjaan periodik (dipanggil awal di setup())
+void scheduleJobs()
+{
+  uint32_t now = millis();
+  controlJobs.every("auto", autoIntervalMs, jobAuto, now);
+  adcJobId = controlJobs.every("adc", adcIntervalMs, jobAdc, now);
+  controlJobs.every("tempRequest", tempRequestInterval, jobTempRequest, now);
+  controlJobs.every("log", logIntervalMs, jobLog, now);
+  controlJobs.every("doTrend", doTrendConfig.sampleIntervalMs, updateDoTrend, now);
+  controlJobs.every("turbCycle", turbidityCycleMs, jobTurbidityCycle, now);
+
+  serviceJobs.every("lcd", 500, timerLcdI2c, now);
+  serviceJobs.every("telemetry", telemetryInterval, broadcastTelemetry, now, 250); // tidak bertumpuk dengan LCD
+  serviceJobs.every("power", 10000, updatePowerStats, now);
+  serviceJobs.every("journal", 1000, journalFlush, now);
+  if (MQTT_ENABLED)
+  {
+    serviceJobs.after("mqttInit", 0, mqttInit, now);
+    serviceJobs.every("mqttSample", mqttSampleInterval, mqttSample, now);
+    serviceJobs.every("mqttConnect", 5000, mqttConnect, now);
+    serviceJobs.every("mqttDrain", 1000, mqttDrainWindow, now);
   }
-  timerLcdI2c();
 }
 
 void timerLcdI2c()
 {
-  DataNode *lastNode = sensorData.getLastNode();
-  static unsigned long lastUpdateLcd = 0;
-
-  if (millis() - lastUpdateLcd >= 500)
+  if (LOW_POWER_MODE)
   {
-    lastUpdateLcd = millis();
-
-    // Siapkan buffer untuk menampung teks per baris (16 karakter + 1 null terminator)
-    char line1[17];
-    char line2[17];
-
-    float ph_val = phSensor.getVar(Analog::FINAL);
-    float turb_val = turbiditySensor.getVar(Analog::FINAL);
-    float oks_val = oksigenSensor.getVar(Analog::FINAL);
-    int pot_val = (int)potensiometer.getVar(Analog::PERCENT);
-
-    // %-5.2f artinya: format float, lebar 5 karakter, 2 angka di belakang koma, rata kiri
-    sprintf(line1, "pH:%-5.2f C:%-5.2f", ph_val, suhuValue);
-
-    // %-4.0f artinya: format float, lebar 4 karakter, 0 angka di belakang koma, rata kiri
-    // %-3d%% artinya: format integer, lebar 3 karakter, rata kiri, diakhiri tanda %
-    sprintf(line2, "Tb:%-3.1f%%  O:%-2.1f", turb_val, oks_val);
+    bool idle = millis() - lastActivity >= lcdIdleTimeoutMs;
+    if (idle && lcdBacklightOn)
+    {
+      lcd.noBacklight();
+      lcdBacklightOn = false;
+    }
+    else if (!idle && !lcdBacklightOn)
+    {
+      lcd.backlight();
+      lcdBacklightOn = true;
+    }
+  }
 
-    // Cetak ke LCD
-    lcd.setCursor(0, 0);
-    lcd.print(line1);
+  // Empat kanal per halaman (2 per baris, sel 8 karakter "label:nilai");
+  // jika kanal lebih dari empat, halaman berganti setiap lcdPageMs
+  static const int perPage = 4;
+  static const int pages = (channelCount + perPage - 1) / perPage;
+  int page = (millis() / lcdPageMs) % pages;
 
-    lcd.setCursor(0, 1);
-    lcd.print(line2);
+  char line[2][17]; // 16 karakter + null terminator
+  for (int row = 0; row < 2; row++)
+  {
+    int len = 0;
+    for (int col = 0; col < 2; col++)
+    {
+      int i = page * perPage + row * 2 + col;
+      int width = 8 - (int)strlen(channels[i < channelCount ? i : 0].label) - 1;
+      if (i < channelCount)
+        len += snprintf(line[row] + len, sizeof(line[row]) - len, "%s:%-*.*f", channels[i].label,
+                        width > 0 ? width : 0, channels[i].decimals, sensors.value[i]);
+      if (len > 8 * (col + 1))
+        len = 8 * (col + 1); // potong nilai yang terlalu panjang
+      while (len < 8 * (col + 1))
+        line[row][len++] = ' ';
+      line[row][len] = '\0';
+    }
+    lcd.setCursor(0, row);
+    lcd.print(line[row]);
   }
 }
 
 // ===== Fungsi Penanganan HTTP =====
 
 // Fungsi untuk mengirim data sampel terakhir
-void handleLast()
+// ===== Serialisasi JSON ke buffer tetap =====
+// Penulis JSON ada di include/StatusJson.h; pembungkus di bawah mengisi state
+// global. Dipakai endpoint tunggal (/last, /thresholds, /relay-status) dan
+// /snapshot supaya isi keduanya selalu sama.
+
+bool writeRelayStatusJson(char *buf, size_t size, size_t &len)
 {
-  DataNode *lastNode = sensorData.getLastNode();
+  return writeRelayStatusJson(buf, size, len, relayState, 5, autoMode);
+}
 
-  if (!lastNode)
-  {
-    server.send(200, "application/json", "{\"ph\":null,\"turb\":null,\"oks\":null,\"suhu\":null}");
-    return;
-  }
+bool writeThresholdsJson(char *buf, size_t size, size_t &len)
+{
+  return writeThresholdsJson(buf, size, len, channels, sensors.threshold);
+}
 
-  String json = "{";
-  json += "\"ph\":" + String(lastNode->ph, 2) + ",";
-  json += "\"turb\":" + String(lastNode->turbidity, 2) + ",";
-  json += "\"oks\":" + String(lastNode->oksigen, 2) + ",";
-  json += "\"suhu\":" + String(lastNode->suhu, 2);
-  json += "}";
-  server.send(200, "application/json", json);
+bool writeLastJson(char *buf, size_t size, size_t &len)
+{
+  const DataNode *lastNode = sensorData.getLastNode();
+  // Tren DO: mg/L per jam dan detik sampai DO < threshold min kanal oks (-1 = tidak turun)
+  LastStatus status = {doTrend.slopePerHour(), doTrend.secondsToThreshold(sensors.threshold[CHI_OKS].min),
+                       powerDuty, estimateCurrentMa(), (unsigned long)watchdogMisses, spiffsOk};
+  return writeLastJson(buf, size, len, channels, lastNode ? lastNode->v : nullptr, sensors.health, status);
 }
 
-// Fungsi untuk mengirim data historis sebagai array
-void handleData()
+/// @brief kirim buffer JSON yang sudah lengkap dalam satu respons (Content-Length diketahui)
+void sendJsonBuffer(const char *buf, size_t len)
 {
-  String json = "{";
-  json += "\"ph\":" + sensorData.getChartData("ph") + ",";
-  json += "\"turb\":" + sensorData.getChartData("turb") + ",";
-  json += "\"oks\":" + sensorData.getChartData("oks") + ",";
-  json += "\"suhu\":" + sensorData.getChartData("suhu");
-  json += "}";
-  server.send(200, "application/json", json);
+  server.setContentLength(len);
+  server.send(200, "application/json", "");
+  server.sendContent(buf, len);
 }
 
-void handleSbAdmin2Css()
+void handleLast()
 {
-  File file = SPIFFS.open("/sb-admin-2.css", "r");
-  if (!file)
-  {
-    server.send(404, "text/plain", "CSS not found");
-    return;
-  }
-  server.streamFile(file, "text/css");
-  file.close();
+  char buf[160 + channelCount * 40];
+  size_t len = 0;
+  writeLastJson(buf, sizeof(buf), len);
+  sendJsonBuffer(buf, len);
 }
 
-// Tambahkan fungsi baru ini di main.cpp
-void handleScriptJs()
+// Snapshot dasbor: status relay & mode, threshold, riwayat (/data) dan sampel
+// terakhir (/last) dalam satu respons, sehingga halaman cukup satu round trip
+// saat dibuka. Diserialisasi sekali ke buffer statis lalu dikirim dengan
+// Content-Length, tanpa String sementara per field.
+void handleSnapshot()
 {
-  File file = SPIFFS.open("/script.js", "r");
-  if (!file)
+  static char buf[640 + channelCount * (128 + maxDataPoints * 8)];
+  size_t len = 0;
+  bool ok = appendf(buf, sizeof(buf), len, "{\"t\":%lu,\"status\":", (unsigned long)millis()) &&
+            writeRelayStatusJson(buf, sizeof(buf), len) &&
+            appendf(buf, sizeof(buf), len, ",\"thresholds\":") &&
+            writeThresholdsJson(buf, sizeof(buf), len) &&
+            appendf(buf, sizeof(buf), len, ",\"data\":{");
+  for (int i = 0; ok && i < channelCount; i++)
+    ok = appendf(buf, sizeof(buf), len, i ? ",\"%s\":" : "\"%s\":", channels[i].key) &&
+         sensorData.writeChartData(channels[i].key, buf, sizeof(buf), len);
+  ok = ok && appendf(buf, sizeof(buf), len, "},\"last\":") &&
+       writeLastJson(buf, sizeof(buf), len) &&
+       appendf(buf, sizeof(buf), len, "}");
+  if (!ok)
   {
-    server.send(404, "text/plain", "JS not found");
+    server.send(500, "application/json", "{\"error\":\"Snapshot too large\"}");
     return;
   }
-  // Penting: Gunakan tipe konten "application/javascript"
-  server.streamFile(file, "application/javascript");
-  file.close();
+  sendJsonBuffer(buf, len);
 }
 
-// Handler untuk file chart.js
-void handleChartJs()
+// Statistik penjadwal: GET /scheduler -> per job periode, jumlah eksekusi,
+// overrun (tick terlewat) dan keterlambatan maksimum
+template <int N>
+void appendJobs(String &json, const Scheduler<N> &jobs, const char *group, bool &first)
 {
-  File file = SPIFFS.open("/chart.js", "r");
-  if (!file)
+  for (int i = 0; i < jobs.capacity(); i++)
   {
-    server.send(404, "text/plain", "chart.js not found");
-    return;
+    const typename Scheduler<N>::Job &j = jobs.job(i);
+    if (!j.active)
+      continue;
+    char item[160];
+    snprintf(item, sizeof(item),
+             "%s{\"group\":\"%s\",\"name\":\"%s\",\"period\":%lu,\"runs\":%lu,\"overruns\":%lu,\"maxLate\":%lu}",
+             first ? "" : ",", group, j.name, (unsigned long)j.period, (unsigned long)j.runs,
+             (unsigned long)j.overruns, (unsigned long)j.maxLateMs);
+    json += item;
+    first = false;
   }
-  server.streamFile(file, "application/javascript");
-  file.close();
 }
 
-// Handler untuk file luxon.js
-void handleLuxonJs()
+void handleScheduler()
 {
-  File file = SPIFFS.open("/luxon.js", "r");
-  if (!file)
-  {
-    server.send(404, "text/plain", "luxon.js not found");
-    return;
-  }
-  server.streamFile(file, "application/javascript");
-  file.close();
+  String json = "[";
+  bool first = true;
+  appendJobs(json, controlJobs, "control", first);
+  appendJobs(json, serviceJobs, "service", first);
+  json += "]";
+  server.send(200, "application/json", json);
 }
 
-// Handler untuk file chartjs-adapter-luxon.js
-void handleAdapterLuxonJs()
+// Fungsi untuk mengirim data historis sebagai array
+void handleData()
 {
-  File file = SPIFFS.open("/chartjs-adapter-luxon.js", "r");
-  if (!file)
+  String json = "{";
+  for (int i = 0; i < channelCount; i++)
   {
-    server.send(404, "text/plain", "adapter-luxon.js not found");
-    return;
+    if (i)
+      json += ",";
+    json += "\"" + String(channels[i].key) + "\":" + sensorData.getChartData(channels[i].key);
   }
-  server.streamFile(file, "application/javascript");
-  file.close();
+  json += "}";
+  server.send(200, "application/json", json);
 }
 
-// Handler untuk file chartjs-plugin-streaming.js
-void handleStreamingPluginJs()
+// Export riwayat: GET /export?from=<ms>&to=<ms>&format=csv|ndjson
+// Timestamp dalam millis() sejak boot; nilai millis() saat ini dikirim di header X-Device-Millis.
+// Respons dikirim dengan chunked transfer encoding dari buffer tetap, sehingga
+// memori konstan berapapun panjang rentangnya, dan controlTick() dijalankan
+// di antara chunk agar kontrol relay tidak terhenti.
+void handleExport()
 {
-  File file = SPIFFS.open("/chartjs-plugin-streaming.js", "r");
-  if (!file)
+  uint32_t now = millis();
+  uint32_t to = server.hasArg("to") ? (uint32_t)strtoul(server.arg("to").c_str(), nullptr, 10) : now;
+  // Tanpa from: mulai dari sampel tertua. Bukan 0, karena setelah ~24,8 hari
+  // millis() 0 berada "di depan" to pada perbandingan wrap-safe di bawah.
+  History::Reader oldest = sensorData.begin();
+  uint32_t from = server.hasArg("from") ? (uint32_t)strtoul(server.arg("from").c_str(), nullptr, 10)
+                  : oldest.get()          ? oldest.get()->t
+                                          : to;
+  String format = server.hasArg("format") ? server.arg("format") : "csv";
+
+  bool csv;
+  if (format == "csv")
+    csv = true;
+  else if (format == "ndjson")
+    csv = false;
+  else
   {
-    server.send(404, "text/plain", "streaming-plugin.js not found");
+    server.send(400, "application/json", "{\"error\":\"Invalid format\"}");
+    return;
+  }
+  // Selisih bertanda seperti /stats dan HistoryStore: rentang yang melewati
+  // wrap millis() (~49 hari) tetap valid
+  if ((int32_t)(to - from) < 0)
+  {
+    server.send(400, "application/json", "{\"error\":\"Invalid range\"}");
     return;
   }
-  server.streamFile(file, "application/javascript");
-  file.close();
-}
+
+  server.sendHeader("X-Device-Millis", String(now));
+  server.sendHeader("Cache-Control", "no-store");
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, csv ? "text/csv" : "application/x-ndjson", "");
+
+  char buf[exportChunkSize];
+  size_t len = 0;
+  if (csv)
+  {
+    appendf(buf, sizeof(buf), len, "t_ms");
+    for (int i = 0; i < channelCount; i++)
+      appendf(buf, sizeof(buf), len, ",%s", channels[i].key);
+    appendf(buf, sizeof(buf), len, "\n");
+  }
+
+  // Iterasi memakai cursor timestamp: controlTick() di antara chunk bisa
+  // menambah sampel atau membuang blok tertua dari riwayat.
+  History::Reader reader = sensorData.firstAfter(from, true);
+  uint32_t cursor = from;
+  const DataNode *node;
+  while ((node = reader.get()) && (int32_t)(node->t - to) <= 0)
+  {
+    char line[24 + channelCount * 24];
+    size_t n = 0;
+    bool ok = appendf(line, sizeof(line), n, csv ? "%lu" : "{\"t\":%lu", (unsigned long)node->t);
+    for (int i = 0; ok && i < channelCount; i++)
+      ok = csv ? appendf(line, sizeof(line), n, ",%.2f", node->v[i])
+               : appendf(line, sizeof(line), n, ",\"%s\":%.2f", channels[i].key, node->v[i]);
+    if (!ok || !appendf(line, sizeof(line), n, csv ? "\n" : "}\n"))
+      break;
+
+    if (len + n > sizeof(buf))
+    {
+      server.sendContent(buf, len);
+      len = 0;
+      controlTick();
+      if (!server.client().connected())
+        return;
+      reader = sensorData.firstAfter(cursor);
+      continue;
+    }
+
+    memcpy(buf + len, line, n);
+    len += n;
+    cursor = node->t;
+    reader.next();
+  }
+
+  if (len > 0)
+    server.sendContent(buf, len);
+  server.sendContent(""); // chunk penutup
+}
 
 /// Handler untuk memberikan status semua relay dalam JSON (tambahkan mode + koneksi)
 void handleRelayStatus()
 {
-  String json = "{";
-  for (int i = 0; i < 5; ++i)
-  { // <-- perbarui ke 5 relay
-    json += "\"relay" + String(i + 1) + "\":" + (relayState[i] ? "true" : "false");
-    if (i < 4)
-      json += ",";
-  }
-  json += ",\"mode\":\"";
-  json += (autoMode ? "auto" : "manual");
-  json += "\"}";
-  server.send(200, "application/json", json);
+  char buf[160];
+  size_t len = 0;
+  writeRelayStatusJson(buf, sizeof(buf), len);
+  sendJsonBuffer(buf, len);
 }
 
 // Handler untuk mendapatkan mode
@@ -1005,11 +1206,7 @@ void handleModePost()
     return;
   }
   String mode = server.arg("mode");
-  if (mode == "auto")
-    autoMode = true;
-  else if (mode == "manual")
-    autoMode = false;
-  else
+  if (!applyMode(mode.c_str(), JS_HTTP))
   {
     server.send(400, "application/json", "{\"error\":\"Invalid mode\"}");
     return;
@@ -1024,13 +1221,10 @@ void handleModePost()
 
 void handleGetThresholds()
 {
-  String json = "{";
-  json += "\"ph\":{\"min\":" + String(phThreshold.min) + ",\"max\":" + String(phThreshold.max) + "},";
-  json += "\"turb\":{\"min\":" + String(turbidityThreshold.min) + ",\"max\":" + String(turbidityThreshold.max) + "},";
-  json += "\"oks\":{\"min\":" + String(oksigenThreshold.min) + ",\"max\":" + String(oksigenThreshold.max) + "},";
-  json += "\"suhu\":{\"min\":" + String(suhuThreshold.min) + ",\"max\":" + String(suhuThreshold.max) + "}";
-  json += "}";
-  server.send(200, "application/json", json);
+  char buf[8 + channelCount * 48];
+  size_t len = 0;
+  writeThresholdsJson(buf, sizeof(buf), len);
+  sendJsonBuffer(buf, len);
 }
 
 void handleSetThresholds()
@@ -1042,7 +1236,7 @@ void handleSetThresholds()
   }
 
   String body = server.arg("plain");
-  StaticJsonDocument<200> doc;
+  JsonDocument doc;
   DeserializationError error = deserializeJson(doc, body);
 
   if (error)
@@ -1051,52 +1245,124 @@ void handleSetThresholds()
     return;
   }
 
-  const char *sensor = doc["sensor"];
-  float min_val = doc["min"];
-  float max_val = doc["max"];
-
-  if (!sensor || min_val >= max_val)
+  const char *reason;
+  if (!applyThresholdsJson(doc.as<JsonVariantConst>(), &reason))
   {
-    server.send(400, "text/plain", "Invalid parameters");
+    server.send(400, "text/plain", reason);
     return;
   }
 
-  // Update appropriate threshold
-  if (strcmp(sensor, "ph") == 0)
+  server.send(200, "text/plain", "OK");
+}
+/// @brief kirim aset tertanam langsung dari pointer flash. ETag = hash isi,
+/// jadi browser memakai cache sampai firmware membawa versi baru.
+void sendWebAsset(const WebAsset &asset)
+{
+  server.sendHeader("ETag", asset.etag);
+  server.sendHeader("Cache-Control", "no-cache");
+  if (server.header("If-None-Match") == asset.etag)
   {
-    phThreshold = {min_val, max_val};
+    server.send(304);
+    return;
   }
-  else if (strcmp(sensor, "turb") == 0)
+  if (asset.gzip)
+    server.sendHeader("Content-Encoding", "gzip"); // semua browser dasbor mendukung gzip
+  server.setContentLength(asset.length);
+  server.send(200, asset.mime, "");
+  for (uint32_t off = 0; off < asset.length; off += assetChunkSize)
   {
-    turbidityThreshold = {min_val, max_val};
+    uint32_t n = asset.length - off < assetChunkSize ? asset.length - off : assetChunkSize;
+    server.sendContent((const char *)asset.data + off, n);
+    controlTick();
+    if (!server.client().connected())
+      return;
   }
-  else if (strcmp(sensor, "oks") == 0)
+}
+
+void handleRoot()
+{
+  sendWebAsset(*findWebAsset("/index.html")); // dijamin ada oleh tools/embed_assets.py
+}
+
+void handleStatic()
+{
+  const WebAsset *asset = server.method() == HTTP_GET ? findWebAsset(server.uri().c_str()) : nullptr;
+  if (!asset)
   {
-    oksigenThreshold = {min_val, max_val};
+    server.send(404, "text/plain", "Not found");
+    return;
   }
-  else if (strcmp(sensor, "suhu") == 0)
+  sendWebAsset(*asset);
+}
+
+// Telemetri periodik ke semua client WebSocket, dipakai collector multi-kit di host
+// (tools/collector). Dasbor mengabaikan field yang tidak dikenal.
+void broadcastTelemetry()
+{
+  if (webSocket.connectedClients() == 0)
+    return;
+
+  char json[128 + channelCount * 24];
+  size_t n = 0;
+  bool ok = appendf(json, sizeof(json), n, "{\"t\":%lu", (unsigned long)millis());
+  for (int i = 0; ok && i < channelCount; i++)
+    ok = appendf(json, sizeof(json), n, ",\"%s\":%.2f", channels[i].key, sensors.value[i]);
+  ok = ok && appendf(json, sizeof(json), n, ",\"oksSlope\":%.2f,\"oksEta\":%.0f,\"duty\":%.3f,\"mA\":%.0f}",
+                     doTrend.slopePerHour(),
+                     doTrend.secondsToThreshold(sensors.threshold[CHI_OKS].min),
+                     powerDuty,
+                     estimateCurrentMa());
+  if (ok)
+    webSocket.broadcastTXT(json, n);
+}
+
+// Kirim alarm saat status fault sebuah sensor berubah, mis.
+// {"alarm":{"sensor":"oks","faults":["stuck"],"active":true}}
+void broadcastSensorAlarm(const char *key, uint8_t faults, bool active)
+{
+  noteActivity(); // alarm menyalakan kembali backlight LCD
+  char json[160];
+  int n = snprintf(json, sizeof(json), "{\"alarm\":{\"sensor\":\"%s\",\"faults\":[", key);
+  bool first = true;
+  for (uint8_t bit = 1; bit && n < (int)sizeof(json); bit <<= 1)
   {
-    suhuThreshold = {min_val, max_val};
+    if (!(faults & bit))
+      continue;
+    n += snprintf(json + n, sizeof(json) - n, first ? "\"%s\"" : ",\"%s\"", SensorHealth::faultName(bit));
+    first = false;
   }
-  else
+  if (n < (int)sizeof(json))
+    n += snprintf(json + n, sizeof(json) - n, "],\"active\":%s}}", active ? "true" : "false");
+  if (n < (int)sizeof(json))
+    webSocket.broadcastTXT(json, n);
+}
+
+// Evaluasi kesehatan sensor analog (dipanggil tiap 50 ms, hanya kanal dengan
+// sampel baru) dan kirim alarm saat berubah
+void updateSensorHealth()
+{
+  static uint8_t lastFaults[channelCount] = {};
+
+  for (int i = 0; i < channelCount; i++)
   {
-    server.send(400, "text/plain", "Invalid sensor");
-    return;
+    uint8_t faults = sensors.updateHealth(i); // kanal SRC_EXTERNAL diperbarui saat dibaca
+    if (faults == lastFaults[i])
+      continue;
+    broadcastSensorAlarm(channels[i].key, faults ? faults : lastFaults[i], faults != 0);
+    lastFaults[i] = faults;
   }
-
-  server.send(200, "text/plain", "OK");
 }
-void handleRoot()
+
+// Sampel estimator tren DO (job "doTrend", 10 s); direset jika DO/suhu tidak valid
+// agar regresi tidak tercampur data sensor yang rusak.
+void updateDoTrend()
 {
-  // Baca file /index.html dari SPIFFS dan stream ke client
-  File file = SPIFFS.open("/index.html", "r");
-  if (!file)
+  if (!sensors.health[CHI_OKS].valid() || !sensors.health[CHI_SUHU].valid())
   {
-    server.send(500, "text/plain", "index.html not found");
+    doTrend.reset();
     return;
   }
-  server.streamFile(file, "text/html; charset=utf-8");
-  file.close();
+  doTrend.update(sensors.value[CHI_OKS], sensors.value[CHI_SUHU]);
 }
 
 // Tambahkan setelah deklarasi WebServer
@@ -1108,50 +1374,1059 @@ void webSocketEvent(uint8_t num, WStype_t type, uint8_t *payload, size_t length)
   {
     Serial.printf("[%u] Connected!\n", num);
     // Kirim status awal ke client yang baru terkoneksi
-    String status = "{";
-    for (int i = 0; i < 5; i++)
-    {
-      status += "\"relay" + String(i + 1) + "\":" + (relayState[i] ? "true" : "false");
-      if (i < 4)
-        status += ",";
-    }
-    status += ",\"mode\":\"" + String(autoMode ? "auto" : "manual") + "\"}";
-    webSocket.sendTXT(num, status);
+    char buf[128];
+    size_t len = 0;
+    writeRelayStatusJson(buf, sizeof(buf), len);
+    webSocket.sendTXT(num, buf, len);
   }
   break;
   case WStype_TEXT:
   {
-    String text = String((char *)payload);
-    if (text.startsWith("relay"))
+    noteActivity();
+    // Parse tanpa alokasi; diterapkan oleh controlTick() dalam satu tick
+    Command cmd;
+    CommandParse parsed = parseCommand(payload, length, 5, cmd);
+    cmd.client = num;
+    if (parsed == PARSE_INVALID)
+      sendCommandAck(num, cmd.seq, CMD_INVALID);
+    else if (parsed == PARSE_OK && !commandQueue.push(cmd))
+      sendCommandAck(num, cmd.seq, CMD_BUSY);
+  }
+  break;
+  default:
+    break;
+  }
+}
+
+/// @brief terapkan perintah WebSocket yang antri. Mode diterapkan lebih dulu
+/// sehingga "mode_manual relay1_on" berlaku dalam satu batch; perubahan relay
+/// saat mode otomatis menolak seluruh batch.
+void applyCommands()
+{
+  Command cmd;
+  while (commandQueue.pop(cmd))
+  {
+    bool manual = cmd.mode == CMD_MODE_KEEP ? !autoMode : cmd.mode == CMD_MODE_MANUAL;
+    uint8_t source = cmd.client == 0xFF ? JS_MODBUS : JS_WS; // 0xFF = modbusWriteCoils()
+    uint8_t status = CMD_OK;
+    if (cmd.relayMask && !manual)
+      status = CMD_AUTO_MODE;
+    else
     {
-      int relay = text[5] - '1'; // relay1 -> 0, relay2 -> 1, etc.
-      bool state = text.endsWith("on");
-      if (relay >= 0 && relay < 5 && !autoMode)
+      if (cmd.mode != CMD_MODE_KEEP)
+        setMode(cmd.mode == CMD_MODE_AUTO, source);
+      for (int i = 0; i < 5; i++)
+        if (cmd.relayMask & (1 << i))
+          setRelay(i, cmd.relayOn & (1 << i), source);
+      commandBroadcastPending = true;
+    }
+    if (cmd.seq)
+      ackQueue.push({cmd.seq, cmd.client, status}); // ack hilang jika antrian penuh; client akan timeout
+  }
+}
+
+void sendCommandAck(uint8_t client, uint32_t seq, uint8_t status)
+{
+  if (!seq)
+    return; // format lama tanpa nomor urut: tidak ada ack
+  char buf[64];
+  int n = status == CMD_OK
+              ? snprintf(buf, sizeof(buf), "{\"ack\":%lu,\"ok\":true}", (unsigned long)seq)
+              : snprintf(buf, sizeof(buf), "{\"ack\":%lu,\"ok\":false,\"error\":\"%s\"}", (unsigned long)seq,
+                         commandStatusName(status));
+  webSocket.sendTXT(client, buf, n);
+}
+
+/// @brief kirim ack hasil applyCommands() lalu satu broadcast status untuk semua perubahan
+void flushCommandAcks()
+{
+  CommandAck ack;
+  while (ackQueue.pop(ack))
+    sendCommandAck(ack.client, ack.seq, ack.status);
+  if (commandBroadcastPending)
+  {
+    commandBroadcastPending = false;
+    char buf[128];
+    size_t len = 0;
+    writeRelayStatusJson(buf, sizeof(buf), len);
+    webSocket.broadcastTXT(buf, len);
+  }
+}
+
+// ===== SPIFFS =====
+// Tidak pernah format otomatis saat mount gagal (SPIFFS.begin(true) diam-diam
+// menghapus jurnal dan spool MQTT). Mount dicoba dua kali; jika tetap gagal,
+// pencatatan ke flash nonaktif dan format hanya lewat POST /spiffs/format.
+
+bool spiffsMount()
+{
+  for (int attempt = 1; attempt <= 2; attempt++)
+  {
+    if (SPIFFS.begin(false))
+      return true;
+    Serial.printf("SPIFFS: mount gagal (percobaan %d/2)\n", attempt);
+    SPIFFS.end();
+  }
+  Serial.println("SPIFFS: tidak diformat otomatis, pencatatan ke flash nonaktif. "
+                 "POST /spiffs/format?confirm=format untuk memformat (jurnal & spool MQTT terhapus)");
+  return false;
+}
+
+// Format eksplisit. Butuh beberapa detik; watchdog memegang relay di pola aman
+// selama itu. Kejadian dicatat di jurnal (sumber "fs") setelah mount ulang.
+void handleSpiffsFormat()
+{
+  if (server.arg("confirm") != "format")
+  {
+    server.send(400, "application/json", "{\"error\":\"confirm=format required\"}");
+    return;
+  }
+  Serial.println("SPIFFS: format diminta lewat HTTP");
+  SPIFFS.end();
+  spiffsOk = SPIFFS.format() && SPIFFS.begin(false);
+  Serial.printf("SPIFFS: format %s\n", spiffsOk ? "selesai" : "gagal");
+  journalRecord(JS_FS, journalState(), journalState(), -1, millis());
+  server.send(spiffsOk ? 200 : 500, "application/json", spiffsOk ? "{\"spiffs\":true}" : "{\"spiffs\":false}");
+}
+
+// ===== Jurnal kejadian relay/mode =====
+// File jurnal berisi JournalEvent mentah berurutan naik menurut seq, sehingga
+// record ke-k ada di offset k * 16 dan pencarian seq cukup binary search.
+
+/// @brief lanjutkan nomor urut dari record terakhir di flash, lalu catat boot
+void journalBegin()
+{
+  const char *paths[] = {journalPath, journalOldPath};
+  for (int i = 0; spiffsOk && i < 2; i++)
+  {
+    File f = SPIFFS.open(paths[i], FILE_READ);
+    if (!f)
+      continue;
+    size_t count = f.size() / sizeof(JournalEvent);
+    JournalEvent last;
+    bool ok = count > 0 && f.seek((count - 1) * sizeof(JournalEvent)) &&
+              f.read((uint8_t *)&last, sizeof(last)) == sizeof(last);
+    f.close();
+    if (ok)
+    {
+      journal.resume(last.seq + 1);
+      break;
+    }
+  }
+  journalRecord(JS_BOOT, 0, journalState(), -1, millis());
+}
+
+/// @brief job "journal": tulis kejadian yang menunggu ke SPIFFS dalam satu batch
+void journalFlush()
+{
+  uint32_t pending = journal.pending();
+  if (!pending || !spiffsOk)
+    return;
+  const JournalEvent *oldest = journal.at(journal.nextSeq() - pending);
+  if (pending < journalFlushBatch && millis() - oldest->t < journalFlushMaxAgeMs)
+    return;
+
+  File f = SPIFFS.open(journalPath, FILE_APPEND);
+  if (f && f.size() + pending * sizeof(JournalEvent) > journalMaxBytes)
+  {
+    f.close();
+    SPIFFS.remove(journalOldPath);
+    SPIFFS.rename(journalPath, journalOldPath);
+    f = SPIFFS.open(journalPath, FILE_APPEND);
+  }
+  if (!f)
+    return; // coba lagi di job berikutnya; ring menampung sampai journalCapacity
+
+  const JournalEvent *span;
+  size_t n;
+  while ((n = journal.pendingSpan(span)) > 0)
+  {
+    size_t bytes = n * sizeof(JournalEvent);
+    size_t written = f.write((const uint8_t *)span, bytes);
+    journal.markFlushed(written / sizeof(JournalEvent));
+    if (written != bytes)
+      break; // flash penuh
+  }
+  f.close();
+}
+
+/// @brief posisikan f di record pertama dengan seq >= from; false jika tidak ada
+bool journalFileSeek(File &f, uint32_t from)
+{
+  size_t count = f.size() / sizeof(JournalEvent);
+  size_t lo = 0, hi = count;
+  JournalEvent e;
+  while (lo < hi)
+  {
+    size_t mid = (lo + hi) / 2;
+    if (!f.seek(mid * sizeof(JournalEvent)) || f.read((uint8_t *)&e, sizeof(e)) != sizeof(e))
+      return false;
+    if ((int32_t)(e.seq - from) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo < count && f.seek(lo * sizeof(JournalEvent));
+}
+
+bool writeJournalEventJson(char *buf, size_t size, size_t &len, const JournalEvent &e, bool first)
+{
+  return writeJournalEventJson(buf, size, len, channels, e, first);
+}
+
+// Statistik riwayat: GET /stats?channel=<key>&from=<ms>&to=<ms>
+// Per kanal min/max, rata-rata berbobot waktu, durasi dan jumlah sampel di luar
+// threshold dari indeks agregat (include/HistoryStats.h), O(log n) tanpa memindai
+// sampel. Tanpa channel: semua kanal; tanpa from: 24 jam terakhir; tanpa to: sekarang.
+// Jendela dibulatkan ke bucket 10 menit, "from"/"to" di respons adalah jendela
+// yang benar-benar dipakai (millis()).
+void handleStats()
+{
+  uint32_t now = millis();
+  uint32_t to = server.hasArg("to") ? (uint32_t)strtoul(server.arg("to").c_str(), nullptr, 10) : now;
+  uint32_t from = server.hasArg("from") ? (uint32_t)strtoul(server.arg("from").c_str(), nullptr, 10)
+                                        : to - statsBucketMs * statsBuckets;
+  int only = -1;
+  if (server.hasArg("channel"))
+  {
+    only = channels.indexOf(server.arg("channel").c_str());
+    if (only < 0)
+    {
+      server.send(400, "application/json", "{\"error\":\"Unknown channel\"}");
+      return;
+    }
+  }
+  if ((int32_t)(to - from) < 0)
+  {
+    server.send(400, "application/json", "{\"error\":\"Invalid range\"}");
+    return;
+  }
+
+  StatsResult r;
+  if (!sensorStats.query(only >= 0 ? only : 0, from, to, r))
+  {
+    server.send(404, "application/json", "{\"error\":\"No data in range\"}");
+    return;
+  }
+  char buf[128 + channelCount * 128];
+  size_t len = 0;
+  bool ok = appendf(buf, sizeof(buf), len,
+                    "{\"now\":%lu,\"from\":%lu,\"to\":%lu,\"bucketS\":%lu,\"samples\":%lu,\"stats\":{",
+                    (unsigned long)now, (unsigned long)r.fromMs, (unsigned long)r.toMs,
+                    (unsigned long)(statsBucketMs / 1000), (unsigned long)r.samples);
+  for (int i = 0; ok && i < channelCount; i++)
+  {
+    if (only >= 0 && i != only)
+      continue;
+    ok = sensorStats.query(i, from, to, r) &&
+         writeStatsJson(buf, sizeof(buf), len, channels[i].key, r, only >= 0 || i == 0);
+  }
+  if (!ok || !appendf(buf, sizeof(buf), len, "}}"))
+  {
+    server.send(500, "application/json", "{\"error\":\"Stats too large\"}");
+    return;
+  }
+  sendJsonBuffer(buf, len);
+}
+
+// Jurnal: GET /events?from=<seq>&limit=<n>
+// Tanpa from: limit kejadian terakhir. Kejadian lama dibaca dari file jurnal,
+// yang belum di-flush dari RAM. "next" dipakai sebagai from halaman berikutnya.
+// Dikirim chunked dari buffer tetap dengan controlTick() di antara chunk.
+void handleEvents()
+{
+  uint32_t limit = server.hasArg("limit") ? (uint32_t)strtoul(server.arg("limit").c_str(), nullptr, 10) : 50;
+  if (limit < 1 || limit > journalPageMax)
+  {
+    server.send(400, "application/json", "{\"error\":\"Invalid limit\"}");
+    return;
+  }
+  uint32_t end = journal.nextSeq();
+  uint32_t cursor = server.hasArg("from") ? (uint32_t)strtoul(server.arg("from").c_str(), nullptr, 10)
+                                          : (end > limit ? end - limit : 0);
+
+  server.sendHeader("Cache-Control", "no-store");
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+
+  char buf[exportChunkSize];
+  size_t len = 0;
+  appendf(buf, sizeof(buf), len, "{\"now\":%lu,\"events\":[", (unsigned long)millis());
+  uint32_t count = 0;
+
+  // Kejadian yang sudah keluar dari ring: file lama dulu, lalu file aktif
+  const char *paths[] = {journalOldPath, journalPath};
+  for (int i = 0; i < 2 && count < limit && !journal.at(cursor); i++)
+  {
+    File f = SPIFFS.open(paths[i], FILE_READ);
+    if (!f)
+      continue;
+    JournalEvent e;
+    if (journalFileSeek(f, cursor))
+      while (count < limit && f.read((uint8_t *)&e, sizeof(e)) == sizeof(e) && !journal.at(e.seq))
       {
-        setRelay(relay, state);
-        // Broadcast status baru ke semua client
-        String status = "{";
-        for (int i = 0; i < 5; i++)
+        char line[160];
+        size_t n = 0;
+        if (!writeJournalEventJson(line, sizeof(line), n, e, count == 0))
+          break;
+        if (len + n > sizeof(buf))
         {
-          status += "\"relay" + String(i + 1) + "\":" + (relayState[i] ? "true" : "false");
-          if (i < 4)
-            status += ",";
+          server.sendContent(buf, len);
+          len = 0;
+          controlTick(); // tidak menyentuh file jurnal (flush hanya dari loop())
+          if (!server.client().connected())
+          {
+            f.close();
+            return;
+          }
         }
-        status += ",\"mode\":\"" + String(autoMode ? "auto" : "manual") + "\"}";
-        webSocket.broadcastTXT(status);
+        memcpy(buf + len, line, n);
+        len += n;
+        cursor = e.seq + 1;
+        count++;
       }
+    f.close();
+  }
+
+  // Sisanya dari RAM; kejadian yang hilang (ring penuh sebelum flush) dilompati
+  if ((int32_t)(cursor - journal.oldestSeq()) < 0)
+    cursor = journal.oldestSeq();
+  while (count < limit)
+  {
+    const JournalEvent *p = journal.at(cursor);
+    if (!p)
+      break;
+    JournalEvent e = *p; // controlTick() di bawah bisa menimpa slot ring
+    char line[160];
+    size_t n = 0;
+    if (!writeJournalEventJson(line, sizeof(line), n, e, count == 0))
+      break;
+    if (len + n > sizeof(buf))
+    {
+      server.sendContent(buf, len);
+      len = 0;
+      controlTick();
+      if (!server.client().connected())
+        return;
+      if ((int32_t)(cursor - journal.oldestSeq()) < 0)
+        cursor = journal.oldestSeq();
+      continue;
     }
-    else if (text == "mode_auto")
+    memcpy(buf + len, line, n);
+    len += n;
+    cursor++;
+    count++;
+  }
+
+  char tail[96];
+  size_t n = 0;
+  appendf(tail, sizeof(tail), n, "],\"next\":%lu,\"dropped\":%lu}", (unsigned long)cursor,
+          (unsigned long)journal.dropped());
+  if (len + n > sizeof(buf))
+  {
+    server.sendContent(buf, len);
+    len = 0;
+  }
+  memcpy(buf + len, tail, n);
+  len += n;
+  server.sendContent(buf, len);
+  server.sendContent(""); // chunk penutup
+}
+
+// ===== Modbus TCP =====
+// Input register : 0..N-1 nilai kanal x100 (int16, 0x8000 = tidak valid),
+//                  N..2N-1 bitmask fault kanal, 2N bitmask relay, 2N+1 mode (1 = auto),
+//                  2N+2..2N+3 uptime detik (word tinggi dulu)
+// Holding register: 2i / 2i+1 = threshold min / max kanal i x100 (int16)
+// Coil           : 0..4 relay1..relay5, 5 = mode otomatis
+// Discrete input : 0..N-1 kanal sedang fault
+const int modbusInputCount = channelCount * 2 + 4;
+const int modbusHoldingCount = channelCount * 2;
+const int modbusCoilCount = 6;
+typedef ModbusSlave<modbusInputCount, modbusHoldingCount, modbusCoilCount, channelCount> Modbus;
+
+uint8_t modbusWriteCoils(uint16_t first, uint16_t count, const uint8_t *values);
+uint8_t modbusWriteRegisters(uint16_t first, uint16_t count, const uint16_t *values);
+
+Modbus modbus({modbusWriteCoils, modbusWriteRegisters});
+WiFiServer modbusServer(modbusPort);
+
+struct ModbusConnection
+{
+  WiFiClient client;
+  uint8_t buf[modbusMaxAdu];
+  size_t len;
+  unsigned long lastMs;
+};
+ModbusConnection modbusConnections[modbusMaxClients];
+
+int16_t modbusScaled(float v)
+{
+  if (isnan(v) || v > 327.67f || v < -327.67f)
+    return INT16_MIN;
+  return (int16_t)lroundf(v * 100.0f);
+}
+
+/// @brief salin state kontrol ke register image; dipanggil di akhir controlTick()
+void updateModbusImage()
+{
+  uint16_t relayMask = 0;
+  for (int i = 0; i < 5; i++)
+  {
+    relayMask |= relayState[i] << i;
+    modbus.setCoil(i, relayState[i]);
+  }
+  modbus.setCoil(5, autoMode);
+  for (int i = 0; i < channelCount; i++)
+  {
+    uint8_t faults = sensors.health[i].faults();
+    modbus.setInput(i, (uint16_t)modbusScaled(sensors.value[i]));
+    modbus.setInput(channelCount + i, faults);
+    modbus.setDiscrete(i, faults != 0);
+    modbus.setHolding(2 * i, (uint16_t)modbusScaled(sensors.threshold[i].min));
+    modbus.setHolding(2 * i + 1, (uint16_t)modbusScaled(sensors.threshold[i].max));
+  }
+  uint32_t uptime = millis() / 1000;
+  modbus.setInput(2 * channelCount, relayMask);
+  modbus.setInput(2 * channelCount + 1, autoMode);
+  modbus.setInput(2 * channelCount + 2, (uint16_t)(uptime >> 16));
+  modbus.setInput(2 * channelCount + 3, (uint16_t)uptime);
+}
+
+/// @brief coil relay/mode lewat antrian perintah yang sama dengan WebSocket,
+/// jadi satu permintaan FC15 diterapkan utuh dalam satu tick
+uint8_t modbusWriteCoils(uint16_t first, uint16_t count, const uint8_t *values)
+{
+  Command cmd = {0, 0xFF, 0, 0, CMD_MODE_KEEP};
+  for (uint16_t k = 0; k < count; k++)
+  {
+    int coil = first + k;
+    bool on = values[k >> 3] & (1 << (k & 7));
+    if (coil < 5)
     {
-      autoMode = true;
-      webSocket.broadcastTXT("{\"mode\":\"auto\"}");
+      cmd.relayMask |= 1 << coil;
+      if (on)
+        cmd.relayOn |= 1 << coil;
     }
-    else if (text == "mode_manual")
+    else
+      cmd.mode = on ? CMD_MODE_AUTO : CMD_MODE_MANUAL;
+  }
+  bool manual = cmd.mode == CMD_MODE_KEEP ? !autoMode : cmd.mode == CMD_MODE_MANUAL;
+  if (cmd.relayMask && !manual)
+    return MB_DEVICE_FAILURE; // relay hanya bisa diubah di mode manual
+  noteActivity();
+  return commandQueue.push(cmd) ? MB_OK : MB_BUSY;
+}
+
+/// @brief threshold x100; semua kanal yang tersentuh divalidasi dulu (min < max)
+uint8_t modbusWriteRegisters(uint16_t first, uint16_t count, const uint16_t *values)
+{
+  threshold_t next[channelCount];
+  memcpy(next, sensors.threshold, sizeof(next));
+  for (uint16_t k = 0; k < count; k++)
+  {
+    int reg = first + k;
+    if ((int16_t)values[k] == INT16_MIN)
+      return MB_ILLEGAL_VALUE;
+    float v = (int16_t)values[k] / 100.0f;
+    if (reg & 1)
+      next[reg / 2].max = v;
+    else
+      next[reg / 2].min = v;
+  }
+  for (int i = 0; i < channelCount; i++)
+    if (!(next[i].min < next[i].max))
+      return MB_ILLEGAL_VALUE;
+  memcpy(sensors.threshold, next, sizeof(next));
+  return MB_OK;
+}
+
+void modbusBegin()
+{
+  modbusServer.begin();
+  modbusServer.setNoDelay(true);
+}
+
+/// @brief terima koneksi dan layani ADU yang sudah lengkap; tidak pernah menunggu data
+void modbusPoll()
+{
+  static uint8_t resp[modbusMaxAdu];
+  if (modbusServer.hasClient())
+  {
+    WiFiClient incoming = modbusServer.accept();
+    int slot = -1;
+    for (int i = 0; i < modbusMaxClients && slot < 0; i++)
+      if (!modbusConnections[i].client.connected())
+        slot = i;
+    if (slot < 0)
+      incoming.stop(); // semua slot terpakai
+    else
+    {
+      modbusConnections[slot].client = incoming;
+      modbusConnections[slot].len = 0;
+      modbusConnections[slot].lastMs = millis();
+    }
+  }
+
+  for (int i = 0; i < modbusMaxClients; i++)
+  {
+    ModbusConnection &c = modbusConnections[i];
+    if (!c.client.connected())
+      continue;
+    int avail = c.client.available();
+    if (avail > 0)
+    {
+      size_t room = sizeof(c.buf) - c.len;
+      int got = c.client.read(c.buf + c.len, (size_t)avail < room ? avail : room);
+      if (got > 0)
+      {
+        c.len += got;
+        c.lastMs = millis();
+      }
+    }
+    int frame;
+    while ((frame = Modbus::frameLength(c.buf, c.len)) > 0)
+    {
+      size_t n = modbus.handle(c.buf, frame, resp);
+      c.client.write(resp, n);
+      c.len -= frame;
+      memmove(c.buf, c.buf + frame, c.len);
+    }
+    if (frame < 0 || millis() - c.lastMs > modbusIdleTimeoutMs)
+    {
+      c.client.stop(); // header rusak atau klien diam
+      c.len = 0;
+    }
+  }
+}
+
+// ===== MQTT (store-and-forward) =====
+// Batch, antrian RAM, spool dan drain terkontrol ada di include/MqttForwarder.h
+// (diuji di host dengan broker tiruan, tools/mqtt). Di sini hanya adaptor
+// SPIFFS untuk spool dan PubSubClient untuk publish.
+struct SpiffsSpool
+{
+  const char *path;
+
+  size_t size()
+  {
+    if (!SPIFFS.exists(path))
+      return 0;
+    File f = SPIFFS.open(path, FILE_READ);
+    size_t n = f ? f.size() : 0;
+    f.close();
+    return n;
+  }
+
+  bool append(const char *data, size_t len)
+  {
+    File f = SPIFFS.open(path, FILE_APPEND);
+    if (!f)
+      return false;
+    bool ok = f.write((const uint8_t *)data, len) == len;
+    f.close();
+    return ok;
+  }
+
+  int readLine(size_t offset, char *buf, size_t size)
+  {
+    File f = SPIFFS.open(path, FILE_READ);
+    if (!f || offset >= f.size())
+    {
+      if (f)
+        f.close();
+      return -1;
+    }
+    f.seek(offset);
+    size_t n = 0;
+    int c;
+    while ((c = f.read()) >= 0 && c != '\n' && n < size)
+      buf[n++] = (char)c;
+    f.close();
+    return (int)n;
+  }
+
+  void remove() { SPIFFS.remove(path); }
+};
+
+typedef MqttForwarder<channelCount, mqttBatchSize, SpiffsSpool, mqttQueueSlots> MqttStore;
+
+// Socket broker untuk PubSubClient. connect() tanpa batas waktu memakai default
+// WiFiClient (3 s); di sini dibatasi mqttConnectTimeoutMs. Setelah CONNECT terkirim,
+// PubSubClient menunggu CONNACK dengan busy-loop available() sampai setSocketTimeout;
+// selama waitingReply kontrol tetap jalan di sela polling (seperti chunk OTA), jadi
+// reconnect ke broker yang lambat tidak memicu watchdog.
+// mqtt_host sebaiknya alamat IP: lookup DNS di connect() tidak ikut dibatasi.
+class MqttNetClient : public WiFiClient
+{
+public:
+  using WiFiClient::connect;
+  int connect(IPAddress ip, uint16_t port) override { return WiFiClient::connect(ip, port, mqttConnectTimeoutMs); }
+  int connect(const char *host, uint16_t port) override { return WiFiClient::connect(host, port, mqttConnectTimeoutMs); }
+
+  int available() override
+  {
+    int n = WiFiClient::available();
+    if (n == 0 && waitingReply)
+      controlTick();
+    return n;
+  }
+
+  bool waitingReply = false;
+};
+
+MqttNetClient mqttNet;
+PubSubClient mqtt(mqttNet);
+SpiffsSpool mqttSpool = {"/mqtt-spool.txt"};
+MqttStore mqttStore(channels, mqttSpool, mqtt_topic_prefix, mqttSampleInterval, mqttDrainPerSecond,
+                    mqttSpoolMaxBytes);
+
+void mqttPublishRelay(int idx, bool state)
+{
+  if (!MQTT_ENABLED)
+    return;
+  char payload[48];
+  int n = snprintf(payload, sizeof(payload), "{\"t\":%lu,\"relay%d\":%s}",
+                   (unsigned long)millis(), idx + 1, state ? "true" : "false");
+  mqttStore.enqueue("relay", payload, n);
+}
+
+// Mirror dari handler HTTP/WebSocket: <prefix>/cmd/mode, /cmd/relay, /cmd/thresholds
+void mqttCallback(char *topic, uint8_t *payload, unsigned int length)
+{
+  char text[64 + channelCount * 48]; // cukup untuk threshold massal semua kanal
+  if (length >= sizeof(text))
+    return;
+  memcpy(text, payload, length);
+  text[length] = '\0';
+
+  const char *cmd = strstr(topic, "/cmd/");
+  if (!cmd)
+    return;
+  cmd += 5;
+
+  if (strcmp(cmd, "mode") == 0)
+  {
+    applyMode(text, JS_MQTT);
+  }
+  else if (strcmp(cmd, "relay") == 0)
+  {
+    // format sama dengan WebSocket: "relay3_on" / "relay3_off"
+    char *sep = strchr(text, '_');
+    if (!sep || autoMode)
+      return;
+    *sep = '\0';
+    int idx = relayIndexFromName(text);
+    if (idx < 0)
+      return;
+    if (strcmp(sep + 1, "on") == 0)
+      setRelay(idx, true, JS_MQTT);
+    else if (strcmp(sep + 1, "off") == 0)
+      setRelay(idx, false, JS_MQTT);
+  }
+  else if (strcmp(cmd, "thresholds") == 0)
+  {
+    JsonDocument doc;
+    if (deserializeJson(doc, text, length))
+      return;
+    applyThresholdsJson(doc.as<JsonVariantConst>(), nullptr);
+  }
+}
+
+void mqttInit()
+{
+  mqtt.setServer(mqtt_host, mqtt_port);
+  mqtt.setCallback(mqttCallback);
+  mqtt.setBufferSize(MqttStore::maxPacketLen);
+  mqtt.setSocketTimeout(2);
+  mqttStore.begin(); // sisa antrian dari sebelum reboot
+}
+
+// Sampling tetap berjalan walaupun broker putus, supaya data masuk antrian
+void mqttSample()
+{
+  mqttStore.sample(millis(), sensors.value);
+}
+
+void mqttConnect()
+{
+  if (mqtt.connected() || WiFi.status() != WL_CONNECTED)
+    return;
+  mqttNet.waitingReply = true;
+  bool ok = mqtt.connect(mqtt_client_id);
+  mqttNet.waitingReply = false;
+  if (!ok)
+    return;
+  char topic[48];
+  snprintf(topic, sizeof(topic), "%s/cmd/#", mqtt_topic_prefix);
+  mqtt.subscribe(topic);
+  Serial.println("MQTT terhubung");
+}
+
+void mqttDrainWindow()
+{
+  mqttStore.newWindow();
+}
+
+bool mqttPublish(const char *topic, const uint8_t *payload, size_t length)
+{
+  return mqtt.publish(topic, payload, length);
+}
+
+void mqttLoop()
+{
+  if (!MQTT_ENABLED || !mqtt.connected())
+    return;
+  mqtt.loop();
+  // Drain dengan laju terkontrol agar tidak membanjiri broker/WiFi setelah reconnect.
+  // Satu pesan per putaran loop: satu baris spool (buka, seek, baca, tutup) dan satu
+  // publish, bukan mqttDrainPerSecond sekaligus dalam satu putaran.
+  mqttStore.drain(mqttPublish, 1);
+}
+
+// ===== OTA =====
+// POST /update?sha256=<hex> (multipart, field file). Image ditulis per chunk
+// (HTTP_UPLOAD_BUFLEN) ke partisi app berikutnya; di antara chunk controlTick()
+// dipanggil supaya sensing dan autoRelayLogic tetap berjalan selama upload.
+// SHA-256 dihitung sambil jalan dan dibandingkan sebelum partisi diaktifkan.
+struct OtaSession
+{
+  bool failed;
+  bool done;
+  uint8_t expected[32];
+  mbedtls_sha256_context sha;
+  bool shaActive; // sha sudah di-init/starts dan belum di-free
+  char error[64];
+};
+OtaSession ota;
+bool otaPendingVerify = false;
+esp_timer_handle_t otaDeadlineTimer = nullptr;
+
+// arduino-esp32: jika true, app baru tidak otomatis ditandai valid saat boot;
+// otaHealthCheck() yang memutuskan valid atau rollback.
+extern "C" bool verifyRollbackLater()
+{
+  return true;
+}
+
+bool parseSha256Hex(const String &hex, uint8_t out[32])
+{
+  if (hex.length() != 64)
+    return false;
+  for (int i = 0; i < 32; i++)
+  {
+    char byteStr[3] = {hex[2 * i], hex[2 * i + 1], '\0'};
+    char *end;
+    out[i] = (uint8_t)strtoul(byteStr, &end, 16);
+    if (*end != '\0')
+      return false;
+  }
+  return true;
+}
+
+// Context SHA harus selalu di-free: pada ESP32 mbedtls memakai engine SHA
+// hardware yang tetap terkunci selama context hidup, dan init ulang context
+// yang masih aktif pada upload berikutnya membocorkannya.
+void otaShaRelease()
+{
+  if (!ota.shaActive)
+    return;
+  mbedtls_sha256_free(&ota.sha);
+  ota.shaActive = false;
+}
+
+void otaFail(const char *msg)
+{
+  otaShaRelease();
+  if (!ota.failed)
+    snprintf(ota.error, sizeof(ota.error), "%s", msg);
+  ota.failed = true;
+  Update.abort();
+}
+
+void handleUpdateUpload()
+{
+  HTTPUpload &upload = server.upload();
+  switch (upload.status)
+  {
+  case UPLOAD_FILE_START:
+    otaShaRelease(); // upload sebelumnya terputus tanpa UPLOAD_FILE_ABORTED
+    ota.failed = false;
+    ota.done = false;
+    ota.error[0] = '\0';
+    if (!server.hasArg("sha256") || !parseSha256Hex(server.arg("sha256"), ota.expected))
+    {
+      ota.failed = true;
+      snprintf(ota.error, sizeof(ota.error), "Missing or invalid sha256");
+      return;
+    }
+    mbedtls_sha256_init(&ota.sha);
+    mbedtls_sha256_starts(&ota.sha, 0);
+    ota.shaActive = true;
+    if (!Update.begin(UPDATE_SIZE_UNKNOWN))
+      otaFail(Update.errorString());
+    Serial.printf("OTA mulai: %s\n", upload.filename.c_str());
+    break;
+
+  case UPLOAD_FILE_WRITE:
+    if (ota.failed)
+      return;
+    mbedtls_sha256_update(&ota.sha, upload.buf, upload.currentSize);
+    if (Update.write(upload.buf, upload.currentSize) != upload.currentSize)
+      otaFail(Update.errorString());
+    // Kontrol tetap jalan di sela chunk. Satu chunk (~1.4 KB) paling lama memicu
+    // satu erase+tulis sektor 4 KB di Update, jauh di bawah watchdogDeadlineMs.
+    controlTick();
+    break;
+
+  case UPLOAD_FILE_END:
+  {
+    if (ota.failed)
+      return;
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&ota.sha, digest);
+    otaShaRelease();
+    if (memcmp(digest, ota.expected, sizeof(digest)) != 0)
     {
-      autoMode = false;
-      webSocket.broadcastTXT("{\"mode\":\"manual\"}");
+      otaFail("SHA-256 mismatch");
+      return;
     }
+    // Update.end() memverifikasi seluruh image di flash sebelum mengganti partisi
+    // boot (langkah terlama upload); heartbeat diperbarui dulu supaya batas
+    // watchdog penuh tersedia untuknya
+    controlTick();
+    if (!Update.end(true))
+    {
+      otaFail(Update.errorString());
+      return;
+    }
+    ota.done = true;
+    Serial.printf("OTA selesai: %u byte\n", (unsigned)upload.totalSize);
   }
   break;
+
+  case UPLOAD_FILE_ABORTED:
+    otaFail("Upload aborted");
+    break;
+  }
+}
+
+void handleUpdateDone()
+{
+  if (ota.failed || !ota.done)
+  {
+    char json[96];
+    snprintf(json, sizeof(json), "{\"error\":\"%s\"}", ota.error[0] ? ota.error : "No image");
+    server.send(400, "application/json", json);
+    return;
+  }
+  server.send(200, "application/json", "{\"status\":\"ok\",\"reboot\":true}");
+  serviceJobs.after("otaRestart", 1000, otaRestart, millis()); // beri waktu respons terkirim
+}
+
+void otaDeadlineExpired(void *)
+{
+  // Firmware baru tidak pernah sampai sehat (mis. macet di setup): kembali ke image lama
+  if (otaPendingVerify)
+    esp_ota_mark_app_invalid_rollback_and_reboot();
+}
+
+// Dipanggil paling awal di setup(): jika image ini baru di-OTA, pasang batas waktu
+// yang tetap berjalan walaupun setup() macet (esp_timer, bukan loop()).
+void otaBootCheck()
+{
+  esp_ota_img_states_t state;
+  const esp_partition_t *running = esp_ota_get_running_partition();
+  if (esp_ota_get_state_partition(running, &state) != ESP_OK || state != ESP_OTA_IMG_PENDING_VERIFY)
+    return;
+
+  otaPendingVerify = true;
+  Serial.println("OTA: image baru, menunggu health check");
+  esp_timer_create_args_t args = {};
+  args.callback = otaDeadlineExpired;
+  args.name = "ota-deadline";
+  if (esp_timer_create(&args, &otaDeadlineTimer) == ESP_OK)
+    esp_timer_start_once(otaDeadlineTimer, otaHealthTimeoutUs);
+  serviceJobs.after("otaHealth", otaHealthWindowMs, otaHealthCheck, millis());
+}
+
+// Health check boot (job one-shot "otaHealth"): loop kontrol harus berjalan selama
+// otaHealthWindowMs (sudah mencatat sampel dan watchdog tidak sedang trip), jaringan
+// dan web server harus hidup. Lolos -> valid, gagal -> rollback. SPIFFS tidak ikut
+// dinilai: mount gagal biasanya masalah flash/data, bukan image, dan firmware tetap
+// berfungsi tanpanya (lihat setup()); statusnya dilaporkan terpisah.
+void otaHealthCheck()
+{
+  otaPendingVerify = false;
+  if (otaDeadlineTimer)
+    esp_timer_stop(otaDeadlineTimer);
+
+  bool controlOk = sensorData.getLastNode() != nullptr && !watchdogTripped;
+  Serial.printf("OTA: kontrol %s, jaringan %s, server %s, SPIFFS %s\n", controlOk ? "ok" : "gagal",
+                networkOk ? "ok" : "gagal", serverStarted ? "ok" : "gagal", spiffsOk ? "ok" : "gagal (tidak dinilai)");
+  if (controlOk && networkOk && serverStarted)
+  {
+    esp_ota_mark_app_valid_cancel_rollback();
+    Serial.println("OTA: health check lolos, image ditandai valid");
+  }
+  else
+  {
+    Serial.println("OTA: health check gagal, rollback");
+    esp_ota_mark_app_invalid_rollback_and_reboot();
+  }
+}
+
+// ===== Hemat daya =====
+// loop() memblokir sampai deadline job berikutnya (dihitung penjadwal) sehingga
+// idle task bisa menurunkan frekuensi CPU (DFS) dan, jika LOW_POWER_MODE, masuk
+// light sleep otomatis. Blokir dibatasi relayLatencyMs supaya HTTP/WebSocket
+// tetap responsif.
+
+void powerInit()
+{
+  lastActivity = millis();
+  powerWindowStartUs = micros();
+  if (!LOW_POWER_MODE)
+    return;
+
+#if CONFIG_PM_ENABLE
+#if ESP_IDF_VERSION_MAJOR >= 5
+  esp_pm_config_t pm = {};
+#else
+  esp_pm_config_esp32_t pm = {};
+#endif
+  pm.max_freq_mhz = lpCpuMaxMhz;
+  pm.min_freq_mhz = lpCpuMinMhz;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+  pm.light_sleep_enable = true;
+#endif
+  if (esp_pm_configure(&pm) == ESP_OK)
+    lightSleepEnabled = pm.light_sleep_enable;
+  else
+    setCpuFrequencyMhz(lpCpuMaxMhz);
+#else
+  // Core tanpa power management: cukup turunkan frekuensi tetap
+  setCpuFrequencyMhz(lpCpuMaxMhz);
+#endif
+
+  // Modem sleep hanya ada di mode STA; radio bangun mengikuti DTIM AP
+  if (strcmp(MODE_STA_OR_AP, "sta") == 0)
+    modemSleepEnabled = WiFi.setSleep(WIFI_PS_MIN_MODEM);
+}
+
+/// @brief akhir loop(): catat waktu sibuk lalu tidur sampai job berikutnya jatuh tempo
+/// @param waitMs ms sampai deadline terdekat dari controlJobs/serviceJobs
+void powerIdle(uint32_t loopStartUs, uint32_t waitMs)
+{
+  powerBusyUs += micros() - loopStartUs;
+
+  if (waitMs > relayLatencyMs)
+    waitMs = relayLatencyMs;
+  if (waitMs > 0)
+    vTaskDelay(pdMS_TO_TICKS(waitMs));
+}
+
+// Duty cycle CPU (job "power", 10 s) untuk telemetri
+void updatePowerStats()
+{
+  uint32_t now = micros();
+  uint32_t window = now - powerWindowStartUs;
+  powerDuty = window ? (float)powerBusyUs / window : 1.0f;
+  if (powerDuty > 1.0f)
+    powerDuty = 1.0f;
+  powerBusyUs = 0;
+  powerWindowStartUs = now;
+}
+
+void noteActivity()
+{
+  lastActivity = millis();
+}
+
+/// @brief estimasi kasar arus total (mA) dari duty cycle dan konfigurasi daya.
+/// Angka per komponen adalah nilai tipikal datasheet ESP32/modul, bukan hasil ukur.
+float estimateCurrentMa()
+{
+  float cpuMhz = getCpuFrequencyMhz();
+  float activeMa = 20.0f + 0.13f * cpuMhz; // ~51 mA @240 MHz, ~30 mA @80 MHz
+  float idleMa = lightSleepEnabled ? 1.5f : activeMa * 0.7f;
+  float wifiMa;
+  if (strcmp(MODE_STA_OR_AP, "sta") != 0)
+    wifiMa = 100.0f; // AP harus terus memancarkan beacon
+  else
+    wifiMa = modemSleepEnabled ? 20.0f : 95.0f;
+  float lcdMa = lcdBacklightOn ? 20.0f : 1.0f;
+  return powerDuty * activeMa + (1.0f - powerDuty) * idleMa + wifiMa + lcdMa;
+}
+
+// ===== Watchdog =====
+// Timer hardware memeriksa heartbeat controlTick() setiap watchdogCheckUs. ISR hanya
+// menulis register GPIO W1TS/W1TC (seperti fastWrite) dengan mask yang sudah dihitung,
+// jadi aman walaupun loop task sedang terblokir. Logging dilakukan saat pulih,
+// di konteks task.
+void IRAM_ATTR onWatchdogTimer()
+{
+  if (watchdogTripped)
+    return;
+  uint32_t now = (uint32_t)esp_timer_get_time();
+  if (now - watchdogHeartbeatUs < watchdogDeadlineMs * 1000UL)
+    return;
+  *(volatile uint32_t *)GPIO_OUT_W1TS_REG = watchdogSetMask;
+  *(volatile uint32_t *)GPIO_OUT_W1TC_REG = watchdogClearMask;
+  watchdogTripStage = loopStage;
+  watchdogTripUs = watchdogHeartbeatUs;
+  watchdogMisses = watchdogMisses + 1;
+  watchdogTripped = true;
+}
+
+void watchdogInit()
+{
+  const uint8_t pins[5] = {PIN_RELAY_1, PIN_RELAY_2, PIN_RELAY_3, PIN_RELAY_4, PIN_RELAY_5};
+  for (int i = 0; i < 5; i++)
+  {
+    if (watchdogSafePattern[i])
+      watchdogClearMask |= 1UL << pins[i]; // relay aktif LOW
+    else
+      watchdogSetMask |= 1UL << pins[i];
+  }
+  watchdogHeartbeatUs = (uint32_t)esp_timer_get_time();
+
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  watchdogTimer = timerBegin(1000000);
+  timerAttachInterrupt(watchdogTimer, &onWatchdogTimer);
+  timerAlarm(watchdogTimer, watchdogCheckUs, true, 0);
+#else
+  watchdogTimer = timerBegin(0, 80, true); // 80 MHz / 80 = 1 tick per µs
+  timerAttachInterrupt(watchdogTimer, &onWatchdogTimer, true);
+  timerAlarmWrite(watchdogTimer, watchdogCheckUs, true);
+  timerAlarmEnable(watchdogTimer);
+#endif
+}
+
+/// @brief heartbeat dari controlTick(); jika watchdog sempat memicu, catat lalu pulihkan
+void watchdogFeed()
+{
+  uint32_t now = (uint32_t)esp_timer_get_time();
+  if (watchdogTripped)
+  {
+    uint32_t blockedMs = (now - watchdogTripUs) / 1000;
+    const char *stage = loopStageNames[watchdogTripStage];
+    Serial.printf("Watchdog: loop macet %lu ms di tahap %s, relay dipaksa aman (total %lu)\n",
+                  (unsigned long)blockedMs, stage, (unsigned long)watchdogMisses);
+
+    char json[112];
+    int n = snprintf(json, sizeof(json), "{\"watchdog\":{\"stage\":\"%s\",\"ms\":%lu,\"misses\":%lu}}",
+                     stage, (unsigned long)blockedMs, (unsigned long)watchdogMisses);
+    webSocket.broadcastTXT(json, n);
+    noteActivity();
+
+    uint8_t safe = autoMode ? JOURNAL_AUTO_BIT : 0;
+    for (int i = 0; i < 5; i++)
+      safe |= watchdogSafePattern[i] << i;
+    journalRecord(JS_WATCHDOG, journalState(), safe, -1, millis() - blockedMs);
   }
+  // Heartbeat diperbarui sebelum flag dilepas supaya ISR tidak langsung memicu lagi;
+  // fastWrite() di controlTick() mengembalikan relay ke relayState
+  watchdogHeartbeatUs = now;
+  watchdogTripped = false;
 }
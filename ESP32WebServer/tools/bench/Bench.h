@@ -0,0 +1,142 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#ifdef ARDUINO
+#include <esp_timer.h>
+#else
+#include <time.h>
+#endif
+
+// Harness micro-benchmark, dipakai runner host (tools/bench/bench.cpp) dan
+// firmware env:bench (src/bench/bench_main.cpp). Waktu diukur per kasus
+// dengan jumlah iterasi yang digandakan sampai minimal minNs. Alokasi
+// dihitung lewat pembungkus malloc/calloc/realloc/free (link dengan
+// -Wl,--wrap=malloc,...): hanya disertakan di satu file .cpp per program.
+
+struct BenchCase
+{
+  const char *name;
+  void (*run)(uint32_t iters);
+};
+
+struct BenchResult
+{
+  const char *name;
+  uint32_t iters;
+  double nsPerOp;
+  double allocsPerOp; // malloc/calloc/realloc per operasi
+  double bytesPerOp;  // byte yang diminta per operasi
+};
+
+struct BenchAllocStats
+{
+  bool counting;
+  uint32_t count;
+  uint64_t bytes;
+};
+
+inline BenchAllocStats &benchAllocStats()
+{
+  static BenchAllocStats stats; // nol saat start, tanpa guard inisialisasi
+  return stats;
+}
+
+extern "C"
+{
+  void *__real_malloc(size_t size);
+  void *__real_calloc(size_t n, size_t size);
+  void *__real_realloc(void *p, size_t size);
+  void __real_free(void *p);
+
+  void *__wrap_malloc(size_t size)
+  {
+    BenchAllocStats &a = benchAllocStats();
+    if (a.counting)
+    {
+      a.count++;
+      a.bytes += size;
+    }
+    return __real_malloc(size);
+  }
+
+  void *__wrap_calloc(size_t n, size_t size)
+  {
+    BenchAllocStats &a = benchAllocStats();
+    if (a.counting)
+    {
+      a.count++;
+      a.bytes += n * size;
+    }
+    return __real_calloc(n, size);
+  }
+
+  void *__wrap_realloc(void *p, size_t size)
+  {
+    BenchAllocStats &a = benchAllocStats();
+    if (a.counting)
+    {
+      a.count++;
+      a.bytes += size;
+    }
+    return __real_realloc(p, size);
+  }
+
+  void __wrap_free(void *p)
+  {
+    __real_free(p);
+  }
+}
+
+inline uint64_t benchNowNs()
+{
+#ifdef ARDUINO
+  return (uint64_t)esp_timer_get_time() * 1000u;
+#else
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+/// @brief ukur satu kasus: satu putaran pemanasan, lalu iterasi diperbesar
+/// sampai satu putaran memakan minimal minNs. Alokasi dari putaran terakhir.
+inline BenchResult benchMeasure(const BenchCase &c, uint64_t minNs)
+{
+  const uint32_t maxIters = 1u << 30;
+  BenchAllocStats &a = benchAllocStats();
+  c.run(1);
+  uint32_t iters = 1;
+  uint64_t elapsed;
+  for (;;)
+  {
+    a.count = 0;
+    a.bytes = 0;
+    a.counting = true;
+    uint64_t t0 = benchNowNs();
+    c.run(iters);
+    elapsed = benchNowNs() - t0;
+    a.counting = false;
+    if (elapsed >= minNs || iters >= maxIters)
+      break;
+    // perkiraan iterasi untuk mencapai minNs (+20%), naik paling banyak 10x per langkah
+    uint64_t next = elapsed ? (uint64_t)iters * minNs * 12 / 10 / elapsed : (uint64_t)iters * 10;
+    if (next > (uint64_t)iters * 10)
+      next = (uint64_t)iters * 10;
+    if (next <= iters)
+      next = iters + 1;
+    iters = next > maxIters ? maxIters : (uint32_t)next;
+  }
+  BenchResult r = {c.name, iters, (double)elapsed / iters, (double)a.count / iters, (double)a.bytes / iters};
+  return r;
+}
+
+/// @brief satu baris JSON hasil (elemen array "results"); satu kasus per baris
+/// supaya mudah dibandingkan dengan diff atau dibaca ulang sebagai baseline
+inline int benchFormatJson(char *buf, size_t size, const BenchResult &r, bool first)
+{
+  return snprintf(buf, size,
+                  "%s{\"name\":\"%s\",\"iters\":%lu,\"ns_per_op\":%.2f,\"allocs_per_op\":%.3f,\"bytes_per_op\":%.1f}",
+                  first ? "" : ",", r.name, (unsigned long)r.iters, r.nsPerOp, r.allocsPerOp, r.bytesPerOp);
+}
@@ -0,0 +1,353 @@
+#pragma once
+
+#include "AutoRelay.h"
+#include "Analog.h"
+#include "ChannelRegistry.h"
+#include "CommandQueue.h"
+#include "DataList.h"
+#include "DoTrend.h"
+#include "EventJournal.h"
+#include "HistoryStats.h"
+#include "KitChannels.h"
+#include "PhDosing.h"
+#include "SensorConversion.h"
+#include "StatusJson.h"
+#include "Bench.h"
+
+#include <math.h>
+#include <string.h>
+
+// Kasus benchmark jalur panas firmware. Tabel kanal, DoTrend dan PhDosing dari
+// include/KitChannels.h dan KitConfig.h, ukuran riwayat sama dengan src/main.cpp; masukan berupa sinyal kolam
+// sintetis 256 sampel yang dihitung sekali di bench::setup() supaya biaya
+// pembangkitnya tidak ikut terukur. Setiap kasus mengulang satu operasi
+// `iters` kali dan menulis hasilnya ke sink volatile.
+//
+// autoRelayLogic() diukur tanpa hardware: bacaan + ambang dari ChannelBank,
+// autoRelayDecide() dan pembandingan dengan state relay, seperti firmware
+// sebelum digitalWrite/broadcast (yang hanya terjadi saat relay berubah).
+
+namespace bench
+{
+  // Sama dengan firmware (src/main.cpp)
+  const int maxDataPoints = 30;
+  const float historyResolution = 0.01f;
+  const int historyBlockBytes = 256;
+  const int historyBlocks = 32;
+  const uint32_t statsBucketMs = 600000;
+  const int statsBuckets = 144;
+  const uint32_t statsMaxGapMs = 60000;
+
+  ChannelBank<channelCount> sensors(channels); // oksigenSuhuSource() kosong: DO pada suhuFallback
+  DataList<channelCount, historyBlockBytes, historyBlocks> history(channels, historyResolution, maxDataPoints);
+  HistoryStats<channelCount, statsBuckets> stats(statsBucketMs, statsMaxGapMs);
+  DoTrend doTrend(doTrendConfig);
+  PhDosing phDosing(phDosingConfig);
+  bool relayState[5] = {false, false, false, false, false};
+  JournalEvent journalEvent = {4711, 123456789, JS_AUTO, 0x88, 0x80, CHI_OKS, 487, 0};
+
+  const int traceLen = 256; // pangkat dua
+  int adcTrace[traceLen];
+  float voltTrace[channelCount][traceLen];
+  float valueTrace[traceLen][channelCount];
+
+  uint32_t nowMs = 0;
+  char buf[640 + channelCount * (128 + maxDataPoints * 8)]; // sama dengan handleSnapshot()
+
+  volatile float sinkF;
+  volatile uint32_t sinkU;
+
+  /// @brief isi jejak masukan dan riwayat (sekali, sebelum kasus pertama)
+  inline void setup()
+  {
+    for (int i = 0; i < traceLen; i++)
+    {
+      float w = sinf(2.0f * (float)M_PI * i / traceLen);
+      float ph = 7.4f + 0.6f * w;
+      float turb = 45.0f + 20.0f * w;
+      float oks = 6.5f + 1.5f * w;
+      float suhu = 27.0f + 2.0f * w;
+      valueTrace[i][CHI_PH] = ph;
+      valueTrace[i][CHI_TURB] = turb;
+      valueTrace[i][CHI_OKS] = oks;
+      valueTrace[i][CHI_SUHU] = suhu;
+      voltTrace[CHI_PH][i] = (ph - 1.85f) / (3.5f * 5.0f / 3.3f);
+      voltTrace[CHI_TURB][i] = 0.8f + (100.0f - turb) / 100.0f * 0.73f;
+      voltTrace[CHI_OKS][i] = 0.3f + 0.1f * w;
+      voltTrace[CHI_SUHU][i] = suhu;
+      adcTrace[i] = (int)(voltTrace[CHI_PH][i] / 3.3f * 4095.0f) + (i * 7 % 5) - 2; // derau +-2 count
+    }
+    for (int i = 0; i < 8640; i++) // indeks /stats: 24 jam heartbeat 10 s, semua bucket terisi
+    {
+      nowMs += 10000;
+      stats.append(nowMs, valueTrace[i & (traceLen - 1)], sensors.threshold);
+    }
+    for (int i = 0; i < 4000; i++) // riwayat penuh sampai blok tertua mulai dibuang
+    {
+      nowMs += 50;
+      history.addData(nowMs, valueTrace[i & (traceLen - 1)]);
+    }
+    for (int i = 0; i < channelCount; i++)
+      sensors.setValue(i, valueTrace[0][i], nowMs);
+  }
+
+  // ===== Analog, konversi =====
+  inline void analogUpdate(uint32_t iters)
+  {
+    static Analog a(-1, 0.1f);
+    for (uint32_t i = 0; i < iters; i++)
+      a.update(adcTrace[i & (traceLen - 1)]);
+    sinkF = a.getVar(Analog::VOLTAGE);
+  }
+
+  inline void analogUpdateAfter(uint32_t iters)
+  {
+    static Analog a(-1, 0.1f);
+    for (uint32_t i = 0; i < iters; i++)
+      a.updateAfter(adcTrace[i & (traceLen - 1)], 4);
+    sinkF = a.getVar(Analog::VOLTAGE);
+  }
+
+  inline void convPh(uint32_t iters)
+  {
+    float s = 0;
+    for (uint32_t i = 0; i < iters; i++)
+      s += phFromVoltage(voltTrace[CHI_PH][i & (traceLen - 1)]);
+    sinkF = s;
+  }
+
+  inline void convTurbidity(uint32_t iters)
+  {
+    float s = 0;
+    for (uint32_t i = 0; i < iters; i++)
+      s += turbidityFromVoltage(voltTrace[CHI_TURB][i & (traceLen - 1)]);
+    sinkF = s;
+  }
+
+  inline void convOksigen(uint32_t iters)
+  {
+    float s = 0;
+    for (uint32_t i = 0; i < iters; i++)
+    {
+      uint32_t k = i & (traceLen - 1);
+      s += oksigenFromVoltage(voltTrace[CHI_OKS][k], voltTrace[CHI_SUHU][k], doCalibration);
+    }
+    sinkF = s;
+  }
+
+  // ===== Riwayat =====
+  inline void dataListAdd(uint32_t iters)
+  {
+    for (uint32_t i = 0; i < iters; i++)
+    {
+      nowMs += 50;
+      history.addData(nowMs, valueTrace[i & (traceLen - 1)]);
+    }
+    sinkU = history.getCount();
+  }
+
+  inline void dataListChart(uint32_t iters)
+  {
+    for (uint32_t i = 0; i < iters; i++)
+    {
+      size_t len = 0;
+      history.writeChartData(channels[i % channelCount].key, buf, sizeof(buf), len);
+      sinkU = len;
+    }
+  }
+
+#ifdef ARDUINO
+  inline void dataListChartString(uint32_t iters)
+  {
+    static const String keys[channelCount] = {"ph", "turb", "oks", "suhu"};
+    for (uint32_t i = 0; i < iters; i++)
+      sinkU = history.getChartData(keys[i % channelCount]).length();
+  }
+#endif
+
+  inline void statsAppend(uint32_t iters)
+  {
+    for (uint32_t i = 0; i < iters; i++)
+    {
+      nowMs += 50;
+      stats.append(nowMs, valueTrace[i & (traceLen - 1)], sensors.threshold);
+    }
+    sinkU = nowMs;
+  }
+
+  /// @brief agregat 6 jam terakhir satu kanal (/stats?channel=...)
+  inline void statsQuery(uint32_t iters)
+  {
+    StatsResult r = {};
+    for (uint32_t i = 0; i < iters; i++)
+    {
+      stats.query(i % channelCount, nowMs - 6 * 3600000u, nowMs, r);
+      sinkU = r.samples;
+    }
+  }
+
+  // ===== Kontrol =====
+  inline void autoRelayLogic(uint32_t iters)
+  {
+    uint32_t switches = 0;
+    for (uint32_t i = 0; i < iters; i++)
+    {
+      nowMs += 10; // autoIntervalMs
+      const float *v = valueTrace[(i >> 6) & (traceLen - 1)];
+      for (int c = 0; c < channelCount; c++)
+        sensors.value[c] = v[c];
+      uint8_t invalid = 0;
+      if (!sensors.health[CHI_PH].valid())
+        invalid |= CH_PH;
+      if (!sensors.health[CHI_TURB].valid())
+        invalid |= CH_TURB;
+      if (!sensors.health[CHI_OKS].valid())
+        invalid |= CH_OKS;
+      if (!sensors.health[CHI_SUHU].valid())
+        invalid |= CH_SUHU;
+      ControlReading reading = {sensors.value[CHI_PH], sensors.value[CHI_TURB], sensors.value[CHI_OKS],
+                                sensors.value[CHI_SUHU], invalid};
+      ControlThresholds th = {sensors.threshold[CHI_PH], sensors.threshold[CHI_TURB],
+                              sensors.threshold[CHI_OKS], sensors.threshold[CHI_SUHU]};
+      bool next[5];
+      uint8_t driven = autoRelayDecide(reading, th, (nowMs / 5000) & 1, doTrend, phDosing, nowMs, next);
+      for (int r = 0; r < 5; r++)
+        if ((driven & (1 << r)) && next[r] != relayState[r])
+        {
+          relayState[r] = next[r];
+          switches++;
+        }
+    }
+    sinkU = switches;
+  }
+
+  // ===== Penulis JSON =====
+  inline void jsonRelayStatus(uint32_t iters)
+  {
+    for (uint32_t i = 0; i < iters; i++)
+    {
+      size_t len = 0;
+      relayState[i % 5] = !relayState[i % 5];
+      writeRelayStatusJson(buf, sizeof(buf), len, relayState, 5, i & 1);
+      sinkU = len;
+    }
+  }
+
+  inline void jsonThresholds(uint32_t iters)
+  {
+    for (uint32_t i = 0; i < iters; i++)
+    {
+      size_t len = 0;
+      writeThresholdsJson(buf, sizeof(buf), len, channels, sensors.threshold);
+      sinkU = len;
+    }
+  }
+
+  inline bool writeLast(size_t &len)
+  {
+    const float *last = history.getLastNode() ? history.getLastNode()->v : nullptr;
+    LastStatus status = {doTrend.slopePerHour(), doTrend.secondsToThreshold(sensors.threshold[CHI_OKS].min),
+                         0.42f, 95.0f, 0, true};
+    return writeLastJson(buf, sizeof(buf), len, channels, last, sensors.health, status);
+  }
+
+  inline void jsonLast(uint32_t iters)
+  {
+    for (uint32_t i = 0; i < iters; i++)
+    {
+      size_t len = 0;
+      writeLast(len);
+      sinkU = len;
+    }
+  }
+
+  inline void jsonJournalEvent(uint32_t iters)
+  {
+    for (uint32_t i = 0; i < iters; i++)
+    {
+      size_t len = 0;
+      journalEvent.seq++;
+      writeJournalEventJson(buf, sizeof(buf), len, channels, journalEvent, i & 1);
+      sinkU = len;
+    }
+  }
+
+  /// @brief isi respons /stats semua kanal (tanpa query, lihat statsQuery)
+  inline void jsonStats(uint32_t iters)
+  {
+    StatsResult r[channelCount] = {};
+    for (int c = 0; c < channelCount; c++)
+      stats.query(c, nowMs - 6 * 3600000u, nowMs, r[c]);
+    for (uint32_t i = 0; i < iters; i++)
+    {
+      size_t len = 0;
+      bool ok = appendf(buf, sizeof(buf), len, "{\"now\":%lu,\"from\":%lu,\"to\":%lu,\"bucketS\":%lu,"
+                        "\"samples\":%lu,\"stats\":{", (unsigned long)nowMs, (unsigned long)r[0].fromMs,
+                        (unsigned long)r[0].toMs, (unsigned long)(statsBucketMs / 1000), (unsigned long)r[0].samples);
+      for (int c = 0; ok && c < channelCount; c++)
+        ok = writeStatsJson(buf, sizeof(buf), len, channels[c].key, r[c], c == 0);
+      sinkU = ok && appendf(buf, sizeof(buf), len, "}}") ? len : 0;
+    }
+  }
+
+  /// @brief isi respons /snapshot lengkap, urutan sama dengan handleSnapshot()
+  inline void jsonSnapshot(uint32_t iters)
+  {
+    for (uint32_t i = 0; i < iters; i++)
+    {
+      size_t len = 0;
+      bool ok = appendf(buf, sizeof(buf), len, "{\"t\":%lu,\"status\":", (unsigned long)nowMs) &&
+                writeRelayStatusJson(buf, sizeof(buf), len, relayState, 5, true) &&
+                appendf(buf, sizeof(buf), len, ",\"thresholds\":") &&
+                writeThresholdsJson(buf, sizeof(buf), len, channels, sensors.threshold) &&
+                appendf(buf, sizeof(buf), len, ",\"data\":{");
+      for (int c = 0; ok && c < channelCount; c++)
+        ok = appendf(buf, sizeof(buf), len, c ? ",\"%s\":" : "\"%s\":", channels[c].key) &&
+             history.writeChartData(channels[c].key, buf, sizeof(buf), len);
+      ok = ok && appendf(buf, sizeof(buf), len, "},\"last\":") && writeLast(len) &&
+           appendf(buf, sizeof(buf), len, "}");
+      sinkU = ok ? len : 0;
+    }
+  }
+
+  // ===== Parser perintah WebSocket =====
+  inline void wsParse(uint32_t iters, const char *frame)
+  {
+    size_t n = strlen(frame);
+    Command cmd;
+    uint32_t okCount = 0;
+    for (uint32_t i = 0; i < iters; i++)
+      okCount += parseCommand((const uint8_t *)frame, n, 5, cmd) == PARSE_OK;
+    sinkU = okCount + cmd.relayMask;
+  }
+
+  inline void wsParseSingle(uint32_t iters) { wsParse(iters, "relay3_on"); }
+  inline void wsParseBatch(uint32_t iters) { wsParse(iters, "#17 relay1_on relay2_off,relay5_on;mode_manual"); }
+  inline void wsParseInvalid(uint32_t iters) { wsParse(iters, "#18 relay1_on relay9_off"); }
+} // namespace bench
+
+const BenchCase benchCases[] = {
+    {"analog_update", bench::analogUpdate},
+    {"analog_update_after4", bench::analogUpdateAfter},
+    {"conv_ph", bench::convPh},
+    {"conv_turbidity", bench::convTurbidity},
+    {"conv_oksigen", bench::convOksigen},
+    {"datalist_add", bench::dataListAdd},
+    {"datalist_chart", bench::dataListChart},
+#ifdef ARDUINO
+    {"datalist_chart_string", bench::dataListChartString},
+#endif
+    {"stats_append", bench::statsAppend},
+    {"stats_query", bench::statsQuery},
+    {"auto_relay_logic", bench::autoRelayLogic},
+    {"json_relay_status", bench::jsonRelayStatus},
+    {"json_thresholds", bench::jsonThresholds},
+    {"json_last", bench::jsonLast},
+    {"json_journal_event", bench::jsonJournalEvent},
+    {"json_snapshot", bench::jsonSnapshot},
+    {"json_stats", bench::jsonStats},
+    {"ws_parse_single", bench::wsParseSingle},
+    {"ws_parse_batch", bench::wsParseBatch},
+    {"ws_parse_invalid", bench::wsParseInvalid},
+};
+const int benchCaseCount = sizeof(benchCases) / sizeof(benchCases[0]);
@@ -0,0 +1,161 @@
+// Micro-benchmark jalur panas firmware di host (Linux).
+//
+//   bench [--json] [--filter TEKS] [--min-ms N] [--max-allocs N]
+//         [--baseline FILE] [--max-regress PCT]
+//
+// Menjalankan kasus di BenchCases.h (header logika dari ../../include, kode
+// yang sama dengan firmware) dan melaporkan ns/op, alokasi/op dan byte/op.
+// --json mencetak hasil dalam format yang sama dengan firmware env:bench,
+// satu kasus per baris, untuk disimpan sebagai baseline. --baseline
+// membandingkan ns/op dengan file JSON sebelumnya.
+//
+// Exit code 1 jika ada kasus yang mengalokasi lebih dari --max-allocs per
+// operasi, atau lebih lambat dari baseline lebih dari --max-regress persen.
+
+#include "Bench.h"
+#include "BenchCases.h"
+
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// operator new di libstdc++.so tidak ikut --wrap; arahkan ke malloc di sini
+void *operator new(size_t size)
+{
+  void *p = malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+namespace
+{
+  struct Baseline
+  {
+    char name[48];
+    double nsPerOp;
+  };
+
+  Baseline baseline[64];
+  int baselineCount = 0;
+
+  bool loadBaseline(const char *path)
+  {
+    FILE *f = fopen(path, "r");
+    if (!f)
+    {
+      perror(path);
+      return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f) && baselineCount < 64)
+    {
+      const char *name = strstr(line, "\"name\":\"");
+      const char *ns = strstr(line, "\"ns_per_op\":");
+      if (!name || !ns)
+        continue;
+      Baseline &b = baseline[baselineCount];
+      if (sscanf(name + 8, "%47[^\"]", b.name) == 1 && sscanf(ns + 12, "%lf", &b.nsPerOp) == 1)
+        baselineCount++;
+    }
+    fclose(f);
+    return baselineCount > 0;
+  }
+
+  const Baseline *findBaseline(const char *name)
+  {
+    for (int i = 0; i < baselineCount; i++)
+      if (!strcmp(baseline[i].name, name))
+        return &baseline[i];
+    return nullptr;
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  bool json = false;
+  const char *filter = nullptr;
+  const char *baselinePath = nullptr;
+  double minMs = 200;
+  double maxAllocs = -1;
+  double maxRegress = -1;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--json"))
+      json = true;
+    else if (!strcmp(argv[i], "--filter") && i + 1 < argc)
+      filter = argv[++i];
+    else if (!strcmp(argv[i], "--min-ms") && i + 1 < argc)
+      minMs = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--max-allocs") && i + 1 < argc)
+      maxAllocs = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--baseline") && i + 1 < argc)
+      baselinePath = argv[++i];
+    else if (!strcmp(argv[i], "--max-regress") && i + 1 < argc)
+      maxRegress = atof(argv[++i]);
+    else
+    {
+      fprintf(stderr, "usage: %s [--json] [--filter TEKS] [--min-ms N] [--max-allocs N] "
+                      "[--baseline FILE] [--max-regress PCT]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  if (baselinePath && !loadBaseline(baselinePath))
+  {
+    fprintf(stderr, "baseline %s kosong atau tidak terbaca\n", baselinePath);
+    return 2;
+  }
+
+  bench::setup();
+  if (json)
+    printf("{\"suite\":\"firmware\",\"target\":\"host\",\"results\":[\n");
+  else
+    printf("%-24s %12s %12s %10s %10s%s\n", "kasus", "iterasi", "ns/op", "alloc/op", "byte/op",
+           baselinePath ? "   vs baseline" : "");
+
+  int failures = 0;
+  bool first = true;
+  for (int i = 0; i < benchCaseCount; i++)
+  {
+    const BenchCase &c = benchCases[i];
+    if (filter && !strstr(c.name, filter))
+      continue;
+    BenchResult r = benchMeasure(c, (uint64_t)(minMs * 1e6));
+
+    const Baseline *b = baselinePath ? findBaseline(c.name) : nullptr;
+    double delta = b && b->nsPerOp > 0 ? (r.nsPerOp / b->nsPerOp - 1.0) * 100.0 : 0;
+    bool allocFail = maxAllocs >= 0 && r.allocsPerOp > maxAllocs;
+    bool regressFail = b && maxRegress >= 0 && delta > maxRegress;
+    failures += allocFail || regressFail;
+
+    if (json)
+    {
+      char line[256];
+      benchFormatJson(line, sizeof(line), r, first);
+      printf("%s\n", line);
+    }
+    else
+    {
+      printf("%-24s %12lu %12.2f %10.3f %10.1f", r.name, (unsigned long)r.iters, r.nsPerOp, r.allocsPerOp,
+             r.bytesPerOp);
+      if (b)
+        printf("   %+7.1f%%", delta);
+      else if (baselinePath)
+        printf("   (baru)");
+      printf("%s%s\n", allocFail ? "  ALOKASI" : "", regressFail ? "  REGRESI" : "");
+    }
+    if (json && (allocFail || regressFail))
+      fprintf(stderr, "%s: %s\n", r.name, allocFail ? "alokasi melewati batas" : "regresi melewati batas");
+    first = false;
+  }
+  if (json)
+    printf("]}\n");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,691 @@
+// Collector multi-kit: menjaga koneksi WebSocket persisten ke banyak ESP32
+// (port 81), menyimpan telemetri ke file kolumnar mmap per tangki/kanal, dan
+// menjawab query rentang waktu lewat HTTP sederhana.
+//
+//   collector --kits kits.txt [--data-dir data] [--threads 4]
+//             [--query-port 8090] [--capacity 4194304] [--silence-ms 3000]
+//
+// Format kits.txt: satu kit per baris "<tank-id> <host> [port]", '#' = komentar.
+// Query:
+//   GET /tanks                                      daftar tangki + jumlah baris + kanal
+//   GET /query?tank=<id>&channel=<key>&from=<ms>&to=<ms>   CSV t_ms,value
+//
+// Kanal yang disimpan = key tabel channels firmware (include/KitChannels.h),
+// ditambah kolom lama yang sudah ada di direktori tangki. Kanal yang tidak ada
+// di pesan telemetri disimpan NaN dan dilewati oleh /query.
+//
+// Liveness: kit yang reboot atau lepas dari WiFi bisa meninggalkan socket
+// setengah terbuka tanpa FIN. Koneksi yang belum selesai handshake dalam
+// handshakeTimeoutMs, atau OPEN tanpa data selama --silence-ms (default 3x
+// periode telemetri firmware 1 s), ditutup dan dijadwalkan ulang. SO_KEEPALIVE
+// menjaga socket yang benar-benar mati tetap terdeteksi oleh kernel.
+
+#include "KitChannels.h"
+#include "colstore.h"
+#include "ws.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <netdb.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+namespace
+{
+
+  std::atomic<bool> running(true);
+
+  const int64_t handshakeTimeoutMs = 5000; // connect + upgrade WebSocket
+  int64_t silenceTimeoutMs = 3000;         // OPEN tanpa frame apa pun (--silence-ms)
+
+  int64_t nowMs()
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+  }
+
+  int64_t monoMs()
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+  }
+
+  struct Kit
+  {
+    std::string host;
+    uint16_t port;
+    sockaddr_storage addr;
+    socklen_t addrLen;
+    std::unique_ptr<colstore::Tank> tank;
+  };
+
+  enum ConnState
+  {
+    IDLE,
+    CONNECTING,
+    HANDSHAKE,
+    OPEN
+  };
+
+  // Satu koneksi dimiliki tepat satu worker, jadi state di sini tidak perlu lock.
+  struct Conn
+  {
+    Kit *kit;
+    int fd = -1;
+    ConnState state = IDLE;
+    std::string expectedAccept;
+    uint8_t rbuf[8192];
+    size_t rlen = 0;
+    int64_t retryAt = 0;
+    int backoffMs = 500;
+    int64_t lastRxMs = 0; // monoMs() data terakhir diterima (atau mulai connect)
+  };
+
+  struct Stats
+  {
+    std::atomic<uint64_t> messages{0};
+    std::atomic<uint64_t> rows{0};
+    std::atomic<uint64_t> connects{0};
+    std::atomic<uint64_t> disconnects{0};
+    std::atomic<uint64_t> timeouts{0};
+    std::atomic<int> open{0};
+  };
+  Stats stats;
+
+  class Worker
+  {
+  public:
+    void add(Kit *kit)
+    {
+      conns.emplace_back(new Conn());
+      conns.back()->kit = kit;
+    }
+
+    void run()
+    {
+      ep = epoll_create1(EPOLL_CLOEXEC);
+      if (ep < 0)
+      {
+        perror("epoll_create1");
+        return;
+      }
+      epoll_event events[256];
+      while (running.load(std::memory_order_relaxed))
+      {
+        int64_t now = monoMs();
+        int64_t nextDeadline = now + 1000;
+        for (auto &c : conns)
+        {
+          if (c->state != IDLE)
+          {
+            int64_t limit = c->state == OPEN ? silenceTimeoutMs : handshakeTimeoutMs;
+            if (now - c->lastRxMs >= limit)
+              expire(*c, now);
+          }
+          else if (c->retryAt <= now)
+            startConnect(*c);
+
+          int64_t deadline = c->state == IDLE ? c->retryAt
+                             : c->lastRxMs + (c->state == OPEN ? silenceTimeoutMs : handshakeTimeoutMs);
+          if (deadline < nextDeadline)
+            nextDeadline = deadline;
+        }
+
+        int timeout = (int)(nextDeadline - now);
+        int n = epoll_wait(ep, events, 256, timeout < 0 ? 0 : timeout);
+        for (int i = 0; i < n; i++)
+        {
+          Conn *c = (Conn *)events[i].data.ptr;
+          if (events[i].events & (EPOLLERR | EPOLLHUP))
+            drop(*c);
+          else if (c->state == CONNECTING && (events[i].events & EPOLLOUT))
+            onConnected(*c);
+          else if (events[i].events & EPOLLIN)
+            onReadable(*c);
+        }
+      }
+      for (auto &c : conns)
+        if (c->fd >= 0)
+          close(c->fd);
+      close(ep);
+    }
+
+  private:
+    void startConnect(Conn &c)
+    {
+      c.fd = socket(c.kit->addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+      if (c.fd < 0)
+      {
+        scheduleRetry(c);
+        return;
+      }
+      int one = 1;
+      setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      // Probe keepalive setelah 10 s diam, 3 kali tiap 5 s (default kernel 2 jam)
+      int idle = 10, interval = 5, count = 3;
+      setsockopt(c.fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+      setsockopt(c.fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+      setsockopt(c.fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+      setsockopt(c.fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+      int r = connect(c.fd, (sockaddr *)&c.kit->addr, c.kit->addrLen);
+      if (r < 0 && errno != EINPROGRESS)
+      {
+        close(c.fd);
+        c.fd = -1;
+        scheduleRetry(c);
+        return;
+      }
+      c.state = CONNECTING;
+      c.lastRxMs = monoMs(); // batas handshake dihitung dari sini
+      epoll_event ev;
+      ev.events = EPOLLOUT | EPOLLIN;
+      ev.data.ptr = &c;
+      epoll_ctl(ep, EPOLL_CTL_ADD, c.fd, &ev);
+    }
+
+    void onConnected(Conn &c)
+    {
+      int err = 0;
+      socklen_t len = sizeof(err);
+      getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+      if (err)
+      {
+        drop(c);
+        return;
+      }
+
+      uint8_t keyRaw[16];
+      for (auto &b : keyRaw)
+        b = (uint8_t)rand();
+      std::string key = ws::base64(keyRaw, sizeof(keyRaw));
+      c.expectedAccept = ws::acceptKey(key);
+
+      char req[512];
+      int n = snprintf(req, sizeof(req),
+                       "GET / HTTP/1.1\r\nHost: %s:%u\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                       "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n",
+                       c.kit->host.c_str(), c.kit->port, key.c_str());
+      if (write(c.fd, req, n) != n)
+      {
+        drop(c);
+        return;
+      }
+      c.state = HANDSHAKE;
+      c.rlen = 0;
+      epoll_event ev;
+      ev.events = EPOLLIN;
+      ev.data.ptr = &c;
+      epoll_ctl(ep, EPOLL_CTL_MOD, c.fd, &ev);
+    }
+
+    void onReadable(Conn &c)
+    {
+      for (;;)
+      {
+        if (c.rlen == sizeof(c.rbuf))
+        {
+          drop(c); // frame lebih besar dari buffer: bukan telemetri kit
+          return;
+        }
+        ssize_t r = read(c.fd, c.rbuf + c.rlen, sizeof(c.rbuf) - c.rlen);
+        if (r == 0 || (r < 0 && errno != EAGAIN && errno != EINTR))
+        {
+          drop(c);
+          return;
+        }
+        if (r < 0)
+          break;
+        c.rlen += (size_t)r;
+        c.lastRxMs = monoMs();
+
+        if (c.state == HANDSHAKE && !finishHandshake(c))
+          return;
+        if (c.state == OPEN && !processFrames(c))
+          return;
+      }
+    }
+
+    bool finishHandshake(Conn &c)
+    {
+      void *end = memmem(c.rbuf, c.rlen, "\r\n\r\n", 4);
+      if (!end)
+        return true; // tunggu sisa header
+      size_t hdrLen = (uint8_t *)end - c.rbuf + 4;
+      std::string hdr((const char *)c.rbuf, hdrLen);
+      if (hdr.compare(0, 12, "HTTP/1.1 101") != 0 || hdr.find(c.expectedAccept) == std::string::npos)
+      {
+        fprintf(stderr, "[%s] handshake ditolak\n", c.kit->tank->id.c_str());
+        drop(c);
+        return false;
+      }
+      memmove(c.rbuf, c.rbuf + hdrLen, c.rlen - hdrLen);
+      c.rlen -= hdrLen;
+      c.state = OPEN;
+      c.backoffMs = 500;
+      stats.connects++;
+      stats.open++;
+      return true;
+    }
+
+    bool processFrames(Conn &c)
+    {
+      size_t pos = 0;
+      while (pos < c.rlen)
+      {
+        ws::Frame f;
+        long used = ws::parseFrame(c.rbuf + pos, c.rlen - pos, f, sizeof(c.rbuf));
+        if (used == 0)
+          break;
+        if (used < 0 || f.opcode == ws::OP_CLOSE)
+        {
+          drop(c);
+          return false;
+        }
+        if (f.opcode == ws::OP_PING)
+        {
+          sendFrame(c, ws::OP_PONG, f.payload, f.length);
+          if (c.state != OPEN)
+            return false;
+        }
+        else if (f.opcode == ws::OP_TEXT)
+          ingest(c, (const char *)f.payload, f.length);
+        pos += (size_t)used;
+      }
+      memmove(c.rbuf, c.rbuf + pos, c.rlen - pos);
+      c.rlen -= pos;
+      return true;
+    }
+
+    void ingest(Conn &c, const char *json, size_t len)
+    {
+      stats.messages++;
+      // Pesan status relay/mode tidak punya field sensor; lewati saja.
+      // Kanal yang tidak dikirim kit (firmware lama/baru) disimpan NaN.
+      colstore::Tank &tank = *c.kit->tank;
+      float values[colstore::kMaxChannels];
+      int found = 0;
+      for (int i = 0; i < tank.channels(); i++)
+      {
+        double v;
+        bool ok = ws::jsonNumber(json, len, tank.channelName(i).c_str(), v);
+        values[i] = ok ? (float)v : NAN;
+        found += ok;
+      }
+      if (found && tank.append(nowMs(), values))
+        stats.rows++;
+    }
+
+    void sendFrame(Conn &c, uint8_t opcode, const uint8_t *payload, size_t len)
+    {
+      uint8_t out[256];
+      if (len > sizeof(out) - 14)
+        return;
+      uint8_t mask[4] = {(uint8_t)rand(), (uint8_t)rand(), (uint8_t)rand(), (uint8_t)rand()};
+      size_t n = ws::writeFrame(out, opcode, payload, len, mask);
+      if (write(c.fd, out, n) != (ssize_t)n)
+        drop(c);
+    }
+
+    /// @brief koneksi melewati batas handshake/diam: tutup dan sambung ulang
+    void expire(Conn &c, int64_t now)
+    {
+      fprintf(stderr, "[%s] %s tanpa data %lld ms, sambung ulang\n", c.kit->tank->id.c_str(),
+              c.state == OPEN ? "terhubung" : "handshake", (long long)(now - c.lastRxMs));
+      stats.timeouts++;
+      drop(c);
+    }
+
+    void drop(Conn &c)
+    {
+      if (c.fd >= 0)
+      {
+        epoll_ctl(ep, EPOLL_CTL_DEL, c.fd, nullptr);
+        close(c.fd);
+        c.fd = -1;
+      }
+      if (c.state == OPEN)
+      {
+        stats.disconnects++;
+        stats.open--;
+      }
+      c.state = IDLE;
+      c.rlen = 0;
+      scheduleRetry(c);
+    }
+
+    void scheduleRetry(Conn &c)
+    {
+      // Backoff eksponensial + jitter supaya ribuan kit tidak reconnect serentak
+      c.retryAt = monoMs() + c.backoffMs + rand() % 250;
+      c.backoffMs = c.backoffMs * 2 > 30000 ? 30000 : c.backoffMs * 2;
+    }
+
+    int ep = -1;
+    std::vector<std::unique_ptr<Conn>> conns;
+  };
+
+  // ===== Query HTTP =====
+  std::string queryParam(const std::string &query, const char *name)
+  {
+    std::string key = std::string(name) + "=";
+    size_t pos = 0;
+    while ((pos = query.find(key, pos)) != std::string::npos)
+    {
+      if (pos == 0 || query[pos - 1] == '&' || query[pos - 1] == '?')
+      {
+        size_t start = pos + key.size();
+        size_t end = query.find('&', start);
+        return query.substr(start, end == std::string::npos ? std::string::npos : end - start);
+      }
+      pos += key.size();
+    }
+    return "";
+  }
+
+  bool writeAll(int fd, const char *data, size_t len)
+  {
+    while (len)
+    {
+      ssize_t n = write(fd, data, len);
+      if (n <= 0)
+        return false;
+      data += n;
+      len -= (size_t)n;
+    }
+    return true;
+  }
+
+  void sendResponse(int fd, int code, const char *type, const std::string &body)
+  {
+    char hdr[256];
+    int n = snprintf(hdr, sizeof(hdr), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                     code, code == 200 ? "OK" : (code == 404 ? "Not Found" : "Bad Request"), type, body.size());
+    if (writeAll(fd, hdr, n))
+      writeAll(fd, body.data(), body.size());
+  }
+
+  void serveQuery(int fd, const std::vector<std::unique_ptr<Kit>> &kits)
+  {
+    char req[2048];
+    ssize_t n = read(fd, req, sizeof(req) - 1);
+    if (n <= 0)
+      return;
+    req[n] = '\0';
+    char method[8], target[1024];
+    if (sscanf(req, "%7s %1023s", method, target) != 2 || strcmp(method, "GET") != 0)
+    {
+      sendResponse(fd, 400, "text/plain", "bad request\n");
+      return;
+    }
+    std::string path(target);
+    std::string query;
+    size_t q = path.find('?');
+    if (q != std::string::npos)
+    {
+      query = path.substr(q + 1);
+      path.resize(q);
+    }
+
+    if (path == "/tanks")
+    {
+      std::string body = "tank,rows,channels\n";
+      for (auto &k : kits)
+      {
+        body += k->tank->id + "," + std::to_string(k->tank->rows()) + ",";
+        for (int i = 0; i < k->tank->channels(); i++)
+          body += (i ? ";" : "") + k->tank->channelName(i);
+        body += "\n";
+      }
+      sendResponse(fd, 200, "text/csv", body);
+      return;
+    }
+    if (path != "/query")
+    {
+      sendResponse(fd, 404, "text/plain", "not found\n");
+      return;
+    }
+
+    std::string tankId = queryParam(query, "tank");
+    std::string channelKey = queryParam(query, "channel");
+    std::string fromStr = queryParam(query, "from");
+    std::string toStr = queryParam(query, "to");
+    int64_t from = fromStr.empty() ? 0 : strtoll(fromStr.c_str(), nullptr, 10);
+    int64_t to = toStr.empty() ? INT64_MAX : strtoll(toStr.c_str(), nullptr, 10);
+
+    const colstore::Tank *tank = nullptr;
+    for (auto &k : kits)
+      if (k->tank->id == tankId)
+        tank = k->tank.get();
+    int channel = tank ? tank->channelIndex(channelKey.c_str()) : -1;
+    if (!tank || channel < 0 || from > to)
+    {
+      sendResponse(fd, 400, "text/plain", "parameter tank/channel/from/to tidak valid\n");
+      return;
+    }
+
+    size_t first, last;
+    tank->range(from, to, first, last);
+    const int64_t *t = tank->timestamps();
+    const float *v = tank->values(channel);
+
+    // Header tanpa Content-Length lalu tulis bertahap dari buffer tetap
+    const char *hdr = "HTTP/1.1 200 OK\r\nContent-Type: text/csv\r\nConnection: close\r\n\r\nt_ms,value\n";
+    if (!writeAll(fd, hdr, strlen(hdr)))
+      return;
+    char buf[16384];
+    size_t len = 0;
+    for (size_t i = first; i < last; i++)
+    {
+      if (isnan(v[i]))
+        continue; // kanal belum/tidak dikirim kit pada baris ini
+      if (len + 48 > sizeof(buf))
+      {
+        if (!writeAll(fd, buf, len))
+          return;
+        len = 0;
+      }
+      len += (size_t)snprintf(buf + len, sizeof(buf) - len, "%lld,%.3f\n", (long long)t[i], v[i]);
+    }
+    writeAll(fd, buf, len);
+  }
+
+  void queryServer(uint16_t port, const std::vector<std::unique_ptr<Kit>> &kits)
+  {
+    int lfd = socket(AF_INET6, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int one = 1;
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in6 addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin6_family = AF_INET6;
+    addr.sin6_addr = in6addr_any;
+    addr.sin6_port = htons(port);
+    if (bind(lfd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(lfd, 64) != 0)
+    {
+      perror("query server");
+      return;
+    }
+    fprintf(stderr, "query server di port %u\n", port);
+    while (running.load(std::memory_order_relaxed))
+    {
+      // timeout accept supaya shutdown tidak menggantung
+      struct timeval tv = {1, 0};
+      setsockopt(lfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+      int fd = accept4(lfd, nullptr, nullptr, SOCK_CLOEXEC);
+      if (fd < 0)
+        continue;
+      setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+      serveQuery(fd, kits);
+      close(fd);
+    }
+    close(lfd);
+  }
+
+  bool loadKits(const char *path, std::vector<std::unique_ptr<Kit>> &kits, const std::string &dataDir, size_t capacity)
+  {
+    std::vector<std::string> keys;
+    for (int i = 0; i < channelCount; i++)
+      keys.push_back(channels[i].key);
+
+    FILE *f = fopen(path, "r");
+    if (!f)
+    {
+      perror(path);
+      return false;
+    }
+    char line[512];
+    int lineNo = 0;
+    while (fgets(line, sizeof(line), f))
+    {
+      lineNo++;
+      char id[128], host[256];
+      unsigned port = 81;
+      if (line[0] == '#' || sscanf(line, "%127s %255s %u", id, host, &port) < 2)
+        continue;
+
+      std::unique_ptr<Kit> kit(new Kit());
+      kit->host = host;
+      kit->port = (uint16_t)port;
+      addrinfo hints, *res;
+      memset(&hints, 0, sizeof(hints));
+      hints.ai_socktype = SOCK_STREAM;
+      if (getaddrinfo(host, std::to_string(port).c_str(), &hints, &res) != 0)
+      {
+        fprintf(stderr, "%s:%d: host %s tidak dikenal\n", path, lineNo, host);
+        continue;
+      }
+      memcpy(&kit->addr, res->ai_addr, res->ai_addrlen);
+      kit->addrLen = res->ai_addrlen;
+      freeaddrinfo(res);
+
+      kit->tank.reset(new colstore::Tank(id, keys));
+      if (!kit->tank->open(dataDir, capacity))
+      {
+        fprintf(stderr, "gagal membuka penyimpanan untuk %s di %s\n", id, dataDir.c_str());
+        fclose(f);
+        return false;
+      }
+      kits.push_back(std::move(kit));
+    }
+    fclose(f);
+    return true;
+  }
+
+  void raiseFdLimit()
+  {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0)
+    {
+      rl.rlim_cur = rl.rlim_max;
+      setrlimit(RLIMIT_NOFILE, &rl);
+    }
+  }
+
+  void onSignal(int) { running = false; }
+
+  void usage()
+  {
+    fprintf(stderr, "usage: collector --kits FILE [--data-dir DIR] [--threads N] [--query-port P] [--capacity ROWS]"
+                    " [--silence-ms MS]\n");
+  }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  const char *kitsPath = nullptr;
+  std::string dataDir = "data";
+  int threads = 4;
+  uint16_t queryPort = 8090;
+  size_t capacity = 4u << 20; // ~48 hari pada 1 sampel/detik
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string a = argv[i];
+    if (i + 1 >= argc)
+    {
+      usage();
+      return 2;
+    }
+    if (a == "--kits")
+      kitsPath = argv[++i];
+    else if (a == "--data-dir")
+      dataDir = argv[++i];
+    else if (a == "--threads")
+      threads = atoi(argv[++i]);
+    else if (a == "--query-port")
+      queryPort = (uint16_t)atoi(argv[++i]);
+    else if (a == "--capacity")
+      capacity = strtoull(argv[++i], nullptr, 10);
+    else if (a == "--silence-ms")
+      silenceTimeoutMs = atol(argv[++i]);
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (!kitsPath || threads < 1 || capacity == 0 || silenceTimeoutMs <= 0)
+  {
+    usage();
+    return 2;
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  signal(SIGPIPE, SIG_IGN);
+  raiseFdLimit();
+  if (mkdir(dataDir.c_str(), 0755) != 0 && errno != EEXIST)
+  {
+    perror(dataDir.c_str());
+    return 1;
+  }
+
+  std::vector<std::unique_ptr<Kit>> kits;
+  if (!loadKits(kitsPath, kits, dataDir, capacity))
+    return 1;
+  fprintf(stderr, "%zu kit, %d worker\n", kits.size(), threads);
+
+  // Kit dibagi round-robin: setiap tangki hanya ditulis oleh satu worker
+  std::vector<Worker> workers(threads);
+  for (size_t i = 0; i < kits.size(); i++)
+    workers[i % threads].add(kits[i].get());
+
+  std::vector<std::thread> pool;
+  for (auto &w : workers)
+    pool.emplace_back(&Worker::run, &w);
+  std::thread query(queryServer, queryPort, std::cref(kits));
+
+  uint64_t lastRows = 0;
+  while (running)
+  {
+    for (int i = 0; i < 10 && running; i++)
+      sleep(1);
+    uint64_t rows = stats.rows.load();
+    fprintf(stderr, "terhubung %d/%zu, baris %llu (+%.1f/s), pesan %llu, putus %llu, timeout %llu\n",
+            stats.open.load(), kits.size(), (unsigned long long)rows, (rows - lastRows) / 10.0,
+            (unsigned long long)stats.messages.load(), (unsigned long long)stats.disconnects.load(),
+            (unsigned long long)stats.timeouts.load());
+    lastRows = rows;
+  }
+
+  for (auto &t : pool)
+    t.join();
+  query.join();
+  return 0;
+}
@@ -0,0 +1,355 @@
+#pragma once
+
+// Penyimpanan kolumnar berbasis mmap: satu file per kolom per tangki.
+//
+//   <data-dir>/<tank>/t.col     int64  timestamp (ms epoch, waktu terima di host)
+//   <data-dir>/<tank>/<ch>.col  float  nilai kanal, NaN = tidak ada di pesan
+//
+// Setiap file = header 64 byte + array elemen. Header versi 2 menyimpan nama
+// kolom (key kanal firmware), jadi isi direktori tangki menjelaskan dirinya
+// sendiri; file versi 1 (tanpa nama) dinaikkan saat dibuka. Ruang virtual untuk
+// `capacity` baris dipetakan sekali di awal sehingga alamat tidak pernah
+// berpindah; file fisik diperbesar bertahap dengan ftruncate. Satu thread
+// penulis per tangki, pembaca (query) cukup membaca `count` dengan
+// memory_order_acquire.
+//
+// Daftar kanal tangki = kanal yang diminta (tabel channels firmware,
+// include/KitChannels.h) ditambah kolom lama yang sudah ada di direktorinya.
+// Kanal baru pada tangki lama diisi NaN untuk baris yang sudah ada.
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace colstore
+{
+
+  struct ColumnHeader
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t elemSize;
+    std::atomic<uint64_t> count;
+    char name[32]; // versi 2: nama kolom, diakhiri '\0'; versi 1: nol
+    uint8_t reserved[8];
+  };
+  static_assert(sizeof(ColumnHeader) == 64, "header kolom harus 64 byte");
+
+  const char kMagic[8] = {'K', 'O', 'L', 'A', 'M', 'C', 'O', 'L'};
+  const uint32_t kVersion = 2;
+  const size_t kGrowRows = 64 * 1024;
+  const size_t kMaxNameLen = sizeof(ColumnHeader::name) - 1;
+  const int kMaxChannels = 32;
+
+  /// @brief nama kolom yang aman dipakai sebagai nama file
+  inline bool validName(const std::string &name)
+  {
+    if (name.empty() || name.size() > kMaxNameLen || name == "t")
+      return false;
+    for (char c : name)
+      if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-'))
+        return false;
+    return true;
+  }
+
+  template <typename T>
+  class Column
+  {
+  public:
+    Column() : fd(-1), base(nullptr), mapBytes(0), fileBytes(0), capacity(0), fresh(false) {}
+    Column(const Column &) = delete;
+    Column &operator=(const Column &) = delete;
+    ~Column() { close(); }
+
+    /// @param name nama kolom untuk header; file lama dengan nama lain ditolak
+    bool open(const std::string &path, size_t capacityRows, const std::string &name)
+    {
+      fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+      if (fd < 0)
+        return false;
+      struct stat st;
+      if (fstat(fd, &st) != 0)
+        return false;
+      fileBytes = (size_t)st.st_size;
+      capacity = capacityRows;
+      mapBytes = sizeof(ColumnHeader) + capacity * sizeof(T);
+
+      fresh = fileBytes < sizeof(ColumnHeader);
+      if (fresh && !grow(sizeof(ColumnHeader) + kGrowRows * sizeof(T)))
+        return false;
+
+      void *p = mmap(nullptr, mapBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (p == MAP_FAILED)
+        return false;
+      base = (uint8_t *)p;
+
+      ColumnHeader *h = header();
+      if (fresh)
+      {
+        memcpy(h->magic, kMagic, sizeof(kMagic));
+        h->elemSize = sizeof(T);
+        h->count.store(0, std::memory_order_release);
+      }
+      else if (memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 || h->elemSize != sizeof(T) ||
+               h->version < 1 || h->version > kVersion)
+      {
+        fprintf(stderr, "colstore: %s bukan file kolom yang valid\n", path.c_str());
+        return false;
+      }
+      else if (h->version >= 2 && strncmp(h->name, name.c_str(), sizeof(h->name)) != 0)
+      {
+        fprintf(stderr, "colstore: %s berisi kolom \"%.*s\", bukan \"%s\"\n", path.c_str(),
+                (int)kMaxNameLen, h->name, name.c_str());
+        return false;
+      }
+      if (h->version != kVersion)
+      {
+        memset(h->name, 0, sizeof(h->name));
+        memcpy(h->name, name.c_str(), name.size() < kMaxNameLen ? name.size() : kMaxNameLen);
+        h->version = kVersion;
+      }
+      if (size() > capacity)
+        h->count.store(capacity, std::memory_order_release);
+      return true;
+    }
+
+    void close()
+    {
+      if (base)
+      {
+        msync(base, sizeof(ColumnHeader), MS_ASYNC);
+        munmap(base, mapBytes);
+        base = nullptr;
+      }
+      if (fd >= 0)
+      {
+        ::close(fd);
+        fd = -1;
+      }
+    }
+
+    /// @brief tulis elemen ke-n (belum terlihat pembaca sampai publish())
+    bool write(size_t n, T v)
+    {
+      if (n >= capacity)
+        return false;
+      size_t need = sizeof(ColumnHeader) + (n + 1) * sizeof(T);
+      if (need > fileBytes && !grow(need + kGrowRows * sizeof(T)))
+        return false;
+      mutableData()[n] = v;
+      return true;
+    }
+
+    /// @brief isi baris [size(), n) dengan v lalu publikasikan (kolom baru pada tangki lama)
+    bool fill(size_t n, T v)
+    {
+      for (size_t i = size(); i < n; i++)
+        if (!write(i, v))
+          return false;
+      publish(n);
+      return true;
+    }
+
+    void publish(size_t n) { header()->count.store(n, std::memory_order_release); }
+    /// @brief file baru dibuat oleh open()
+    bool created() const { return fresh; }
+    size_t size() const { return (size_t)header()->count.load(std::memory_order_acquire); }
+    const T *data() const { return (const T *)(base + sizeof(ColumnHeader)); }
+
+  private:
+    ColumnHeader *header() const { return (ColumnHeader *)base; }
+    T *mutableData() { return (T *)(base + sizeof(ColumnHeader)); }
+
+    bool grow(size_t bytes)
+    {
+      if (bytes > mapBytes)
+        bytes = mapBytes;
+      if (bytes <= fileBytes)
+        return true;
+      if (ftruncate(fd, (off_t)bytes) != 0)
+        return false;
+      fileBytes = bytes;
+      return true;
+    }
+
+    int fd;
+    uint8_t *base;
+    size_t mapBytes;
+    size_t fileBytes;
+    size_t capacity;
+    bool fresh;
+  };
+
+  /// @brief nama kolom file kanal: nama di header (versi 2) atau nama file (versi 1)
+  inline std::string readColumnName(const std::string &dir, const std::string &file)
+  {
+    std::string stem = file.substr(0, file.size() - 4);
+    ColumnHeader h;
+    int fd = ::open((dir + "/" + file).c_str(), O_RDONLY);
+    if (fd < 0)
+      return std::string();
+    bool ok = pread(fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h);
+    ::close(fd);
+    if (!ok || memcmp(h.magic, kMagic, sizeof(kMagic)) != 0)
+      return std::string();
+    if (h.version < 2)
+      return stem;
+    std::string name(h.name, strnlen(h.name, sizeof(h.name)));
+    return name == stem ? name : std::string(); // file diganti nama: jangan ditebak
+  }
+
+  /// @brief semua kolom milik satu tangki
+  class Tank
+  {
+  public:
+    /// @param channelKeys kanal yang diminta, biasanya key tabel channels firmware
+    Tank(const std::string &tankId, const std::vector<std::string> &channelKeys)
+        : id(tankId), names(channelKeys), lastTs(0)
+    {
+    }
+
+    bool open(const std::string &dataDir, size_t capacityRows)
+    {
+      std::string dir = dataDir + "/" + id;
+      if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+        return false;
+      if (!ts.open(dir + "/t.col", capacityRows, "t"))
+        return false;
+
+      // Kolom lama yang tidak ada di daftar (kanal dihapus dari firmware) tetap
+      // bisa di-query; baris barunya NaN
+      std::vector<std::string> old;
+      if (DIR *d = opendir(dir.c_str()))
+      {
+        while (struct dirent *e = readdir(d))
+        {
+          std::string file = e->d_name;
+          if (file.size() <= 4 || file.compare(file.size() - 4, 4, ".col") != 0 || file == "t.col")
+            continue;
+          std::string name = readColumnName(dir, file);
+          if (validName(name) && channelIndex(name.c_str()) < 0)
+            old.push_back(name);
+        }
+        closedir(d);
+      }
+      std::sort(old.begin(), old.end());
+      names.insert(names.end(), old.begin(), old.end());
+      if (names.empty() || names.size() > (size_t)kMaxChannels)
+      {
+        fprintf(stderr, "colstore: %s: jumlah kanal %zu di luar 1..%d\n", id.c_str(), names.size(), kMaxChannels);
+        return false;
+      }
+
+      size_t n = ts.size();
+      for (const std::string &name : names)
+      {
+        if (!validName(name))
+        {
+          fprintf(stderr, "colstore: nama kanal \"%s\" tidak valid\n", name.c_str());
+          return false;
+        }
+        std::unique_ptr<Column<float>> c(new Column<float>());
+        if (!c->open(dir + "/" + name + ".col", capacityRows, name))
+          return false;
+        // Kanal baru pada tangki lama: baris yang sudah ada tidak punya nilai
+        if (c->created() && !c->fill(n, NAN))
+          return false;
+        ch.push_back(std::move(c));
+      }
+
+      // Setelah crash, kolom bisa berbeda panjang; pakai yang terpendek
+      for (auto &c : ch)
+        n = c->size() < n ? c->size() : n;
+      ts.publish(n);
+      for (auto &c : ch)
+        c->publish(n);
+      lastTs = n ? ts.data()[n - 1] : 0;
+      return true;
+    }
+
+    int channels() const { return (int)names.size(); }
+    const std::string &channelName(int i) const { return names[i]; }
+
+    /// @brief indeks kanal untuk nama, -1 jika tidak ada
+    int channelIndex(const char *name) const
+    {
+      for (size_t i = 0; i < names.size(); i++)
+        if (names[i] == name)
+          return (int)i;
+      return -1;
+    }
+
+    /// @brief tambah satu baris (values[channels()], NaN = tidak ada);
+    /// hanya dipanggil dari thread pemilik tangki
+    bool append(int64_t t, const float *values)
+    {
+      if (t < lastTs)
+        t = lastTs; // jaga timestamp monoton agar query bisa binary search
+      size_t n = ts.size();
+      if (!ts.write(n, t))
+        return false;
+      for (auto &c : ch)
+        if (!c->write(n, *values++))
+          return false;
+      // Kanal dipublikasikan dulu, timestamp terakhir: pembaca memakai ts.size()
+      for (auto &c : ch)
+        c->publish(n + 1);
+      ts.publish(n + 1);
+      lastTs = t;
+      return true;
+    }
+
+    size_t rows() const { return ts.size(); }
+
+    /// @brief indeks [first, last) untuk rentang waktu [from, to]
+    void range(int64_t from, int64_t to, size_t &first, size_t &last) const
+    {
+      size_t n = ts.size();
+      const int64_t *t = ts.data();
+      size_t lo = 0, hi = n;
+      while (lo < hi)
+      {
+        size_t mid = lo + (hi - lo) / 2;
+        if (t[mid] < from)
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+      first = lo;
+      hi = n;
+      while (lo < hi)
+      {
+        size_t mid = lo + (hi - lo) / 2;
+        if (t[mid] <= to)
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+      last = lo;
+    }
+
+    const int64_t *timestamps() const { return ts.data(); }
+    const float *values(int channel) const { return ch[channel]->data(); }
+
+    const std::string id;
+
+  private:
+    Column<int64_t> ts;
+    std::vector<std::string> names;
+    std::vector<std::unique_ptr<Column<float>>> ch;
+    int64_t lastTs;
+  };
+
+} // namespace colstore
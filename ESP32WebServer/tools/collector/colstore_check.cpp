@@ -0,0 +1,118 @@
+// Uji format kolom colstore.h di direktori sementara.
+//
+//   colstore_check     exit 1 jika ada pemeriksaan gagal
+//
+//   1. file versi 1 (tanpa nama di header) tetap terbaca dan dinaikkan ke versi 2
+//   2. kanal baru pada tangki lama: kolom dibuat dan baris lama diisi NaN
+//   3. kanal yang dihapus dari daftar tetap ditemukan dari direktori tangki
+//   4. file kolom berisi kanal lain ditolak
+
+#include "colstore.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+  int failures = 0;
+
+  void check(bool ok, const char *what)
+  {
+    printf("%-62s %s\n", what, ok ? "ok" : "GAGAL");
+    if (!ok)
+      failures++;
+  }
+
+  /// @brief tulis ulang header kolom seperti versi 1 (nama nol)
+  bool downgradeToV1(const std::string &path)
+  {
+    int fd = ::open(path.c_str(), O_RDWR);
+    if (fd < 0)
+      return false;
+    colstore::ColumnHeader h;
+    bool ok = pread(fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h);
+    h.version = 1;
+    memset(h.name, 0, sizeof(h.name));
+    ok = ok && pwrite(fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h);
+    ::close(fd);
+    return ok;
+  }
+
+  uint32_t headerVersion(const std::string &path, std::string &name)
+  {
+    colstore::ColumnHeader h;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0 || pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h))
+      h.version = 0;
+    if (fd >= 0)
+      ::close(fd);
+    name.assign(h.name, strnlen(h.name, sizeof(h.name)));
+    return h.version;
+  }
+
+} // namespace
+
+int main()
+{
+  char tmpl[] = "/tmp/colstore-XXXXXX";
+  if (!mkdtemp(tmpl))
+  {
+    perror("mkdtemp");
+    return 2;
+  }
+  const std::string dir = tmpl;
+  const std::string tankDir = dir + "/kolam";
+  const size_t capacity = 1024;
+
+  {
+    colstore::Tank tank("kolam", {"ph", "turb"});
+    check(tank.open(dir, capacity), "tangki baru dengan kanal ph, turb");
+    for (int i = 0; i < 3; i++)
+    {
+      const float v[2] = {7.0f + i, 40.0f + i};
+      tank.append(1000 + i, v);
+    }
+  }
+  check(downgradeToV1(tankDir + "/turb.col"), "turb.col ditulis ulang sebagai versi 1");
+
+  {
+    colstore::Tank tank("kolam", {"ph", "turb", "oks"});
+    check(tank.open(dir, capacity), "dibuka lagi dengan kanal baru oks");
+    check(tank.rows() == 3 && tank.channels() == 3, "  3 baris, 3 kanal");
+    int oks = tank.channelIndex("oks");
+    bool allNan = oks >= 0;
+    for (size_t i = 0; allNan && i < tank.rows(); i++)
+      allNan = isnan(tank.values(oks)[i]);
+    check(allNan, "  baris lama kanal oks = NaN");
+    int turb = tank.channelIndex("turb");
+    check(turb >= 0 && tank.values(turb)[2] == 42.0f, "  isi turb versi 1 tetap terbaca");
+    const float v[3] = {7.5f, NAN, 5.5f};
+    check(tank.append(2000, v), "  tambah baris dengan turb hilang (NaN)");
+  }
+  std::string name;
+  check(headerVersion(tankDir + "/turb.col", name) == 2 && name == "turb", "turb.col dinaikkan ke versi 2 dengan nama");
+
+  {
+    colstore::Tank tank("kolam", {"ph"});
+    check(tank.open(dir, capacity), "dibuka lagi hanya dengan kanal ph");
+    check(tank.channels() == 3 && tank.channelName(1) == "oks" && tank.channelName(2) == "turb",
+          "  oks dan turb ditemukan dari direktori tangki");
+    int oks = tank.channelIndex("oks");
+    check(tank.rows() == 4 && oks >= 0 && tank.values(oks)[3] == 5.5f, "  4 baris, nilai oks baru tersimpan");
+  }
+
+  if (rename((tankDir + "/oks.col").c_str(), (tankDir + "/do.col").c_str()) == 0)
+  {
+    colstore::Tank tank("kolam", {"ph", "do"});
+    check(!tank.open(dir, capacity), "do.col berisi kolom oks ditolak");
+  }
+
+  if (system(("rm -rf " + dir).c_str()) != 0)
+    fprintf(stderr, "gagal menghapus %s\n", dir.c_str());
+  printf("%s\n", failures ? "GAGAL" : "semua lolos");
+  return failures ? 1 : 0;
+}
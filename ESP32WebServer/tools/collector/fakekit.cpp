@@ -0,0 +1,295 @@
+// Fake-kit: mensimulasikan ribuan ESP32 di satu mesin untuk load-test collector.
+// Setiap koneksi WebSocket yang masuk diperlakukan sebagai satu kit dan
+// menerima telemetri dengan format yang sama seperti broadcastTelemetry()
+// di firmware: {"t":..,"ph":..,"turb":..,"oks":..,"suhu":..}
+//
+//   fakekit [--port 8181] [--rate 1] [--emit-kits N kits.txt] [--host 127.0.0.1]
+//           [--stall-after S]
+//
+// --emit-kits menulis file kits.txt berisi N tangki yang semuanya mengarah ke
+// port fake-kit ini, lalu jalankan: collector --kits kits.txt
+// --stall-after S meniru kit yang reboot/lepas WiFi: setelah S detik terhubung,
+// kit berhenti mengirim tanpa menutup socket (tanpa FIN). Collector harus
+// menutup koneksi diam itu dan menyambung ulang; tiap koneksi baru kembali
+// mengirim selama S detik.
+
+#include "ws.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+
+namespace
+{
+
+  volatile sig_atomic_t running = 1;
+
+  struct Sim
+  {
+    int fd;
+    bool open = false;
+    char req[2048];
+    size_t reqLen = 0;
+    // state random-walk per kit
+    float ph, turb, oks, suhu;
+    uint32_t t = 0;
+    uint32_t sentCount = 0; // pesan telemetri pada koneksi ini
+  };
+
+  float walk(float v, float step, float lo, float hi)
+  {
+    v += ((float)rand() / RAND_MAX - 0.5f) * 2.0f * step;
+    return v < lo ? lo : (v > hi ? hi : v);
+  }
+
+  bool handshake(Sim &s)
+  {
+    s.req[s.reqLen] = '\0';
+    if (!strstr(s.req, "\r\n\r\n"))
+      return true; // tunggu sisa header
+    const char *k = strcasestr(s.req, "Sec-WebSocket-Key:");
+    if (!k)
+      return false;
+    k += 18;
+    while (*k == ' ')
+      k++;
+    const char *e = strstr(k, "\r\n");
+    std::string accept = ws::acceptKey(std::string(k, e - k));
+
+    char resp[256];
+    int n = snprintf(resp, sizeof(resp),
+                     "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                     "Sec-WebSocket-Accept: %s\r\n\r\n",
+                     accept.c_str());
+    if (write(s.fd, resp, n) != n)
+      return false;
+    s.open = true;
+    // status awal seperti WStype_CONNECTED di firmware
+    const char *status = "{\"relay1\":false,\"relay2\":false,\"relay3\":false,\"relay4\":false,\"relay5\":false,\"mode\":\"auto\"}";
+    uint8_t out[160];
+    size_t len = ws::writeFrame(out, ws::OP_TEXT, (const uint8_t *)status, strlen(status));
+    return write(s.fd, out, len) == (ssize_t)len;
+  }
+
+  void onSignal(int) { running = 0; }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  uint16_t port = 8181;
+  double rate = 1.0;
+  const char *host = "127.0.0.1";
+  long emitCount = 0;
+  const char *emitPath = nullptr;
+  double stallAfter = 0; // detik, 0 = tidak pernah diam
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string a = argv[i];
+    if (a == "--port" && i + 1 < argc)
+      port = (uint16_t)atoi(argv[++i]);
+    else if (a == "--rate" && i + 1 < argc)
+      rate = atof(argv[++i]);
+    else if (a == "--host" && i + 1 < argc)
+      host = argv[++i];
+    else if (a == "--emit-kits" && i + 2 < argc)
+    {
+      emitCount = atol(argv[++i]);
+      emitPath = argv[++i];
+    }
+    else if (a == "--stall-after" && i + 1 < argc)
+      stallAfter = atof(argv[++i]);
+    else
+    {
+      fprintf(stderr, "usage: fakekit [--port P] [--rate HZ] [--host H] [--emit-kits N FILE] [--stall-after S]\n");
+      return 2;
+    }
+  }
+  if (rate <= 0)
+    rate = 1.0;
+
+  if (emitPath)
+  {
+    FILE *f = fopen(emitPath, "w");
+    if (!f)
+    {
+      perror(emitPath);
+      return 1;
+    }
+    fprintf(f, "# dibuat oleh fakekit: <tank-id> <host> <port>\n");
+    for (long i = 0; i < emitCount; i++)
+      fprintf(f, "tank-%05ld %s %u\n", i, host, port);
+    fclose(f);
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  signal(SIGPIPE, SIG_IGN);
+  struct rlimit rl;
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0)
+  {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+
+  int lfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  int one = 1;
+  setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(lfd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(lfd, 4096) != 0)
+  {
+    perror("listen");
+    return 1;
+  }
+
+  int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  itimerspec its;
+  long periodNs = (long)(1e9 / rate);
+  its.it_interval.tv_sec = periodNs / 1000000000L;
+  its.it_interval.tv_nsec = periodNs % 1000000000L;
+  its.it_value = its.it_interval;
+  timerfd_settime(tfd, 0, &its, nullptr);
+
+  int ep = epoll_create1(EPOLL_CLOEXEC);
+  epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.ptr = nullptr; // listener
+  epoll_ctl(ep, EPOLL_CTL_ADD, lfd, &ev);
+  static int timerTag;
+  ev.data.ptr = &timerTag;
+  epoll_ctl(ep, EPOLL_CTL_ADD, tfd, &ev);
+
+  std::vector<std::unique_ptr<Sim>> sims;
+  uint64_t sent = 0;
+  uint64_t accepted = 0;
+  const uint32_t stallMessages = (uint32_t)(stallAfter * rate + 0.5);
+  time_t lastReport = time(nullptr);
+  fprintf(stderr, "fakekit di port %u, %.2f pesan/detik per kit\n", port, rate);
+  if (stallAfter > 0)
+    fprintf(stderr, "kit diam tanpa menutup socket setelah %u pesan\n", (unsigned)stallMessages);
+
+  auto closeSim = [&](Sim *s) {
+    epoll_ctl(ep, EPOLL_CTL_DEL, s->fd, nullptr);
+    close(s->fd);
+    s->fd = -1;
+  };
+
+  epoll_event events[512];
+  while (running)
+  {
+    int n = epoll_wait(ep, events, 512, 1000);
+    for (int i = 0; i < n; i++)
+    {
+      void *tag = events[i].data.ptr;
+      if (!tag)
+      {
+        int fd;
+        while ((fd = accept4(lfd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+        {
+          setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+          accepted++;
+          std::unique_ptr<Sim> s(new Sim());
+          s->fd = fd;
+          s->ph = 7.0f;
+          s->turb = 40.0f;
+          s->oks = 7.5f;
+          s->suhu = 27.0f;
+          epoll_event cev;
+          cev.events = EPOLLIN;
+          cev.data.ptr = s.get();
+          epoll_ctl(ep, EPOLL_CTL_ADD, fd, &cev);
+          sims.push_back(std::move(s));
+        }
+      }
+      else if (tag == &timerTag)
+      {
+        uint64_t ticks;
+        if (read(tfd, &ticks, sizeof(ticks)) != sizeof(ticks))
+          continue;
+        for (auto &s : sims)
+        {
+          if (s->fd < 0 || !s->open)
+            continue;
+          if (stallMessages && s->sentCount >= stallMessages)
+            continue; // diam: socket tetap terbuka dan dibaca, tidak ada data
+          s->sentCount++;
+          s->t += (uint32_t)(1000 / rate);
+          s->ph = walk(s->ph, 0.02f, 5.5f, 9.0f);
+          s->turb = walk(s->turb, 0.5f, 0.0f, 100.0f);
+          s->oks = walk(s->oks, 0.05f, 2.0f, 12.0f);
+          s->suhu = walk(s->suhu, 0.02f, 20.0f, 32.0f);
+          char json[128];
+          int len = snprintf(json, sizeof(json), "{\"t\":%u,\"ph\":%.2f,\"turb\":%.2f,\"oks\":%.2f,\"suhu\":%.2f}",
+                             s->t, s->ph, s->turb, s->oks, s->suhu);
+          uint8_t out[160];
+          size_t flen = ws::writeFrame(out, ws::OP_TEXT, (const uint8_t *)json, len);
+          if (write(s->fd, out, flen) != (ssize_t)flen)
+            closeSim(s.get());
+          else
+            sent++;
+        }
+      }
+      else
+      {
+        Sim *s = (Sim *)tag;
+        if (s->fd < 0)
+          continue;
+        if (!s->open)
+        {
+          ssize_t r = read(s->fd, s->req + s->reqLen, sizeof(s->req) - 1 - s->reqLen);
+          if (r <= 0)
+          {
+            closeSim(s);
+            continue;
+          }
+          s->reqLen += (size_t)r;
+          if (!handshake(*s) || (!s->open && s->reqLen >= sizeof(s->req) - 1))
+            closeSim(s);
+          continue;
+        }
+        // Frame dari collector (pong/close) cukup dibuang; EOF = putus
+        uint8_t buf[1024];
+        ssize_t r = read(s->fd, buf, sizeof(buf));
+        if (r == 0 || (r < 0 && errno != EAGAIN))
+          closeSim(s);
+      }
+    }
+
+    // buang slot yang sudah ditutup
+    size_t w = 0;
+    for (size_t r = 0; r < sims.size(); r++)
+      if (sims[r]->fd >= 0)
+        sims[w++] = std::move(sims[r]);
+    sims.resize(w);
+
+    if (time(nullptr) - lastReport >= 10)
+    {
+      lastReport = time(nullptr);
+      fprintf(stderr, "kit aktif %zu, koneksi diterima %llu, total pesan %llu\n", sims.size(),
+              (unsigned long long)accepted, (unsigned long long)sent);
+    }
+  }
+  fprintf(stderr, "selesai: koneksi diterima %llu, total pesan %llu\n", (unsigned long long)accepted,
+          (unsigned long long)sent);
+  return 0;
+}
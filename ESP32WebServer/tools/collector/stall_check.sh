@@ -0,0 +1,54 @@
+#!/bin/sh
+# Uji liveness collector terhadap kit yang diam tanpa menutup socket.
+#
+#   ./stall_check.sh     exit 1 jika collector tidak menyambung ulang
+#
+# fakekit (--stall-after 2) berhenti mengirim setelah 2 pesan per koneksi tanpa
+# FIN. Dengan --silence-ms 1500, setiap kit harus ditutup collector sebagai
+# koneksi diam lalu disambung ulang, dan data harus kembali masuk setelahnya.
+
+set -u
+KITS=3
+PORT=${STALL_PORT:-18181}
+QPORT=${STALL_QUERY_PORT:-18090}
+DIR=$(mktemp -d /tmp/stall-XXXXXX)
+trap 'kill $FK $COL 2>/dev/null; wait 2>/dev/null; rm -rf "$DIR"' EXIT
+
+./fakekit --port "$PORT" --stall-after 2 --emit-kits "$KITS" "$DIR/kits.txt" 2>"$DIR/fakekit.log" &
+FK=$!
+sleep 0.3
+./collector --kits "$DIR/kits.txt" --data-dir "$DIR/data" --threads 1 --query-port "$QPORT" \
+  --silence-ms 1500 2>"$DIR/collector.log" &
+COL=$!
+sleep 11
+curl -s "http://127.0.0.1:$QPORT/tanks" >"$DIR/tanks.csv"
+kill -INT $FK $COL
+wait $FK $COL 2>/dev/null
+
+fails=0
+check() {
+  if [ "$1" -ne 0 ]; then
+    printf '%-62s GAGAL\n' "$2"
+    fails=$((fails + 1))
+  else
+    printf '%-62s ok\n' "$2"
+  fi
+}
+
+timeouts=$(grep -c "terhubung tanpa data" "$DIR/collector.log")
+[ "$timeouts" -ge "$KITS" ]
+check $? "koneksi diam ditutup collector ($timeouts kali, min $KITS)"
+
+accepted=$(sed -n 's/^selesai: koneksi diterima \([0-9]*\).*/\1/p' "$DIR/fakekit.log")
+[ "${accepted:-0}" -ge $((KITS * 2)) ]
+check $? "kit disambung ulang (${accepted:-0} koneksi, min $((KITS * 2)))"
+
+# Setiap koneksi mengirim 2 baris; lebih dari 2 baris per tangki = data masuk lagi setelah sambung ulang
+refilled=$(awk -F, '$1 ~ /^tank-/ && $2 > 2' "$DIR/tanks.csv" | wc -l)
+[ "$refilled" -eq "$KITS" ]
+check $? "data tiap tangki kembali masuk setelah sambung ulang ($refilled/$KITS)"
+
+[ "$fails" -eq 0 ] && echo "semua lolos" || echo "GAGAL"
+trap - EXIT
+rm -rf "$DIR"
+exit "$fails"
@@ -0,0 +1,240 @@
+#pragma once
+
+// Utilitas WebSocket minimal (RFC 6455) untuk collector dan fake-kit:
+// SHA-1 + base64 untuk handshake, encode/decode frame tanpa alokasi.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+namespace ws
+{
+
+  inline void sha1(const uint8_t *data, size_t len, uint8_t out[20])
+  {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    auto rol = [](uint32_t v, int n) { return (v << n) | (v >> (32 - n)); };
+
+    uint64_t bitLen = (uint64_t)len * 8;
+    size_t total = ((len + 8) / 64 + 1) * 64;
+    for (size_t off = 0; off < total; off += 64)
+    {
+      uint8_t block[64];
+      for (int i = 0; i < 64; i++)
+      {
+        size_t idx = off + i;
+        if (idx < len)
+          block[i] = data[idx];
+        else if (idx == len)
+          block[i] = 0x80;
+        else if (idx >= total - 8)
+          block[i] = (uint8_t)(bitLen >> (8 * (total - 1 - idx)));
+        else
+          block[i] = 0;
+      }
+
+      uint32_t w[80];
+      for (int i = 0; i < 16; i++)
+        w[i] = (uint32_t)block[4 * i] << 24 | (uint32_t)block[4 * i + 1] << 16 | (uint32_t)block[4 * i + 2] << 8 | block[4 * i + 3];
+      for (int i = 16; i < 80; i++)
+        w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+      uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+      for (int i = 0; i < 80; i++)
+      {
+        uint32_t f, k;
+        if (i < 20)
+        {
+          f = (b & c) | (~b & d);
+          k = 0x5A827999;
+        }
+        else if (i < 40)
+        {
+          f = b ^ c ^ d;
+          k = 0x6ED9EBA1;
+        }
+        else if (i < 60)
+        {
+          f = (b & c) | (b & d) | (c & d);
+          k = 0x8F1BBCDC;
+        }
+        else
+        {
+          f = b ^ c ^ d;
+          k = 0xCA62C1D6;
+        }
+        uint32_t tmp = rol(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rol(b, 30);
+        b = a;
+        a = tmp;
+      }
+      h[0] += a;
+      h[1] += b;
+      h[2] += c;
+      h[3] += d;
+      h[4] += e;
+    }
+    for (int i = 0; i < 5; i++)
+    {
+      out[4 * i] = (uint8_t)(h[i] >> 24);
+      out[4 * i + 1] = (uint8_t)(h[i] >> 16);
+      out[4 * i + 2] = (uint8_t)(h[i] >> 8);
+      out[4 * i + 3] = (uint8_t)h[i];
+    }
+  }
+
+  inline std::string base64(const uint8_t *data, size_t len)
+  {
+    static const char tbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < len; i += 3)
+    {
+      uint32_t v = (uint32_t)data[i] << 16;
+      if (i + 1 < len)
+        v |= (uint32_t)data[i + 1] << 8;
+      if (i + 2 < len)
+        v |= data[i + 2];
+      out += tbl[(v >> 18) & 63];
+      out += tbl[(v >> 12) & 63];
+      out += i + 1 < len ? tbl[(v >> 6) & 63] : '=';
+      out += i + 2 < len ? tbl[v & 63] : '=';
+    }
+    return out;
+  }
+
+  /// @brief nilai Sec-WebSocket-Accept untuk sebuah Sec-WebSocket-Key
+  inline std::string acceptKey(const std::string &key)
+  {
+    std::string s = key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    uint8_t digest[20];
+    sha1((const uint8_t *)s.data(), s.size(), digest);
+    return base64(digest, 20);
+  }
+
+  enum Opcode : uint8_t
+  {
+    OP_CONT = 0x0,
+    OP_TEXT = 0x1,
+    OP_BIN = 0x2,
+    OP_CLOSE = 0x8,
+    OP_PING = 0x9,
+    OP_PONG = 0xA
+  };
+
+  struct Frame
+  {
+    uint8_t opcode;
+    bool fin;
+    const uint8_t *payload; // menunjuk ke buffer input (sudah di-unmask in-place)
+    size_t length;
+  };
+
+  /// @brief parse satu frame dari buf; unmask payload di tempat jika perlu
+  /// @return jumlah byte yang dikonsumsi, 0 jika data belum lengkap, -1 jika rusak
+  inline long parseFrame(uint8_t *buf, size_t len, Frame &f, size_t maxPayload = 1 << 20)
+  {
+    if (len < 2)
+      return 0;
+    f.fin = buf[0] & 0x80;
+    f.opcode = buf[0] & 0x0F;
+    bool masked = buf[1] & 0x80;
+    uint64_t plen = buf[1] & 0x7F;
+    size_t pos = 2;
+    if (plen == 126)
+    {
+      if (len < 4)
+        return 0;
+      plen = (uint64_t)buf[2] << 8 | buf[3];
+      pos = 4;
+    }
+    else if (plen == 127)
+    {
+      if (len < 10)
+        return 0;
+      plen = 0;
+      for (int i = 0; i < 8; i++)
+        plen = plen << 8 | buf[2 + i];
+      pos = 10;
+    }
+    if (plen > maxPayload)
+      return -1;
+    uint8_t mask[4] = {0, 0, 0, 0};
+    if (masked)
+    {
+      if (len < pos + 4)
+        return 0;
+      memcpy(mask, buf + pos, 4);
+      pos += 4;
+    }
+    if (len < pos + plen)
+      return 0;
+    if (masked)
+      for (uint64_t i = 0; i < plen; i++)
+        buf[pos + i] ^= mask[i & 3];
+    f.payload = buf + pos;
+    f.length = (size_t)plen;
+    return (long)(pos + plen);
+  }
+
+  /// @brief tulis frame lengkap (FIN=1) ke out; frame dari client wajib memakai mask
+  /// @return panjang frame (out harus muat len + 14 byte)
+  inline size_t writeFrame(uint8_t *out, uint8_t opcode, const uint8_t *payload, size_t len, const uint8_t *mask = nullptr)
+  {
+    size_t pos = 0;
+    out[pos++] = 0x80 | opcode;
+    uint8_t maskBit = mask ? 0x80 : 0;
+    if (len < 126)
+      out[pos++] = maskBit | (uint8_t)len;
+    else if (len < 65536)
+    {
+      out[pos++] = maskBit | 126;
+      out[pos++] = (uint8_t)(len >> 8);
+      out[pos++] = (uint8_t)len;
+    }
+    else
+    {
+      out[pos++] = maskBit | 127;
+      for (int i = 7; i >= 0; i--)
+        out[pos++] = (uint8_t)((uint64_t)len >> (8 * i));
+    }
+    if (mask)
+    {
+      memcpy(out + pos, mask, 4);
+      pos += 4;
+    }
+    for (size_t i = 0; i < len; i++)
+      out[pos + i] = mask ? payload[i] ^ mask[i & 3] : payload[i];
+    return pos + len;
+  }
+
+  /// @brief ambil angka untuk "key" dari objek JSON datar, mis. {"ph":7.1,...}
+  inline bool jsonNumber(const char *json, size_t len, const char *key, double &out)
+  {
+    char pat[32];
+    int n = snprintf(pat, sizeof(pat), "\"%s\":", key);
+    if (n <= 0 || (size_t)n >= sizeof(pat))
+      return false;
+    const char *end = json + len;
+    for (const char *p = json; p + n <= end; p++)
+    {
+      if (memcmp(p, pat, n) != 0)
+        continue;
+      char tmp[32];
+      size_t m = 0;
+      for (const char *q = p + n; q < end && m < sizeof(tmp) - 1 && ((*q && strchr("+-.eE", *q)) || (*q >= '0' && *q <= '9')); q++)
+        tmp[m++] = *q;
+      tmp[m] = '\0';
+      if (!m)
+        return false;
+      out = strtod(tmp, nullptr);
+      return true;
+    }
+    return false;
+  }
+
+} // namespace ws
@@ -0,0 +1,113 @@
+"""Tanam file dasbor (folder data/) ke firmware saat build.
+
+Dipakai sebagai extra_script PlatformIO (pre:) dan bisa juga dijalankan
+langsung untuk melihat hasilnya:
+
+    python3 tools/embed_assets.py data /tmp/web_assets
+
+Setiap file dikompres gzip -9 (jika lebih kecil) lalu ditulis sebagai array
+const ke web_assets.cpp. Array const berada di .rodata sehingga pada ESP32
+dibaca langsung dari flash yang di-map ke memori (include/WebAssets.h).
+Tabel terurut menurut path berisi MIME, ukuran dan ETag (16 hex pertama
+SHA-256 isi asli). web_assets.json berisi manifest yang sama untuk dicek
+di luar firmware. File hanya ditulis ulang jika isinya berubah, jadi build
+inkremental tidak mengompilasi ulang aset.
+"""
+
+import gzip
+import hashlib
+import json
+import os
+import sys
+
+MIME_TYPES = {
+    ".html": "text/html; charset=utf-8",
+    ".js": "application/javascript",
+    ".css": "text/css",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+    ".ico": "image/x-icon",
+}
+
+
+def collect(data_dir):
+    assets = []
+    for name in sorted(os.listdir(data_dir)):
+        path = os.path.join(data_dir, name)
+        if name.startswith(".") or not os.path.isfile(path):
+            continue
+        ext = os.path.splitext(name)[1].lower()
+        if ext not in MIME_TYPES:
+            sys.exit("embed_assets: tipe file tidak dikenal: %s" % name)
+        with open(path, "rb") as f:
+            raw = f.read()
+        packed = gzip.compress(raw, 9, mtime=0)  # mtime=0: hasil sama tiap build
+        use_gzip = len(packed) < len(raw)
+        assets.append({
+            "path": "/" + name,
+            "mime": MIME_TYPES[ext],
+            "gzip": use_gzip,
+            "size": len(raw),
+            "length": len(packed) if use_gzip else len(raw),
+            "sha256": hashlib.sha256(raw).hexdigest(),
+            "body": packed if use_gzip else raw,
+        })
+    return assets
+
+
+def render(assets):
+    out = ["// Dibuat oleh tools/embed_assets.py dari data/, jangan disunting.",
+           '#include "WebAssets.h"', "", "namespace", "{"]
+    for i, a in enumerate(assets):
+        out.append("  // %s (%d -> %d byte)" % (a["path"], a["size"], a["length"]))
+        out.append("  const uint8_t asset%d[] = {" % i)
+        body = a["body"]
+        for k in range(0, len(body), 20):
+            out.append("      " + ",".join("0x%02x" % b for b in body[k:k + 20]) + ",")
+        out.append("  };")
+    out += ["} // namespace", "", "const WebAsset webAssets[] = {"]
+    for i, a in enumerate(assets):
+        out.append('    {"%s", "%s", asset%d, %d, %d, %s, "\\"%s\\""},' % (
+            a["path"], a["mime"], i, a["length"], a["size"],
+            "true" if a["gzip"] else "false", a["sha256"][:16]))
+    out += ["};", "const size_t webAssetCount = %d;" % len(assets), ""]
+    return "\n".join(out)
+
+
+def write_if_changed(path, text):
+    if os.path.exists(path):
+        with open(path) as f:
+            if f.read() == text:
+                return False
+    with open(path, "w") as f:
+        f.write(text)
+    return True
+
+
+def build(data_dir, out_dir):
+    assets = collect(data_dir)
+    if not any(a["path"] == "/index.html" for a in assets):
+        sys.exit("embed_assets: %s/index.html tidak ada" % data_dir)
+    if not os.path.isdir(out_dir):
+        os.makedirs(out_dir)
+    manifest = [{k: a[k] for k in ("path", "mime", "gzip", "size", "length", "sha256")} for a in assets]
+    write_if_changed(os.path.join(out_dir, "web_assets.json"), json.dumps(manifest, indent=1) + "\n")
+    if write_if_changed(os.path.join(out_dir, "web_assets.cpp"), render(assets)):
+        total = sum(a["length"] for a in assets)
+        print("embed_assets: %d file, %d byte di flash" % (len(assets), total))
+
+
+try:
+    Import("env")  # noqa: F821 (disediakan SCons/PlatformIO)
+except NameError:
+    env = None
+
+if env is not None:
+    gen_dir = os.path.join(env.subst("$BUILD_DIR"), "web_assets")
+    build(os.path.join(env.subst("$PROJECT_DIR"), "data"), gen_dir)
+    env.BuildSources("$BUILD_DIR/web_assets_obj", gen_dir)
+elif __name__ == "__main__":
+    if len(sys.argv) != 3:
+        sys.exit("usage: embed_assets.py DATA_DIR OUT_DIR")
+    build(sys.argv[1], sys.argv[2])
@@ -0,0 +1,434 @@
+// Modbus TCP slave tiruan kit di host + uji klien lokal.
+//
+//   modbus_sim [--port N]            jalankan uji klien terhadap server lokal, exit 1 jika gagal
+//   modbus_sim --serve [--port N]    hanya server, untuk dicoba dengan klien lain (mbpoll, pymodbus)
+//
+// Server memakai inti yang sama dengan firmware (include/ModbusTcp.h dan
+// antrian perintah include/CommandQueue.h) dengan peta register yang sama
+// dengan src/main.cpp: 4 kanal (ph, turb, oks, suhu), 5 relay dan mode.
+// "Tick kontrol" tiap 10 ms menerapkan perintah coil lalu mengisi ulang image,
+// seperti controlTick(). Port default 1502 (502 butuh root).
+
+#include "CommandQueue.h"
+#include "ModbusTcp.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+  const int channelCount = 4;
+  const int inputCount = channelCount * 2 + 4;
+  const int holdingCount = channelCount * 2;
+  const int coilCount = 6;
+  typedef ModbusSlave<inputCount, holdingCount, coilCount, channelCount> Modbus;
+
+  struct Threshold
+  {
+    float min, max;
+  };
+
+  // State "firmware"; hanya disentuh thread server
+  float values[channelCount] = {7.21f, 35.5f, 6.4f, 27.5f};
+  uint8_t faults[channelCount] = {0, 0, 0, 0x04};
+  Threshold thresholds[channelCount] = {{6.5f, 8.5f}, {20.0f, 70.0f}, {5.0f, 14.0f}, {20.0f, 30.0f}};
+  bool relayState[5] = {false, false, false, true, false};
+  bool autoMode = true;
+  SpscQueue<Command, 16> commandQueue;
+
+  int16_t scaled(float v)
+  {
+    if (isnan(v) || v > 327.67f || v < -327.67f)
+      return INT16_MIN;
+    return (int16_t)lroundf(v * 100.0f);
+  }
+
+  // Sama dengan modbusWriteCoils()/modbusWriteRegisters() di firmware
+  uint8_t writeCoils(uint16_t first, uint16_t count, const uint8_t *bits)
+  {
+    Command cmd = {0, 0xFF, 0, 0, CMD_MODE_KEEP};
+    for (uint16_t k = 0; k < count; k++)
+    {
+      int coil = first + k;
+      bool on = bits[k >> 3] & (1 << (k & 7));
+      if (coil < 5)
+      {
+        cmd.relayMask |= 1 << coil;
+        if (on)
+          cmd.relayOn |= 1 << coil;
+      }
+      else
+        cmd.mode = on ? CMD_MODE_AUTO : CMD_MODE_MANUAL;
+    }
+    bool manual = cmd.mode == CMD_MODE_KEEP ? !autoMode : cmd.mode == CMD_MODE_MANUAL;
+    if (cmd.relayMask && !manual)
+      return MB_DEVICE_FAILURE;
+    return commandQueue.push(cmd) ? MB_OK : MB_BUSY;
+  }
+
+  uint8_t writeRegisters(uint16_t first, uint16_t count, const uint16_t *regs)
+  {
+    Threshold next[channelCount];
+    memcpy(next, thresholds, sizeof(next));
+    for (uint16_t k = 0; k < count; k++)
+    {
+      int reg = first + k;
+      if ((int16_t)regs[k] == INT16_MIN)
+        return MB_ILLEGAL_VALUE;
+      float v = (int16_t)regs[k] / 100.0f;
+      if (reg & 1)
+        next[reg / 2].max = v;
+      else
+        next[reg / 2].min = v;
+    }
+    for (int i = 0; i < channelCount; i++)
+      if (!(next[i].min < next[i].max))
+        return MB_ILLEGAL_VALUE;
+    memcpy(thresholds, next, sizeof(next));
+    return MB_OK;
+  }
+
+  Modbus modbus({writeCoils, writeRegisters});
+
+  void controlTick(uint32_t uptime)
+  {
+    Command cmd;
+    while (commandQueue.pop(cmd))
+    {
+      if (cmd.mode != CMD_MODE_KEEP)
+        autoMode = cmd.mode == CMD_MODE_AUTO;
+      if (autoMode)
+        continue;
+      for (int i = 0; i < 5; i++)
+        if (cmd.relayMask & (1 << i))
+          relayState[i] = cmd.relayOn & (1 << i);
+    }
+    uint16_t mask = 0;
+    for (int i = 0; i < 5; i++)
+    {
+      mask |= relayState[i] << i;
+      modbus.setCoil(i, relayState[i]);
+    }
+    modbus.setCoil(5, autoMode);
+    for (int i = 0; i < channelCount; i++)
+    {
+      modbus.setInput(i, (uint16_t)scaled(values[i]));
+      modbus.setInput(channelCount + i, faults[i]);
+      modbus.setDiscrete(i, faults[i] != 0);
+      modbus.setHolding(2 * i, (uint16_t)scaled(thresholds[i].min));
+      modbus.setHolding(2 * i + 1, (uint16_t)scaled(thresholds[i].max));
+    }
+    modbus.setInput(2 * channelCount, mask);
+    modbus.setInput(2 * channelCount + 1, autoMode);
+    modbus.setInput(2 * channelCount + 2, (uint16_t)(uptime >> 16));
+    modbus.setInput(2 * channelCount + 3, (uint16_t)uptime);
+  }
+
+  struct Connection
+  {
+    int fd;
+    std::vector<uint8_t> buf;
+  };
+
+  std::atomic<bool> running{true};
+
+  int listenOn(uint16_t port)
+  {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0)
+    {
+      perror("bind/listen");
+      close(fd);
+      return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+  }
+
+  // Loop server non-blocking, padanan modbusPoll() + controlTick()
+  void serve(int listenFd)
+  {
+    std::vector<Connection> conns;
+    auto start = std::chrono::steady_clock::now();
+    uint8_t resp[modbusMaxAdu];
+    while (running)
+    {
+      // Tidur sampai ada data atau tick berikutnya (10 ms)
+      std::vector<pollfd> fds = {{listenFd, POLLIN, 0}};
+      for (auto &c : conns)
+        fds.push_back({c.fd, POLLIN, 0});
+      poll(fds.data(), fds.size(), 10);
+
+      int fd = accept(listenFd, nullptr, nullptr);
+      if (fd >= 0)
+      {
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        conns.push_back({fd, {}});
+      }
+      for (size_t i = 0; i < conns.size();)
+      {
+        Connection &c = conns[i];
+        uint8_t tmp[modbusMaxAdu];
+        ssize_t n = recv(c.fd, tmp, modbusMaxAdu - c.buf.size(), 0);
+        bool closed = n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+        if (n > 0)
+          c.buf.insert(c.buf.end(), tmp, tmp + n);
+        int frame;
+        while ((frame = Modbus::frameLength(c.buf.data(), c.buf.size())) > 0)
+        {
+          size_t len = modbus.handle(c.buf.data(), frame, resp);
+          if (send(c.fd, resp, len, MSG_NOSIGNAL) < 0)
+            closed = true;
+          c.buf.erase(c.buf.begin(), c.buf.begin() + frame);
+        }
+        if (closed || frame < 0)
+        {
+          close(c.fd);
+          conns.erase(conns.begin() + i);
+          continue;
+        }
+        i++;
+      }
+      auto up = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start).count();
+      controlTick((uint32_t)up);
+    }
+    for (auto &c : conns)
+      close(c.fd);
+  }
+
+  // ===== Klien uji =====
+  int failures = 0;
+  uint16_t transaction = 0;
+
+  void check(bool ok, const char *what)
+  {
+    printf("%-58s %s\n", what, ok ? "ok" : "GAGAL");
+    if (!ok)
+      failures++;
+  }
+
+  int connectTo(uint16_t port)
+  {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+      perror("connect");
+      close(fd);
+      return -1;
+    }
+    timeval tv = {2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+  }
+
+  std::vector<uint8_t> adu(const std::vector<uint8_t> &pdu)
+  {
+    transaction++;
+    std::vector<uint8_t> a(7 + pdu.size());
+    a[0] = (uint8_t)(transaction >> 8);
+    a[1] = (uint8_t)transaction;
+    a[4] = (uint8_t)((pdu.size() + 1) >> 8);
+    a[5] = (uint8_t)(pdu.size() + 1);
+    a[6] = 1; // unit id
+    memcpy(a.data() + 7, pdu.data(), pdu.size());
+    return a;
+  }
+
+  // Baca satu ADU respons; kosong jika timeout/koneksi ditutup
+  std::vector<uint8_t> readAdu(int fd)
+  {
+    std::vector<uint8_t> r(7);
+    size_t got = 0;
+    while (got < 7)
+    {
+      ssize_t n = recv(fd, r.data() + got, 7 - got, 0);
+      if (n <= 0)
+        return {};
+      got += n;
+    }
+    size_t total = 6 + (r[4] << 8 | r[5]);
+    r.resize(total);
+    while (got < total)
+    {
+      ssize_t n = recv(fd, r.data() + got, total - got, 0);
+      if (n <= 0)
+        return {};
+      got += n;
+    }
+    return r;
+  }
+
+  // PDU respons untuk satu permintaan; memeriksa transaction id
+  std::vector<uint8_t> request(int fd, const std::vector<uint8_t> &pdu)
+  {
+    std::vector<uint8_t> a = adu(pdu);
+    send(fd, a.data(), a.size(), MSG_NOSIGNAL);
+    std::vector<uint8_t> r = readAdu(fd);
+    if (r.size() < 8 || r[0] != a[0] || r[1] != a[1])
+      return {};
+    return std::vector<uint8_t>(r.begin() + 7, r.end());
+  }
+
+  std::vector<uint8_t> readPdu(uint8_t fn, uint16_t first, uint16_t count)
+  {
+    return {fn, (uint8_t)(first >> 8), (uint8_t)first, (uint8_t)(count >> 8), (uint8_t)count};
+  }
+
+  uint16_t reg(const std::vector<uint8_t> &r, int i) { return (uint16_t)(r[2 + 2 * i] << 8 | r[3 + 2 * i]); }
+
+  bool isException(const std::vector<uint8_t> &r, uint8_t fn, uint8_t code)
+  {
+    return r.size() == 2 && r[0] == (fn | 0x80) && r[1] == code;
+  }
+
+  void settle() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); }
+
+  int runClient(uint16_t port)
+  {
+    int fd = connectTo(port);
+    if (fd < 0)
+      return 1;
+
+    auto r = request(fd, readPdu(MB_READ_INPUT, 0, inputCount));
+    check(r.size() == 2 + inputCount * 2u && r[1] == inputCount * 2, "FC04 baca semua input register");
+    if (r.size() == 2 + inputCount * 2u)
+    {
+      check(reg(r, 0) == 721 && reg(r, 1) == 3550 && reg(r, 2) == 640 && reg(r, 3) == 2750, "  nilai kanal x100");
+      check(reg(r, 7) == 0x04 && reg(r, 8) == 0x08 && reg(r, 9) == 1, "  fault suhu, bitmask relay, mode auto");
+    }
+
+    r = request(fd, readPdu(MB_READ_HOLDING, 0, holdingCount));
+    check(r.size() == 2 + holdingCount * 2u && reg(r, 0) == 650 && reg(r, 1) == 850 && reg(r, 7) == 3000,
+          "FC03 baca threshold");
+
+    r = request(fd, {MB_WRITE_REGISTER, 0, 0, 0x02, 0x8A}); // ph.min = 6.50 -> 6.50 (650)
+    check(r.size() == 5 && r[0] == MB_WRITE_REGISTER, "FC06 tulis threshold ph.min");
+    r = request(fd, {MB_WRITE_REGISTER, 0, 0, 0x03, 0xE8}); // ph.min = 10.00 > max
+    check(isException(r, MB_WRITE_REGISTER, MB_ILLEGAL_VALUE), "FC06 min > max ditolak (exception 03)");
+
+    // FC16: ph 6.8..8.2 dan turb 10..60 sekaligus
+    r = request(fd, {MB_WRITE_REGISTERS, 0, 0, 0, 4, 8, 0x02, 0xA8, 0x03, 0x34, 0x03, 0xE8, 0x17, 0x70});
+    check(r.size() == 5 && r[0] == MB_WRITE_REGISTERS, "FC16 tulis dua kanal sekaligus");
+    r = request(fd, readPdu(MB_READ_HOLDING, 0, 4));
+    check(r.size() == 10 && reg(r, 0) == 680 && reg(r, 1) == 820 && reg(r, 2) == 1000 && reg(r, 3) == 6000,
+          "  terbaca langsung setelah ditulis");
+    r = request(fd, {MB_WRITE_REGISTERS, 0, 0, 0, 4, 8, 0x02, 0x58, 0x03, 0x20, 0x1F, 0x40, 0x03, 0xE8});
+    check(isException(r, MB_WRITE_REGISTERS, MB_ILLEGAL_VALUE), "FC16 satu kanal salah -> seluruhnya ditolak");
+    r = request(fd, readPdu(MB_READ_HOLDING, 0, 2));
+    check(r.size() == 6 && reg(r, 0) == 680 && reg(r, 1) == 820, "  kanal lain tidak berubah");
+
+    r = request(fd, {MB_WRITE_COIL, 0, 0, 0xFF, 0x00});
+    check(isException(r, MB_WRITE_COIL, MB_DEVICE_FAILURE), "FC05 relay1 saat mode auto ditolak (exception 04)");
+    r = request(fd, {MB_WRITE_COILS, 0, 0, 0, 6, 1, 0x01}); // relay1 on, relay2..5 off, mode manual
+    check(r.size() == 5 && r[0] == MB_WRITE_COILS, "FC15 mode manual + relay dalam satu batch");
+    settle();
+    r = request(fd, readPdu(MB_READ_COILS, 0, coilCount));
+    check(r.size() == 3 && r[2] == 0x01, "  FC01 relay1 nyala, aerator mati, mode manual");
+
+    r = request(fd, readPdu(MB_READ_DISCRETE, 0, channelCount));
+    check(r.size() == 3 && r[2] == 0x08, "FC02 fault per kanal");
+
+    r = request(fd, readPdu(MB_READ_INPUT, inputCount - 1, 2));
+    check(isException(r, MB_READ_INPUT, MB_ILLEGAL_ADDRESS), "alamat di luar peta (exception 02)");
+    r = request(fd, {0x2B, 0x0E, 0x01, 0x00});
+    check(isException(r, 0x2B, MB_ILLEGAL_FUNCTION), "fungsi tidak didukung (exception 01)");
+
+    // Dua permintaan dalam satu segmen TCP, lalu satu permintaan terpecah dua
+    std::vector<uint8_t> a = adu(readPdu(MB_READ_INPUT, 0, 1)), b = adu(readPdu(MB_READ_HOLDING, 0, 1));
+    std::vector<uint8_t> both(a);
+    both.insert(both.end(), b.begin(), b.end());
+    send(fd, both.data(), both.size(), MSG_NOSIGNAL);
+    auto ra = readAdu(fd), rb = readAdu(fd);
+    check(ra.size() == 11 && rb.size() == 11 && ra[1] == a[1] && rb[1] == b[1], "dua ADU dalam satu segmen");
+    std::vector<uint8_t> c = adu(readPdu(MB_READ_INPUT, 8, 1));
+    send(fd, c.data(), 4, MSG_NOSIGNAL);
+    settle();
+    send(fd, c.data() + 4, c.size() - 4, MSG_NOSIGNAL);
+    auto rc = readAdu(fd);
+    check(rc.size() == 11 && rc[1] == c[1] && rc[10] == 0x01, "ADU terpecah dua segmen");
+
+    // Protocol id bukan 0: server memutus koneksi
+    std::vector<uint8_t> bad = adu(readPdu(MB_READ_INPUT, 0, 1));
+    bad[2] = 0x12;
+    send(fd, bad.data(), bad.size(), MSG_NOSIGNAL);
+    check(readAdu(fd).empty(), "header rusak -> koneksi diputus");
+    close(fd);
+
+    // Latensi baca register image
+    fd = connectTo(port);
+    const int rounds = 2000;
+    auto t0 = std::chrono::steady_clock::now();
+    int ok = 0;
+    for (int i = 0; i < rounds; i++)
+      ok += request(fd, readPdu(MB_READ_INPUT, 0, inputCount)).size() == 2 + inputCount * 2u;
+    auto t1 = std::chrono::steady_clock::now();
+    close(fd);
+    check(ok == rounds, "2000 baca berturut-turut");
+    printf("round trip FC04 (loopback): %.1f us\n", std::chrono::duration<double, std::micro>(t1 - t0).count() / rounds);
+    return failures ? 1 : 0;
+  }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  uint16_t port = 1502;
+  bool serveOnly = false;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--serve"))
+      serveOnly = true;
+    else if (!strcmp(argv[i], "--port") && i + 1 < argc)
+      port = (uint16_t)atoi(argv[++i]);
+    else
+    {
+      fprintf(stderr, "usage: modbus_sim [--serve] [--port N]\n");
+      return 2;
+    }
+  }
+
+  int listenFd = listenOn(port);
+  if (listenFd < 0)
+    return 2;
+  controlTick(0);
+  if (serveOnly)
+  {
+    printf("Modbus TCP slave tiruan di 127.0.0.1:%u\n", port);
+    serve(listenFd);
+    return 0;
+  }
+  std::thread server(serve, listenFd);
+  int rc = runClient(port);
+  running = false;
+  server.join();
+  close(listenFd);
+  printf("%u permintaan, %u exception di server\n", modbus.requestCount(), modbus.exceptionCount());
+  return rc;
+}
@@ -0,0 +1,616 @@
+// Uji store-and-forward MQTT (include/MqttForwarder.h) di host terhadap broker
+// tiruan lokal.
+//
+//   mqtt_sim [--port N] [--verbose]     exit 1 jika ada pemeriksaan gagal
+//
+// Broker tiruan: MQTT 3.1.1 minimal di 127.0.0.1 (CONNECT/CONNACK, SUBSCRIBE/
+// SUBACK, PUBLISH QoS 0, PINGREQ, DISCONNECT), mencatat setiap PUBLISH yang
+// diterima. Bisa dimatikan dan dinyalakan lagi di port yang sama untuk meniru
+// broker putus. Klien uji adalah padanan PubSubClient: publish QoS 0 gagal jika
+// socket sudah tertutup. Spool memakai file biasa, padanan SpiffsSpool.
+//
+// Skenario dengan jam tiruan (1 langkah = 1 detik, seperti job mqttSample,
+// mqttConnect tiap 5 detik dan mqttDrain tiap detik di src/main.cpp):
+//   1. broker hidup: 10 sampel per pesan data, t0/dt dan isi array benar
+//   2. broker mati: antrian RAM penuh, pesan tertua pindah ke spool file
+//   3. broker hidup lagi: spool terkirim lebih dulu lalu RAM, urutan tetap,
+//      tidak ada yang hilang, maksimal drainPerSecond pesan per detik
+//      (drain() satu pesan per putaran loop, loopsPerSecond putaran per detik)
+
+#include "KitChannels.h"
+#include "MqttForwarder.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <mutex>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+  // Tabel kanal (include/KitChannels.h) dan konstanta MQTT (include/KitConfig.h)
+  // sama dengan firmware; hanya prefix topic yang lokal
+  const int loopsPerSecond = 10; // loop() minimal tiap relayLatencyMs
+  const char *topicPrefix = "kolam/kit-01";
+  const int queueSlots = (int)mqttQueueSlots;
+
+  bool verbose = false;
+  int failures = 0;
+
+  void check(bool ok, const char *what)
+  {
+    printf("%-62s %s\n", what, ok ? "ok" : "GAGAL");
+    if (!ok)
+      failures++;
+  }
+
+  // ===== Spool file, padanan SpiffsSpool =====
+  struct FileSpool
+  {
+    std::string path;
+
+    size_t size()
+    {
+      FILE *f = fopen(path.c_str(), "rb");
+      if (!f)
+        return 0;
+      fseek(f, 0, SEEK_END);
+      long n = ftell(f);
+      fclose(f);
+      return n > 0 ? (size_t)n : 0;
+    }
+
+    bool append(const char *data, size_t len)
+    {
+      FILE *f = fopen(path.c_str(), "ab");
+      if (!f)
+        return false;
+      bool ok = fwrite(data, 1, len, f) == len;
+      fclose(f);
+      return ok;
+    }
+
+    int readLine(size_t offset, char *buf, size_t size)
+    {
+      FILE *f = fopen(path.c_str(), "rb");
+      if (!f)
+        return -1;
+      if (fseek(f, (long)offset, SEEK_SET) != 0)
+      {
+        fclose(f);
+        return -1;
+      }
+      size_t n = 0;
+      int c = fgetc(f);
+      if (c == EOF)
+      {
+        fclose(f);
+        return -1;
+      }
+      for (; c != EOF && c != '\n' && n < size; c = fgetc(f))
+        buf[n++] = (char)c;
+      fclose(f);
+      return (int)n;
+    }
+
+    void remove() { ::remove(path.c_str()); }
+
+    int lines()
+    {
+      FILE *f = fopen(path.c_str(), "rb");
+      if (!f)
+        return 0;
+      int n = 0, c;
+      while ((c = fgetc(f)) != EOF)
+        n += c == '\n';
+      fclose(f);
+      return n;
+    }
+  };
+
+  // ===== Broker tiruan =====
+  struct Received
+  {
+    std::string topic;
+    std::string payload;
+  };
+
+  class Broker
+  {
+  public:
+    bool start(uint16_t &port)
+    {
+      listenFd = socket(AF_INET, SOCK_STREAM, 0);
+      int one = 1;
+      setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+      sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      addr.sin_port = htons(port);
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      socklen_t alen = sizeof(addr);
+      if (bind(listenFd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(listenFd, 4) < 0 ||
+          getsockname(listenFd, (sockaddr *)&addr, &alen) < 0)
+      {
+        perror("broker bind/listen");
+        close(listenFd);
+        return false;
+      }
+      port = ntohs(addr.sin_port);
+      fcntl(listenFd, F_SETFL, O_NONBLOCK);
+      running = true;
+      thread = std::thread(&Broker::serve, this);
+      return true;
+    }
+
+    /// @brief matikan broker: tutup koneksi klien dan socket listen
+    void stop()
+    {
+      running = false;
+      thread.join();
+      close(listenFd);
+    }
+
+    size_t count()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return received.size();
+    }
+
+    /// @brief tunggu sampai minimal n PUBLISH diterima (maks 1 detik)
+    bool waitFor(size_t n)
+    {
+      for (int i = 0; i < 200 && count() < n; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      return count() >= n;
+    }
+
+    /// @brief beri waktu agar pesan yang sedang dikirim ikut tercatat
+    void settle() { std::this_thread::sleep_for(std::chrono::milliseconds(20)); }
+
+    std::vector<Received> messages()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return received;
+    }
+
+    std::vector<std::string> subscribed()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return subscriptions;
+    }
+
+    std::atomic<int> connects{0};
+
+  private:
+    void serve()
+    {
+      int fd = -1;
+      std::vector<uint8_t> buf;
+      while (running)
+      {
+        pollfd fds[2] = {{listenFd, POLLIN, 0}, {fd, POLLIN, 0}};
+        poll(fds, fd >= 0 ? 2 : 1, 10);
+
+        int c = accept(listenFd, nullptr, nullptr);
+        if (c >= 0)
+        {
+          if (fd >= 0)
+            close(fd); // satu klien saja, seperti satu client id
+          fd = c;
+          fcntl(fd, F_SETFL, O_NONBLOCK);
+          buf.clear();
+        }
+        if (fd < 0)
+          continue;
+
+        uint8_t tmp[1024];
+        ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+        if (n > 0)
+          buf.insert(buf.end(), tmp, tmp + n);
+        bool closed = n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+
+        long used = 0;
+        while (!closed && (used = packet(fd, buf)) > 0)
+          buf.erase(buf.begin(), buf.begin() + used);
+        if (closed || used < 0)
+        {
+          close(fd);
+          fd = -1;
+        }
+      }
+      if (fd >= 0)
+        close(fd);
+    }
+
+    /// @return byte yang dipakai, 0 jika paket belum lengkap, -1 jika protokol rusak/DISCONNECT
+    long packet(int fd, const std::vector<uint8_t> &b)
+    {
+      if (b.size() < 2)
+        return 0;
+      size_t remaining = 0, pos = 1;
+      for (int shift = 0;; shift += 7)
+      {
+        if (pos >= b.size())
+          return 0;
+        if (shift > 21)
+          return -1;
+        remaining |= (size_t)(b[pos] & 0x7F) << shift;
+        if (!(b[pos++] & 0x80))
+          break;
+      }
+      if (b.size() < pos + remaining)
+        return 0;
+      const uint8_t *p = b.data() + pos;
+      uint8_t type = b[0] >> 4;
+
+      if (type == 1) // CONNECT
+      {
+        const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+        send(fd, connack, sizeof(connack), MSG_NOSIGNAL);
+        connects++;
+      }
+      else if (type == 3) // PUBLISH QoS 0
+      {
+        size_t tl = (size_t)(p[0] << 8 | p[1]);
+        if (tl + 2 > remaining || (b[0] & 0x06))
+          return -1;
+        Received r = {std::string((const char *)p + 2, tl),
+                      std::string((const char *)p + 2 + tl, remaining - 2 - tl)};
+        if (verbose)
+          printf("  broker <- %s %s\n", r.topic.c_str(), r.payload.c_str());
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(r);
+      }
+      else if (type == 8) // SUBSCRIBE
+      {
+        size_t tl = (size_t)(p[2] << 8 | p[3]);
+        std::lock_guard<std::mutex> lock(mutex);
+        subscriptions.push_back(std::string((const char *)p + 4, tl));
+        const uint8_t suback[] = {0x90, 0x03, p[0], p[1], 0x00};
+        send(fd, suback, sizeof(suback), MSG_NOSIGNAL);
+      }
+      else if (type == 12) // PINGREQ
+      {
+        const uint8_t pingresp[] = {0xD0, 0x00};
+        send(fd, pingresp, sizeof(pingresp), MSG_NOSIGNAL);
+      }
+      else // DISCONNECT atau tipe lain
+        return -1;
+      return (long)(pos + remaining);
+    }
+
+    int listenFd = -1;
+    std::atomic<bool> running{false};
+    std::thread thread;
+    std::mutex mutex;
+    std::vector<Received> received;
+    std::vector<std::string> subscriptions;
+  };
+
+  // ===== Klien uji, padanan PubSubClient =====
+  class Client
+  {
+  public:
+    bool connect(uint16_t port, const char *clientId)
+    {
+      fd = socket(AF_INET, SOCK_STREAM, 0);
+      sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      addr.sin_port = htons(port);
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      if (::connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+      {
+        disconnect();
+        return false;
+      }
+      timeval tv = {1, 0};
+      setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+      std::vector<uint8_t> body = {0, 4, 'M', 'Q', 'T', 'T', 4, 0x02, 0, 15};
+      appendString(body, clientId);
+      uint8_t connack[4];
+      if (!sendPacket(0x10, body) || !readExact(connack, 4) || connack[0] != 0x20 || connack[3] != 0)
+      {
+        disconnect();
+        return false;
+      }
+      return true;
+    }
+
+    bool subscribe(const char *topic)
+    {
+      std::vector<uint8_t> body = {0, 1};
+      appendString(body, topic);
+      body.push_back(0);
+      uint8_t suback[5];
+      return sendPacket(0x82, body) && readExact(suback, 5) && suback[0] == 0x90;
+    }
+
+    bool publish(const char *topic, const uint8_t *payload, size_t length)
+    {
+      if (!connected())
+        return false;
+      std::vector<uint8_t> body;
+      appendString(body, topic);
+      body.insert(body.end(), payload, payload + length);
+      return sendPacket(0x30, body);
+    }
+
+    /// @brief seperti PubSubClient::connected(): false setelah broker menutup koneksi
+    bool connected()
+    {
+      if (fd < 0)
+        return false;
+      pollfd p = {fd, POLLIN, 0};
+      if (poll(&p, 1, 0) > 0)
+      {
+        uint8_t c;
+        if (recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) <= 0)
+          disconnect();
+      }
+      return fd >= 0;
+    }
+
+    void disconnect()
+    {
+      if (fd >= 0)
+        close(fd);
+      fd = -1;
+    }
+
+  private:
+    static void appendString(std::vector<uint8_t> &v, const char *s)
+    {
+      size_t n = strlen(s);
+      v.push_back((uint8_t)(n >> 8));
+      v.push_back((uint8_t)n);
+      v.insert(v.end(), s, s + n);
+    }
+
+    bool sendPacket(uint8_t header, const std::vector<uint8_t> &body)
+    {
+      std::vector<uint8_t> pkt = {header};
+      size_t n = body.size();
+      do
+      {
+        uint8_t d = n & 0x7F;
+        n >>= 7;
+        pkt.push_back(n ? d | 0x80 : d);
+      } while (n);
+      pkt.insert(pkt.end(), body.begin(), body.end());
+      if (send(fd, pkt.data(), pkt.size(), MSG_NOSIGNAL) != (ssize_t)pkt.size())
+      {
+        disconnect();
+        return false;
+      }
+      return true;
+    }
+
+    bool readExact(uint8_t *p, size_t n)
+    {
+      for (size_t got = 0; got < n;)
+      {
+        ssize_t r = recv(fd, p + got, n - got, 0);
+        if (r <= 0)
+          return false;
+        got += r;
+      }
+      return true;
+    }
+
+    int fd = -1;
+  };
+
+  // ===== Skenario =====
+  typedef MqttForwarder<channelCount, mqttBatchSize, FileSpool, mqttQueueSlots> Forwarder;
+
+  Client client;
+  uint32_t now = 0;
+  int relayMessages = 0;
+
+  float valueAt(uint32_t t, int ch) { return ch * 10.0f + (t / 1000 % 100) * 0.01f; }
+
+  // Satu detik firmware: sampel, reconnect tiap 5 detik, jendela drain baru, mqttLoop() per putaran loop
+  int step(Forwarder &fwd, uint16_t port)
+  {
+    now += mqttSampleInterval;
+    float v[channelCount];
+    for (int ch = 0; ch < channelCount; ch++)
+      v[ch] = valueAt(now, ch);
+    fwd.sample(now, v);
+    if (now % 5000 == 0 && !client.connected() && client.connect(port, "kit-kolam-01"))
+      client.subscribe("kolam/kit-01/cmd/#");
+    fwd.newWindow();
+    int sent = 0;
+    for (int i = 0; i < loopsPerSecond && client.connected(); i++)
+      sent += fwd.drain([](const char *topic, const uint8_t *payload, size_t length)
+                        { return client.publish(topic, payload, length); },
+                        1);
+    return sent;
+  }
+
+  void publishRelay(Forwarder &fwd, int idx, bool state)
+  {
+    char payload[48];
+    int n = snprintf(payload, sizeof(payload), "{\"t\":%lu,\"relay%d\":%s}",
+                     (unsigned long)now, idx + 1, state ? "true" : "false");
+    fwd.enqueue("relay", payload, n);
+    relayMessages++;
+  }
+
+  /// @brief timestamp pesan ("t0" untuk data, "t" untuk relay), -1 jika tidak ada
+  long stamp(const Received &r)
+  {
+    size_t p = r.payload.find(':');
+    return p == std::string::npos ? -1 : atol(r.payload.c_str() + p + 1);
+  }
+
+  /// @brief pesan data sesuai batch yang berakhir di sampel t0 + 9 detik
+  bool dataMatches(const Received &r, uint32_t t0)
+  {
+    if (r.topic != "kolam/kit-01/data")
+      return false;
+    std::string expect = "{\"t0\":" + std::to_string(t0) + ",\"dt\":" + std::to_string(mqttSampleInterval);
+    for (int ch = 0; ch < channelCount; ch++)
+    {
+      expect += std::string(",\"") + channels[ch].key + "\":[";
+      for (int i = 0; i < mqttBatchSize; i++)
+      {
+        char num[16];
+        snprintf(num, sizeof(num), i ? ",%.2f" : "%.2f", valueAt(t0 + i * mqttSampleInterval, ch));
+        expect += num;
+      }
+      expect += "]";
+    }
+    return r.payload == expect + "}";
+  }
+
+  int run(uint16_t port)
+  {
+    char spoolPath[] = "/tmp/mqtt-spool-XXXXXX";
+    int tmpFd = mkstemp(spoolPath);
+    if (tmpFd < 0)
+    {
+      perror("mkstemp");
+      return 2;
+    }
+    close(tmpFd);
+    FileSpool spool = {spoolPath};
+    spool.remove();
+
+    static Forwarder fwd(channels, spool, topicPrefix, mqttSampleInterval, mqttDrainPerSecond, mqttSpoolMaxBytes);
+    fwd.begin();
+
+    Broker broker;
+    if (!broker.start(port))
+      return 2;
+
+    // 1. Broker hidup: batch 10 sampel -> satu pesan
+    for (int i = 0; i < 30; i++)
+      step(fwd, port);
+    broker.waitFor(3);
+    broker.settle();
+    std::vector<Received> got = broker.messages();
+    std::vector<std::string> subs = broker.subscribed();
+    check(broker.connects == 1 && subs.size() == 1 && subs[0] == "kolam/kit-01/cmd/#",
+          "connect dan subscribe <prefix>/cmd/#");
+    check(got.size() == 3, "30 sampel -> 3 pesan data");
+    check(got.size() == 3 && dataMatches(got[0], 1000) && dataMatches(got[1], 11000) && dataMatches(got[2], 21000),
+          "  t0, dt dan 10 nilai per kanal");
+    check(fwd.queued() == 0 && spool.size() == 0, "  antrian kosong selama broker hidup");
+
+    // 2. Broker putus: antrian RAM penuh, sisanya ke spool
+    broker.stop();
+    for (int i = 0; i < 100 && client.connected(); i++)
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    check(!client.connected(), "klien mendeteksi broker putus");
+    size_t before = broker.count();
+    int outage = 250;
+    bool reconnected = false;
+    for (int i = 0; i < outage; i++)
+    {
+      step(fwd, port);
+      if (now % 100000 == 0)
+        publishRelay(fwd, 1, (now / 100000) % 2); // tepat setelah batch, urutan stempel tetap naik
+      reconnected = reconnected || client.connected();
+    }
+    int expected = outage / mqttBatchSize + relayMessages;
+    char what[96];
+    snprintf(what, sizeof(what), "broker mati %d detik: %d pesan tertahan, reconnect gagal", outage, expected);
+    check(!reconnected && broker.count() == before, what);
+    snprintf(what, sizeof(what), "  %d di RAM, %d di spool, 0 dibuang", queueSlots, expected - queueSlots);
+    check(fwd.queued() == (size_t)queueSlots && spool.lines() == expected - queueSlots && fwd.droppedCount() == 0,
+          what);
+
+    // 3. Broker hidup lagi: spool dulu, lalu RAM, laju terbatas
+    if (!broker.start(port))
+      return 2;
+    int maxPerSecond = 0, seconds = 0;
+    size_t target = before + expected;
+    bool spoolFirst = true;
+    while (seconds < 60 && (seconds == 0 || fwd.queued() || fwd.spoolPendingNow()))
+    {
+      int sent = step(fwd, port);
+      broker.settle();
+      maxPerSecond = sent > maxPerSecond ? sent : maxPerSecond;
+      if (broker.count() < before + (size_t)(expected - queueSlots))
+        spoolFirst = spoolFirst && fwd.queued() >= (size_t)queueSlots;
+      seconds++;
+    }
+    broker.waitFor(target);
+    got = broker.messages();
+
+    bool ordered = true;
+    for (size_t i = 1; i < got.size(); i++)
+      ordered = ordered && stamp(got[i]) > stamp(got[i - 1]);
+    int relays = 0;
+    for (size_t i = 0; i < got.size(); i++)
+      relays += got[i].topic == "kolam/kit-01/relay";
+
+    snprintf(what, sizeof(what), "reconnect: %d pesan terkirim dalam %d detik", (int)(got.size() - before), seconds);
+    check(got.size() >= target && broker.connects == 2, what);
+    snprintf(what, sizeof(what), "  maks %d pesan per detik (batas %d)", maxPerSecond, mqttDrainPerSecond);
+    check(maxPerSecond <= mqttDrainPerSecond && maxPerSecond > 0, what);
+    check(spoolFirst, "  spool terkirim sebelum antrian RAM");
+    check(ordered && relays == relayMessages, "  urutan stempel naik, tidak ada pesan hilang atau ganda");
+    bool dataOk = true;
+    uint32_t t0 = 1000;
+    for (size_t i = 0; i < got.size(); i++)
+      if (got[i].topic == "kolam/kit-01/data")
+      {
+        dataOk = dataOk && dataMatches(got[i], t0);
+        t0 += mqttBatchSize * mqttSampleInterval;
+      }
+    check(dataOk, "  isi batch selama putus utuh");
+    check(fwd.queued() == 0 && !fwd.spoolPendingNow() && spool.size() == 0, "  antrian kosong, file spool dihapus");
+
+    // 4. Reboot dengan spool tersisa: begin() melanjutkan dari file
+    spool.append("kolam/kit-01/data\t{\"t0\":1}\n", 26);
+    Forwarder *rebooted = new Forwarder(channels, spool, topicPrefix, mqttSampleInterval, mqttDrainPerSecond,
+                                        mqttSpoolMaxBytes);
+    rebooted->begin();
+    size_t n = broker.count();
+    int sent = rebooted->drain([](const char *topic, const uint8_t *payload, size_t length)
+                               { return client.publish(topic, payload, length); });
+    broker.waitFor(n + 1);
+    got = broker.messages();
+    check(sent == 1 && got.size() == n + 1 && got.back().payload == "{\"t0\":1}", "spool sisa reboot dikirim setelah begin()");
+    delete rebooted;
+
+    client.disconnect();
+    broker.stop();
+    spool.remove();
+    return failures ? 1 : 0;
+  }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  uint16_t port = 0; // 0 = port bebas
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--port") && i + 1 < argc)
+      port = (uint16_t)atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--verbose"))
+      verbose = true;
+    else
+    {
+      fprintf(stderr, "usage: mqtt_sim [--port N] [--verbose]\n");
+      return 2;
+    }
+  }
+  return run(port);
+}
@@ -0,0 +1,557 @@
+// Replay jejak sensor melalui rantai kontrol firmware dengan jam simulasi.
+//
+//   control_replay TRACE.csv [--ph MIN:MAX] [--turb MIN:MAX] [--oks MIN:MAX] [--suhu MIN:MAX]
+//                  [--turb-cycle MS] [--adc-interval MS] [--noise COUNTS] [--seed N] [--adaptive]
+//                  [--max-switches N] [--max-switches-per-hour RELAY=N]...
+//                  [--max-dosing-duty PCT] [--max-latency KANAL=S]...
+//
+// Jejak memakai format CSV dari GET /export (t_ms,ph,turb,oks,suhu) atau nilai ADC
+// mentah (t_ms,adc_ph,adc_turb,adc_oks,suhu). Nilai akhir dikonversi balik ke ADC,
+// diberi derau, lalu melewati kode yang sama dengan firmware: tabel kanal,
+// periode job dan konfigurasi kontroler dari KitConfig.h, ChannelBank (filter,
+// konversi, SensorHealth, sampling adaptif), DoTrend, PhDosing dan
+// autoRelayDecide() (AutoRelay.h), dijadwalkan oleh Scheduler.h seperti scheduleJobs().
+//
+// --adaptive memakai sampling dan pencatatan adaptif dari tabel channels seperti
+// firmware; tanpa opsi ini semua kanal dibaca setiap --adc-interval dan setiap
+// tick log dicatat (pembanding).
+//
+// Laporan: jumlah switch dan waktu nyala per relay, waktu di luar band per kanal,
+// latensi reaksi (nilai jejak keluar band sampai relay pengoreksi menyala; 0 jika
+// sudah menyala lebih dulu, mis. aerator prediktif), duty dosing pH, jumlah
+// pembacaan ADC/suhu dan baris riwayat, serta biaya CPU per jam simulasi.
+// Exit code 1 jika batas --max-* terlampaui. --max-switches-per-hour berlaku
+// untuk satu relay (1..5), --max-latency untuk kanal ph atau oks (latensi
+// terlama, detik); keduanya boleh diulang.
+
+#include "AutoRelay.h"
+#include "ChannelRegistry.h"
+#include "DoTrend.h"
+#include "KitChannels.h"
+#include "PhDosing.h"
+#include "Scheduler.h"
+#include "SensorConversion.h"
+
+#include <string>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+namespace
+{
+
+  struct Row
+  {
+    double t; // ms
+    float ph, turb, oks, suhu;
+  };
+
+  // Konfigurasi dari KitConfig.h; yang bisa diubah lewat opsi disalin ke sini
+  uint32_t adcIntervalMs = 1; // firmware tanpa LOW_POWER_MODE
+  uint32_t turbCycleMs = turbidityCycleMs;
+
+  // Tabel kanal firmware; tanpa --adaptive sampling diganti laju tetap sebelum bank dibuat
+  ChannelTable<channelCount> table = channels;
+  ChannelBank<channelCount> *sensors = nullptr;
+  DoTrend doTrend(doTrendConfig);
+  PhDosing phDosing(phDosingConfig);
+  Scheduler<8> jobs;
+
+  bool adaptive = false;
+  int adcJobId = -1;
+  uint64_t adcReads = 0, tempReads = 0, logTicks = 0, loggedRows = 0;
+
+  // State simulasi
+  std::vector<Row> rows;
+  bool rawTrace = false;
+  size_t cursor = 0;
+  uint32_t simMs = 0;
+  bool tempReady = false;
+  bool turbidityCycleOn = false;
+  float noiseCounts = 3.0f;
+  uint64_t rng = 88172645463325252ULL;
+
+  bool relay[5] = {false, false, false, false, false};
+  uint32_t relayOnSince[5];
+  uint64_t relayOnMs[5] = {0, 0, 0, 0, 0};
+  uint32_t switches[5] = {0, 0, 0, 0, 0};
+  uint64_t belowMs[channelCount] = {};
+  uint64_t aboveMs[channelCount] = {};
+  uint64_t faultMs[channelCount] = {};
+  uint32_t faultEvents = 0;
+
+  // Latensi reaksi satu aturan: kejadian dimulai saat nilai jejak keluar band
+  // dan selesai saat relay pengoreksi menyala. Selama nilai masih di luar band
+  // kejadian dianggap tertangani walaupun relay berpulsa (dosing).
+  struct Reaction
+  {
+    bool waiting = false;
+    bool handled = false;
+    uint32_t since = 0;
+    uint32_t episodes = 0;
+    uint32_t missed = 0; // kembali ke band (atau jejak habis) sebelum relay menyala
+    double sumMs = 0;
+    double maxMs = 0;
+
+    void update(uint32_t nowMs, bool out, bool acting)
+    {
+      if (!out)
+      {
+        if (waiting)
+          close(nowMs, false);
+        handled = false;
+        return;
+      }
+      if (!waiting && !handled)
+      {
+        waiting = true;
+        since = nowMs;
+        episodes++;
+      }
+      if (waiting && acting)
+      {
+        close(nowMs, true);
+        handled = true;
+      }
+    }
+
+    void close(uint32_t nowMs, bool acted)
+    {
+      double d = nowMs - since;
+      sumMs += d;
+      maxMs = d > maxMs ? d : maxMs;
+      missed += !acted;
+      waiting = false;
+    }
+  };
+  Reaction phReaction, oksReaction;
+
+  // xorshift64 + Box-Muller: deterministik untuk seed yang sama
+  double uniform()
+  {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return ((rng >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+  }
+
+  float gauss()
+  {
+    // Box-Muller menghasilkan sepasang sampel; simpan yang kedua
+    static bool hasSpare = false;
+    static float spare;
+    if (hasSpare)
+    {
+      hasSpare = false;
+      return spare;
+    }
+    double r = sqrt(-2.0 * log(uniform()));
+    double a = 2.0 * M_PI * uniform();
+    spare = (float)(r * sin(a));
+    hasSpare = true;
+    return (float)(r * cos(a));
+  }
+
+  int toAdc(float voltage)
+  {
+    float adc = voltage / 3.3f * 4095.0f + noiseCounts * gauss();
+    return adc < 0 ? 0 : (adc > 4095 ? 4095 : (int)lroundf(adc));
+  }
+
+  // Kebalikan SensorConversion.h: nilai akhir -> tegangan sensor
+  float phToVoltage(float ph) { return (ph - 1.85f) / (3.5f * 5.0f / 3.3f); }
+
+  float turbidityToVoltage(float turb)
+  {
+    float x = 960.0f + (100.0f - turb) / 100.0f * 900.0f;
+    return 0.8f + (x - 960.0f) / 900.0f * 0.73f;
+  }
+
+  float oksigenToVoltage(float oks, float suhu)
+  {
+    float c = suhu < 0 ? 0 : (suhu > 40 ? 40 : suhu);
+    int t = (int)roundf(c);
+    // readDO(): DO(µg/L) = mV * DO_Table[t] / Vsat  ->  mV = DO * Vsat / DO_Table[t]
+    const DoCalibration &k = doCalibration;
+    float vsat = k.twoPoint ? (float)(t - k.cal2T) * (k.cal1V - k.cal2V) / (k.cal1T - k.cal2T) + k.cal2V
+                            : k.cal1V + 35.0f * (t - k.cal1T);
+    return oks * 1000.0f * vsat / DO_Table[t] / 1000.0f;
+  }
+
+  Row traceAt(double t)
+  {
+    while (cursor + 2 < rows.size() && rows[cursor + 1].t <= t)
+      cursor++;
+    const Row &a = rows[cursor];
+    const Row &b = rows[cursor + 1];
+    double f = b.t > a.t ? (t - a.t) / (b.t - a.t) : 0;
+    f = f < 0 ? 0 : (f > 1 ? 1 : f);
+    Row r;
+    r.t = t;
+    r.ph = (float)(a.ph + (b.ph - a.ph) * f);
+    r.turb = (float)(a.turb + (b.turb - a.turb) * f);
+    r.oks = (float)(a.oks + (b.oks - a.oks) * f);
+    r.suhu = (float)(a.suhu + (b.suhu - a.suhu) * f);
+    return r;
+  }
+
+  uint8_t invalidChannels()
+  {
+    uint8_t mask = 0;
+    if (!sensors->health[CHI_PH].valid())
+      mask |= CH_PH;
+    if (!sensors->health[CHI_TURB].valid())
+      mask |= CH_TURB;
+    if (!sensors->health[CHI_OKS].valid())
+      mask |= CH_OKS;
+    if (!sensors->health[CHI_SUHU].valid())
+      mask |= CH_SUHU;
+    return mask;
+  }
+
+  // ===== Job, padanan scheduleJobs() di firmware =====
+  void jobAuto()
+  {
+    ControlReading reading = {sensors->value[CHI_PH], sensors->value[CHI_TURB], sensors->value[CHI_OKS],
+                              sensors->value[CHI_SUHU], invalidChannels()};
+    ControlThresholds th = {sensors->threshold[CHI_PH], sensors->threshold[CHI_TURB],
+                            sensors->threshold[CHI_OKS], sensors->threshold[CHI_SUHU]};
+    bool next[5];
+    uint8_t driven = autoRelayDecide(reading, th, turbidityCycleOn, doTrend, phDosing, simMs, next);
+    for (int i = 0; i < 5; i++)
+    {
+      if (!(driven & (1 << i)) || next[i] == relay[i])
+        continue;
+      switches[i]++;
+      if (relay[i])
+        relayOnMs[i] += simMs - relayOnSince[i];
+      else
+        relayOnSince[i] = simMs;
+      relay[i] = next[i];
+    }
+
+    // Reaksi diukur terhadap nilai sebenarnya (jejak), jadi lag filter ikut terhitung
+    Row r = traceAt(simMs);
+    bool phLow = r.ph < th.ph.min;
+    phReaction.update(simMs, phLow || r.ph > th.ph.max, phLow ? relay[0] : relay[1]);
+    oksReaction.update(simMs, r.oks < th.oksigen.min, relay[3]);
+  }
+
+  int adcFor(int ch, const Row &r)
+  {
+    if (rawTrace)
+      return (int)(ch == CHI_PH ? r.ph : (ch == CHI_TURB ? r.turb : r.oks));
+    if (ch == CHI_PH)
+      return toAdc(phToVoltage(r.ph));
+    if (ch == CHI_TURB)
+      return toAdc(turbidityToVoltage(r.turb));
+    return toAdc(oksigenToVoltage(r.oks, r.suhu));
+  }
+
+  void jobAdc()
+  {
+    Row r = traceAt(simMs);
+    uint32_t wait = sensors->sampleInternal(simMs, adcIntervalMs, [&r](int ch) {
+      adcReads++;
+      return adcFor(ch, r);
+    });
+    jobs.setPeriod(adcJobId, wait > adcIntervalMs ? wait : adcIntervalMs);
+  }
+
+  void jobTempRequest()
+  {
+    if (!sensors->sampler[CHI_SUHU].due(simMs))
+      return;
+    tempReady = true;
+  }
+
+  void jobLog()
+  {
+    if (tempReady)
+    {
+      tempReady = false;
+      float suhuBaru = (float)(round(traceAt(simMs).suhu * 16.0) / 16.0); // resolusi DS18B20 12 bit
+      tempReads++;
+      if (!(sensors->health[CHI_SUHU].update(suhuBaru, suhuBaru, simMs) & FAULT_RANGE))
+        sensors->setValue(CHI_SUHU, suhuBaru, simMs);
+    }
+
+    static uint8_t lastInvalid = 0;
+    for (int i = 0; i < channelCount; i++)
+      sensors->updateHealth(i);
+    uint8_t invalid = invalidChannels();
+    faultEvents += __builtin_popcount(invalid & ~lastInvalid);
+    lastInvalid = invalid;
+
+    for (int i = 0; i < channelCount; i++)
+    {
+      if (!sensors->health[i].valid())
+        faultMs[i] += logIntervalMs;
+      if (sensors->value[i] < sensors->threshold[i].min)
+        belowMs[i] += logIntervalMs;
+      else if (sensors->value[i] > sensors->threshold[i].max)
+        aboveMs[i] += logIntervalMs;
+    }
+
+    logTicks++;
+    if (sensors->logDue(simMs))
+    {
+      loggedRows++;
+      sensors->markLogged(simMs);
+    }
+  }
+
+  void jobDoTrend()
+  {
+    if (!sensors->health[CHI_OKS].valid() || !sensors->health[CHI_SUHU].valid())
+    {
+      doTrend.reset();
+      return;
+    }
+    doTrend.update(sensors->value[CHI_OKS], sensors->value[CHI_SUHU]);
+  }
+
+  void jobTurbidityCycle()
+  {
+    turbidityCycleOn = !turbidityCycleOn;
+  }
+
+  bool loadTrace(const char *path)
+  {
+    FILE *f = fopen(path, "r");
+    if (!f)
+    {
+      perror(path);
+      return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f))
+    {
+      if (strncmp(line, "t_ms,", 5) == 0)
+      {
+        rawTrace = strstr(line, "adc_") != nullptr;
+        continue;
+      }
+      Row r;
+      if (line[0] == '#' || sscanf(line, "%lf,%f,%f,%f,%f", &r.t, &r.ph, &r.turb, &r.oks, &r.suhu) != 5)
+        continue;
+      if (!rows.empty() && r.t <= rows.back().t)
+        continue; // millis() wrap/reboot di tengah export: lewati
+      rows.push_back(r);
+    }
+    fclose(f);
+    return rows.size() >= 2;
+  }
+
+  bool parseBand(const char *arg, threshold_t &band)
+  {
+    return sscanf(arg, "%f:%f", &band.min, &band.max) == 2 && band.min <= band.max;
+  }
+
+  double cpuSeconds()
+  {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+  }
+
+  void usage()
+  {
+    fprintf(stderr,
+            "usage: control_replay TRACE.csv [--ph MIN:MAX] [--turb MIN:MAX] [--oks MIN:MAX] [--suhu MIN:MAX]\n"
+            "                      [--turb-cycle MS] [--adc-interval MS] [--noise COUNTS] [--seed N] [--adaptive]\n"
+            "                      [--max-switches N] [--max-switches-per-hour RELAY=N]...\n"
+            "                      [--max-dosing-duty PCT] [--max-latency KANAL=S]...\n");
+  }
+
+  void printReaction(const char *key, const Reaction &r)
+  {
+    printf("%-16s %8u %9.1fs %9.1fs %8u\n", key, r.episodes, r.episodes ? r.sumMs / 1000.0 / r.episodes : 0.0,
+           r.maxMs / 1000.0, r.missed);
+  }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    usage();
+    return 2;
+  }
+  const char *path = argv[1];
+  long maxSwitches = -1;
+  double maxPerHour[5] = {-1, -1, -1, -1, -1};
+  double maxDosingDutyPct = -1;
+  double maxLatencyS[channelCount];
+  for (int i = 0; i < channelCount; i++)
+    maxLatencyS[i] = -1;
+  threshold_t band[channelCount];
+  for (int i = 0; i < channelCount; i++)
+    band[i] = channels[i].threshold;
+
+  for (int i = 2; i < argc; i++)
+  {
+    std::string a = argv[i];
+    bool ok = i + 1 < argc;
+    if (a == "--adaptive")
+      ok = adaptive = true;
+    else if (ok && a == "--ph")
+      ok = parseBand(argv[++i], band[CHI_PH]);
+    else if (ok && a == "--turb")
+      ok = parseBand(argv[++i], band[CHI_TURB]);
+    else if (ok && a == "--oks")
+      ok = parseBand(argv[++i], band[CHI_OKS]);
+    else if (ok && a == "--suhu")
+      ok = parseBand(argv[++i], band[CHI_SUHU]);
+    else if (ok && a == "--turb-cycle")
+      ok = (turbCycleMs = (uint32_t)atol(argv[++i])) > 0;
+    else if (ok && a == "--adc-interval")
+      ok = (adcIntervalMs = (uint32_t)atol(argv[++i])) > 0;
+    else if (ok && a == "--noise")
+      noiseCounts = (float)atof(argv[++i]);
+    else if (ok && a == "--seed")
+      rng = strtoull(argv[++i], nullptr, 10) | 1;
+    else if (ok && a == "--max-switches")
+      maxSwitches = atol(argv[++i]);
+    else if (ok && a == "--max-switches-per-hour")
+    {
+      int relayNo;
+      double limit;
+      ok = sscanf(argv[++i], "%d=%lf", &relayNo, &limit) == 2 && relayNo >= 1 && relayNo <= 5;
+      if (ok)
+        maxPerHour[relayNo - 1] = limit;
+    }
+    else if (ok && a == "--max-dosing-duty")
+      maxDosingDutyPct = atof(argv[++i]);
+    else if (ok && a == "--max-latency")
+    {
+      char key[16];
+      double limit;
+      ok = sscanf(argv[++i], "%15[^=]=%lf", key, &limit) == 2;
+      int ch = ok ? channels.indexOf(key) : -1;
+      ok = ch == CHI_PH || ch == CHI_OKS;
+      if (ok)
+        maxLatencyS[ch] = limit;
+    }
+    else
+      ok = false;
+    if (!ok)
+    {
+      usage();
+      return 2;
+    }
+  }
+
+  if (!loadTrace(path))
+  {
+    fprintf(stderr, "jejak kosong atau tidak valid\n");
+    return 2;
+  }
+
+  // Tanpa --adaptive: semua kanal dibaca setiap adcIntervalMs, deadband dan heartbeat 0
+  // (setiap tick log dicatat)
+  if (!adaptive)
+    for (int i = 0; i < channelCount; i++)
+      table.ch[i].sampling = {(uint16_t)adcIntervalMs, (uint16_t)adcIntervalMs, 0.0f, 0.0f, 0.0f, 0};
+  static ChannelBank<channelCount> bank(table);
+  sensors = &bank;
+  oksigenSuhuSource() = &sensors->value[CHI_SUHU]; // seperti setup()
+  for (int i = 0; i < channelCount; i++)
+    sensors->threshold[i] = band[i];
+
+  // Jam simulasi dimulai dari timestamp pertama jejak; seperti setup(), suhu dibaca
+  // sekali sebelum job berjalan. Urutan pendaftaran sama dengan firmware.
+  simMs = (uint32_t)rows.front().t;
+  const uint32_t endMs = (uint32_t)rows.back().t;
+  sensors->setValue(CHI_SUHU, rows.front().suhu, simMs);
+  jobs.every("auto", autoIntervalMs, jobAuto, simMs);
+  adcJobId = jobs.every("adc", adcIntervalMs, jobAdc, simMs);
+  jobs.every("tempRequest", tempRequestInterval, jobTempRequest, simMs);
+  jobs.every("log", logIntervalMs, jobLog, simMs);
+  jobs.every("doTrend", doTrendConfig.sampleIntervalMs, jobDoTrend, simMs);
+  jobs.every("turbCycle", turbCycleMs, jobTurbidityCycle, simMs);
+
+  double cpu0 = cpuSeconds();
+  while (simMs < endMs)
+  {
+    uint32_t wait = jobs.run(simMs);
+    simMs += wait ? wait : 1; // loop firmware juga tidur sampai deadline berikutnya
+  }
+  double cpu = cpuSeconds() - cpu0;
+
+  for (int i = 0; i < 5; i++)
+    if (relay[i])
+      relayOnMs[i] += simMs - relayOnSince[i];
+  // Kejadian yang belum ditanggapi saat jejak habis dihitung tak ditanggapi
+  if (phReaction.waiting)
+    phReaction.close(simMs, false);
+  if (oksReaction.waiting)
+    oksReaction.close(simMs, false);
+
+  const double spanMs = endMs - rows.front().t;
+  const double hours = spanMs / 3600000.0;
+  static const char *relays[5] = {"relay1 basa", "relay2 asam", "relay3 pompa", "relay4 aerator", "relay5 heater"};
+
+  printf("jejak: %s (%zu baris, %s), %.2f jam simulasi\n", path, rows.size(), rawTrace ? "ADC mentah" : "nilai akhir", hours);
+  printf("%-16s %8s %8s %10s\n", "relay", "switch", "/jam", "nyala");
+  long totalSwitches = 0;
+  for (int i = 0; i < 5; i++)
+  {
+    totalSwitches += switches[i];
+    printf("%-16s %8u %8.1f %9.1f%%\n", relays[i], switches[i], switches[i] / hours, 100.0 * relayOnMs[i] / spanMs);
+  }
+  const double dosingDutyPct = 100.0 * (relayOnMs[0] + relayOnMs[1]) / spanMs;
+  printf("duty dosing pH (relay1 + relay2): %.2f%%\n", dosingDutyPct);
+
+  printf("%-16s %13s %9s %9s %9s\n", "kanal", "band", "< min", "> max", "fault");
+  for (int ch = 0; ch < channelCount; ch++)
+  {
+    char range[32];
+    snprintf(range, sizeof(range), "%.2f..%.2f", sensors->threshold[ch].min, sensors->threshold[ch].max);
+    printf("%-16s %13s %8.1f%% %8.1f%% %8.1f%%\n", channels[ch].key, range, 100.0 * belowMs[ch] / spanMs,
+           100.0 * aboveMs[ch] / spanMs, 100.0 * faultMs[ch] / spanMs);
+  }
+  printf("kejadian fault sensor: %u\n", faultEvents);
+
+  printf("%-16s %8s %10s %10s %8s\n", "reaksi", "kejadian", "rata-rata", "maks", "terlewat");
+  printReaction("ph -> dosing", phReaction);
+  printReaction("oks -> aerator", oksReaction);
+
+  printf("sampling%s: %.0f baca ADC/jam, %.0f baca suhu/jam, %.0f baris riwayat/jam (%.1f%% tick log)\n",
+         adaptive ? " adaptif" : "", adcReads / hours, tempReads / hours, loggedRows / hours,
+         100.0 * loggedRows / (logTicks ? logTicks : 1));
+  printf("CPU: %.1f ms per jam simulasi, %.0fx waktu nyata\n", cpu * 1000.0 / hours, spanMs / 1000.0 / cpu);
+
+  int rc = 0;
+  if (maxSwitches >= 0 && totalSwitches > maxSwitches)
+  {
+    printf("GAGAL: total switch %ld > %ld\n", totalSwitches, maxSwitches);
+    rc = 1;
+  }
+  for (int i = 0; i < 5; i++)
+    if (maxPerHour[i] >= 0 && switches[i] / hours > maxPerHour[i])
+    {
+      printf("GAGAL: %s %.1f switch/jam > %.1f\n", relays[i], switches[i] / hours, maxPerHour[i]);
+      rc = 1;
+    }
+  if (maxDosingDutyPct >= 0 && dosingDutyPct > maxDosingDutyPct)
+  {
+    printf("GAGAL: duty dosing %.2f%% > %.2f%%\n", dosingDutyPct, maxDosingDutyPct);
+    rc = 1;
+  }
+  const Reaction *reactions[channelCount] = {};
+  reactions[CHI_PH] = &phReaction;
+  reactions[CHI_OKS] = &oksReaction;
+  for (int ch = 0; ch < channelCount; ch++)
+    if (maxLatencyS[ch] >= 0 && reactions[ch]->maxMs / 1000.0 > maxLatencyS[ch])
+    {
+      printf("GAGAL: latensi reaksi %s %.1f s > %.1f s\n", channels[ch].key, reactions[ch]->maxMs / 1000.0,
+             maxLatencyS[ch]);
+      rc = 1;
+    }
+  return rc;
+}
@@ -0,0 +1,136 @@
+// Validasi estimator tren DO (include/DoTrend.h) dengan memutar ulang jejak malam.
+//
+//   do_trend_replay traces/night_do.csv [threshold_min=5.0]
+//
+// Format CSV: t_s,oks_mgl,suhu_c (baris '#' diabaikan). Jejak diinterpolasi ke
+// interval sampel firmware (10 s). Laporan: kapan aturan reaktif (DO < min) dan
+// aturan prediktif menyalakan aerator, selisih waktunya, serta galat prediksi
+// DO 20 menit ke depan dibanding nilai sebenarnya di jejak.
+// Exit code 1 jika prediktif tidak lebih awal dari reaktif.
+
+#include "DoTrend.h"
+#include "KitConfig.h"
+
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+struct Row
+{
+  double t;
+  float oks;
+  float suhu;
+};
+
+static bool loadTrace(const char *path, std::vector<Row> &rows)
+{
+  FILE *f = fopen(path, "r");
+  if (!f)
+  {
+    perror(path);
+    return false;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), f))
+  {
+    Row r;
+    if (line[0] == '#' || sscanf(line, "%lf,%f,%f", &r.t, &r.oks, &r.suhu) != 3)
+      continue;
+    rows.push_back(r);
+  }
+  fclose(f);
+  return rows.size() >= 2;
+}
+
+// Interpolasi linear jejak pada waktu t
+static Row sampleAt(const std::vector<Row> &rows, size_t &cursor, double t)
+{
+  while (cursor + 2 < rows.size() && rows[cursor + 1].t <= t)
+    cursor++;
+  const Row &a = rows[cursor];
+  const Row &b = rows[cursor + 1];
+  double f = b.t > a.t ? (t - a.t) / (b.t - a.t) : 0;
+  if (f < 0)
+    f = 0;
+  if (f > 1)
+    f = 1;
+  return {t, (float)(a.oks + (b.oks - a.oks) * f), (float)(a.suhu + (b.suhu - a.suhu) * f)};
+}
+
+static void printClock(const char *label, double t)
+{
+  if (t < 0)
+  {
+    printf("%-22s -\n", label);
+    return;
+  }
+  int s = (int)t;
+  printf("%-22s t=%6ds (+%02d:%02d)\n", label, s, s / 3600, (s / 60) % 60);
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: do_trend_replay TRACE.csv [threshold_min]\n");
+    return 2;
+  }
+  float threshold = argc > 2 ? (float)atof(argv[2]) : 5.0f;
+
+  std::vector<Row> rows;
+  if (!loadTrace(argv[1], rows))
+  {
+    fprintf(stderr, "jejak kosong atau tidak valid\n");
+    return 2;
+  }
+
+  // Konfigurasi firmware (KitConfig.h)
+  const DoTrendConfig &cfg = doTrendConfig;
+  DoTrend trend(cfg);
+  const double dt = cfg.sampleIntervalMs / 1000.0;
+  const float horizon = cfg.leadSec;
+
+  double reactiveAt = -1, predictiveAt = -1;
+  double errSum = 0, errMax = 0;
+  int errCount = 0;
+  size_t cursor = 0;
+
+  for (double t = rows.front().t; t <= rows.back().t; t += dt)
+  {
+    Row r = sampleAt(rows, cursor, t);
+    trend.update(r.oks, r.suhu);
+
+    if (reactiveAt < 0 && r.oks < threshold)
+      reactiveAt = t;
+    // Sama seperti autoRelayDecide(): DO < min atau prediksi menyalakan aerator
+    if (predictiveAt < 0 && trend.shouldAerate(threshold, INFINITY, r.oks))
+      predictiveAt = t;
+
+    if (trend.ready() && t + horizon <= rows.back().t)
+    {
+      size_t look = cursor;
+      Row future = sampleAt(rows, look, t + horizon);
+      double err = fabs(trend.forecast(horizon) - future.oks);
+      errSum += err;
+      errMax = err > errMax ? err : errMax;
+      errCount++;
+    }
+  }
+
+  printf("jejak: %s (%zu baris), threshold min %.2f mg/L\n", argv[1], rows.size(), threshold);
+  printClock("aerator reaktif:", reactiveAt);
+  printClock("aerator prediktif:", predictiveAt);
+  if (reactiveAt >= 0 && predictiveAt >= 0)
+    printf("%-22s %.1f menit\n", "lebih awal:", (reactiveAt - predictiveAt) / 60.0);
+  if (errCount)
+    printf("galat prediksi %2.0f mnt: rata-rata %.3f mg/L, maks %.3f mg/L (%d titik)\n",
+           horizon / 60, errSum / errCount, errMax, errCount);
+
+  if (reactiveAt >= 0 && (predictiveAt < 0 || predictiveAt > reactiveAt))
+  {
+    printf("GAGAL: prediktif tidak lebih awal dari reaktif\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,389 @@
+// Benchmark riwayat terkompresi (include/HistoryStore.h) dengan jejak kolam.
+//
+//   history_bench traces/day_pond.csv [--log-interval MS] [--noise COUNTS] [--seed N]
+//
+// Jejak /export (t_ms,ph,turb,oks,suhu) diinterpolasi ke interval pencatatan
+// firmware (logIntervalMs = 50 ms). Kanal analog diberi derau sisa filter EMA
+// Analog.h (alpha 0.1, ADC tiap 1 ms: sigma = noise * sqrt(alpha / (2 - alpha)),
+// praktis tidak berkorelasi antar sampel 50 ms) lalu dibulatkan ke count ADC;
+// suhu dikuantisasi ke resolusi DS18B20 (0.0625 °C). Timestamp diberi jitter
+// keterlambatan loop 0..3 ms.
+//
+// Laporan: byte/sampel dibanding DataNode di linked list, ns/sampel encode dan
+// decode, galat maksimum terhadap nilai asli, serta perkiraan byte/sampel untuk
+// nilai saja jika dikodekan XOR float (Gorilla asli) sebagai pembanding.
+// Exit code 1 jika round trip tidak sesuai (timestamp berbeda atau galat > resolution/2).
+//
+// Indeks agregat /stats (include/HistoryStats.h) diisi sampel yang sama, dengan
+// satu jeda pencatatan dan satu periode DO tidak valid (NaN), lalu setiap query
+// dibandingkan dengan pemindaian langsung seluruh sampel. Exit code 1 jika
+// jumlah sampel, min/max, durasi atau rata-rata berbeda.
+
+#include "HistoryStats.h"
+#include "HistoryStore.h"
+
+#include <vector>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Sama dengan firmware (src/main.cpp)
+const float historyResolution = 0.01f;
+const int historyBlockBytes = 256;
+const int historyBlocks = 32;
+
+const uint32_t statsBucketMs = 600000;
+const int statsBuckets = 144;
+const uint32_t statsMaxGapMs = 60000;
+const threshold_t thresholds[4] = {{6.5f, 8.5f}, {20.0f, 70.0f}, {5.0f, 14.0f}, {20.0f, 30.0f}};
+
+typedef HistoryStore<4, historyBlockBytes, 32768> BenchStore; // cukup untuk 24 jam tanpa membuang blok
+typedef HistoryStore<4, historyBlockBytes, historyBlocks> FirmwareStore;
+
+typedef HistoryStats<4, statsBuckets> FirmwareStats;
+
+struct Row
+{
+  double t;
+  float v[4];
+};
+
+static bool loadTrace(const char *path, std::vector<Row> &rows)
+{
+  FILE *f = fopen(path, "r");
+  if (!f)
+  {
+    perror(path);
+    return false;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), f))
+  {
+    Row r;
+    if (line[0] == '#' || sscanf(line, "%lf,%f,%f,%f,%f", &r.t, &r.v[0], &r.v[1], &r.v[2], &r.v[3]) != 5)
+      continue;
+    rows.push_back(r);
+  }
+  fclose(f);
+  return rows.size() >= 2;
+}
+
+static uint64_t rng = 1;
+
+static double uniform()
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return ((rng >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+static float gauss()
+{
+  static bool hasSpare = false;
+  static float spare;
+  if (hasSpare)
+  {
+    hasSpare = false;
+    return spare;
+  }
+  double r = sqrt(-2.0 * log(uniform()));
+  double a = 2.0 * M_PI * uniform();
+  spare = (float)(r * sin(a));
+  hasSpare = true;
+  return (float)(r * cos(a));
+}
+
+// Bit yang dibutuhkan Gorilla XOR untuk satu nilai float (leading/trailing zero window)
+struct XorEstimator
+{
+  uint32_t prev = 0;
+  int lead = -1, trail = 0;
+  bool first = true;
+
+  int bits(float v)
+  {
+    uint32_t x;
+    memcpy(&x, &v, sizeof(x));
+    if (first)
+    {
+      first = false;
+      prev = x;
+      return 32;
+    }
+    uint32_t d = x ^ prev;
+    prev = x;
+    if (!d)
+      return 1;
+    int l = __builtin_clz(d), t = __builtin_ctz(d);
+    if (l > 31)
+      l = 31;
+    if (lead >= 0 && l >= lead && t >= trail)
+      return 2 + (32 - lead - trail);
+    lead = l;
+    trail = t;
+    return 2 + 5 + 6 + (32 - l - t);
+  }
+};
+
+// Agregat dengan pemindaian langsung, semantik sama dengan HistoryStats:
+// nilai berlaku sampai sampel berikutnya (jeda > statsMaxGapMs tidak dihitung),
+// jendela [w0, w1), sampel di luar threshold menurut threshold tetap
+static StatsResult scanStats(const std::vector<BenchStore::Sample> &s, int ch, uint32_t w0, uint64_t w1)
+{
+  StatsResult r = {w0, 0, 0, INFINITY, -INFINITY, 0, 0, 0, 0};
+  double sum = 0;
+  for (size_t i = 0; i < s.size(); i++)
+  {
+    float v = s[i].v[ch];
+    bool in = s[i].t >= w0 && s[i].t < w1;
+    bool out = !isnan(v) && (v < thresholds[ch].min || v > thresholds[ch].max);
+    if (in)
+    {
+      r.samples++;
+      r.outSamples += out;
+    }
+    uint64_t a = s[i].t, b = a;
+    if (i + 1 < s.size() && s[i + 1].t - s[i].t <= statsMaxGapMs)
+      b = s[i + 1].t;
+    a = a < w0 ? w0 : a;
+    b = b > w1 ? w1 : b;
+    bool held = b > a;
+    if (isnan(v) || (!in && !held))
+      continue;
+    r.min = v < r.min ? v : r.min;
+    r.max = v > r.max ? v : r.max;
+    if (held)
+    {
+      r.validMs += (uint32_t)(b - a);
+      r.outMs += out ? (uint32_t)(b - a) : 0;
+      sum += (double)v * (b - a);
+    }
+  }
+  r.mean = r.validMs ? (float)(sum / r.validMs) : NAN;
+  return r;
+}
+
+static bool sameFloat(float a, float b, float tol)
+{
+  return (isnan(a) && isnan(b)) || fabsf(a - b) <= tol;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: history_bench TRACE.csv [--log-interval MS] [--noise COUNTS] [--seed N]\n");
+    return 2;
+  }
+  int logInterval = 50;
+  float noiseCounts = 4.0f;
+  for (int i = 2; i + 1 < argc; i += 2)
+  {
+    if (!strcmp(argv[i], "--log-interval"))
+      logInterval = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--noise"))
+      noiseCounts = (float)atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--seed"))
+      rng = strtoull(argv[i + 1], nullptr, 10) | 1;
+    else
+    {
+      fprintf(stderr, "opsi tidak dikenal: %s\n", argv[i]);
+      return 2;
+    }
+  }
+  if (logInterval <= 0)
+  {
+    fprintf(stderr, "--log-interval harus > 0\n");
+    return 2;
+  }
+
+  std::vector<Row> rows;
+  if (!loadTrace(argv[1], rows))
+  {
+    fprintf(stderr, "jejak kosong atau tidak valid\n");
+    return 2;
+  }
+
+  // Bangkitkan sampel seperti yang dicatat jobLog()
+  const float fullScale[3] = {14.0f, 100.0f, 20.0f}; // pH, NTU, mg/L untuk ADC 12 bit
+  const float emaNoise = noiseCounts * sqrtf(0.1f / (2.0f - 0.1f));
+  std::vector<BenchStore::Sample> samples;
+  size_t cursor = 0;
+  uint32_t t0 = (uint32_t)rows.front().t;
+  for (uint32_t t = t0; t <= rows.back().t; t += logInterval)
+  {
+    while (cursor + 2 < rows.size() && rows[cursor + 1].t <= t)
+      cursor++;
+    const Row &a = rows[cursor], &b = rows[cursor + 1];
+    double f = b.t > a.t ? (t - a.t) / (b.t - a.t) : 0;
+    f = f < 0 ? 0 : (f > 1 ? 1 : f);
+
+    BenchStore::Sample s;
+    for (int c = 0; c < 3; c++)
+    {
+      float v = (float)(a.v[c] + (b.v[c] - a.v[c]) * f);
+      float adc = roundf(v / fullScale[c] * 4095.0f + emaNoise * gauss());
+      adc = adc < 0 ? 0 : (adc > 4095 ? 4095 : adc);
+      s.v[c] = adc / 4095.0f * fullScale[c];
+    }
+    float suhu = (float)(a.v[3] + (b.v[3] - a.v[3]) * f);
+    s.v[3] = roundf(suhu * 16.0f) / 16.0f;
+    s.t = t + (uniform() < 0.1 ? 1 + (uint32_t)(uniform() * 3) : 0);
+    samples.push_back(s);
+  }
+  const size_t n = samples.size();
+
+  // Encode
+  BenchStore *store = new BenchStore(historyResolution);
+  auto e0 = std::chrono::steady_clock::now();
+  for (const auto &s : samples)
+    store->append(s);
+  auto e1 = std::chrono::steady_clock::now();
+
+  // Decode + verifikasi
+  size_t decoded = 0;
+  float maxErr = 0;
+  bool tsMismatch = false;
+  double checksum = 0;
+  auto d0 = std::chrono::steady_clock::now();
+  for (auto r = store->begin(); r.get(); r.next())
+  {
+    const BenchStore::Sample *s = r.get();
+    checksum += s->v[0] + s->v[1] + s->v[2] + s->v[3];
+    decoded++;
+  }
+  auto d1 = std::chrono::steady_clock::now();
+  size_t i = 0;
+  for (auto r = store->begin(); r.get() && i < n; r.next(), i++)
+  {
+    const BenchStore::Sample *s = r.get();
+    if (s->t != samples[i].t)
+      tsMismatch = true;
+    for (int c = 0; c < 4; c++)
+    {
+      float err = fabsf(s->v[c] - samples[i].v[c]);
+      maxErr = err > maxErr ? err : maxErr;
+    }
+  }
+
+  // Pembanding: Gorilla XOR pada nilai float
+  XorEstimator xorEst[4];
+  double xorBits = 0;
+  for (const auto &s : samples)
+    for (int c = 0; c < 4; c++)
+      xorBits += xorEst[c].bits(s.v[c]);
+
+  double encNs = std::chrono::duration<double, std::nano>(e1 - e0).count() / n;
+  double decNs = std::chrono::duration<double, std::nano>(d1 - d0).count() / decoded;
+  double bytesPerSample = (double)store->bytesUsed() / n;
+  // DataNode: t + 4 float + pointer next (24 byte di ESP32) + ~8 byte overhead heap
+  const double nodeBytes = 32.0;
+
+  FirmwareStore *fw = new FirmwareStore(historyResolution);
+  for (const auto &s : samples)
+    fw->append({s.t, {s.v[0], s.v[1], s.v[2], s.v[3]}});
+
+  printf("jejak: %s, %zu sampel @ %d ms (noise %.1f count)\n", argv[1], n, logInterval, noiseCounts);
+  printf("kompresi:   %.2f byte/sampel, DataNode: %.0f byte -> %.1fx (XOR float, nilai saja: %.2f byte/sampel)\n",
+         bytesPerSample, nodeBytes, nodeBytes / bytesPerSample, xorBits / 8 / n);
+  printf("encode:     %.1f ns/sampel\n", encNs);
+  printf("decode:     %.1f ns/sampel (checksum %.0f)\n", decNs, checksum);
+  printf("galat maks: %.4f (resolusi %.2f)\n", maxErr, historyResolution);
+  printf("firmware:   %d x %d byte (%zu byte RAM) menyimpan %u sampel = %.1f menit; linked list: %.0f sampel\n",
+         historyBlocks, historyBlockBytes, FirmwareStore::capacityBytes(), fw->count(),
+         fw->count() * logInterval / 60000.0, FirmwareStore::capacityBytes() / nodeBytes);
+
+  bool fail = false;
+  if (decoded != n || tsMismatch)
+  {
+    printf("GAGAL: %zu dari %zu sampel terdekode, timestamp %s\n", decoded, n, tsMismatch ? "berbeda" : "sama");
+    fail = true;
+  }
+  if (maxErr > historyResolution * 0.5f + 1e-4f)
+  {
+    printf("GAGAL: galat melebihi setengah resolusi\n");
+    fail = true;
+  }
+
+  // Iterator pada store firmware: N terakhir dan pencarian timestamp
+  uint32_t keep = fw->count();
+  auto tail = fw->fromIndex(keep - 30);
+  auto byTime = fw->firstAfter(samples[n - 30].t, true);
+  for (int k = 0; k < 30; k++, tail.next(), byTime.next())
+  {
+    if (!tail.get() || !byTime.get() || tail.get()->t != samples[n - 30 + k].t || byTime.get()->t != tail.get()->t)
+    {
+      printf("GAGAL: fromIndex/firstAfter tidak cocok pada sampel %d dari 30 terakhir\n", k);
+      fail = true;
+      break;
+    }
+  }
+
+  // Indeks agregat: jeda 3 menit pada jam ke-5, DO tidak valid jam 10:00-10:05
+  std::vector<BenchStore::Sample> logged;
+  for (auto s : samples)
+  {
+    uint32_t rel = s.t - t0;
+    if (rel >= 5 * 3600000u && rel < 5 * 3600000u + 180000u)
+      continue;
+    if (rel >= 10 * 3600000u && rel < 10 * 3600000u + 300000u)
+      s.v[2] = NAN;
+    logged.push_back(s);
+  }
+  FirmwareStats *stats = new FirmwareStats(statsBucketMs, statsMaxGapMs);
+  auto s0 = std::chrono::steady_clock::now();
+  for (const auto &s : logged)
+    stats->append(s.t, s.v, thresholds);
+  auto s1 = std::chrono::steady_clock::now();
+
+  // Jendela uji: 6 jam terakhir, semua, satu bucket, bucket berjalan, lalu acak
+  uint32_t tEnd = logged.back().t;
+  std::vector<std::pair<uint32_t, uint32_t>> windows = {
+      {tEnd - 6 * 3600000u, tEnd}, {0, tEnd}, {t0 + 3 * statsBucketMs, t0 + 3 * statsBucketMs}, {tEnd, tEnd}};
+  for (int k = 0; k < 60; k++)
+  {
+    uint32_t a = t0 + (uint32_t)(uniform() * (tEnd - t0)), b = t0 + (uint32_t)(uniform() * (tEnd - t0));
+    windows.push_back({a < b ? a : b, a < b ? b : a});
+  }
+  int queries = 0, mismatches = 0;
+  double queryNs = 0;
+  for (const auto &w : windows)
+    for (int ch = 0; ch < 4; ch++)
+    {
+      StatsResult got;
+      auto q0 = std::chrono::steady_clock::now();
+      bool ok = stats->query(ch, w.first, w.second, got);
+      queryNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - q0).count();
+      queries++;
+      // bucket berjalan: sampai sampel terakhir (inklusif)
+      bool current = w.second >= tEnd - tEnd % statsBucketMs;
+      uint64_t end = current ? (uint64_t)tEnd + 1 : got.toMs;
+      StatsResult want = scanStats(logged, ch, got.fromMs, end);
+      if (!ok || got.samples != want.samples || got.outSamples != want.outSamples || got.validMs != want.validMs ||
+          got.outMs != want.outMs || !sameFloat(got.min, want.min, 0) || !sameFloat(got.max, want.max, 0) ||
+          !sameFloat(got.mean, want.mean, 1e-4f * (1 + fabsf(want.mean))))
+      {
+        if (!mismatches)
+          printf("GAGAL: stats %s [%u, %u]: %u sampel min %.3f max %.3f mean %.5f valid %u out %u/%u, "
+                 "scan %u sampel min %.3f max %.3f mean %.5f valid %u out %u/%u\n",
+                 ok ? "" : "(kosong) ", got.fromMs, got.toMs, got.samples, got.min, got.max, got.mean, got.validMs,
+                 got.outMs, got.outSamples, want.samples, want.min, want.max, want.mean, want.validMs, want.outMs,
+                 want.outSamples);
+        mismatches++;
+      }
+    }
+  printf("stats:      %d x %u menit (%zu byte RAM), append %.1f ns/sampel, query %.0f ns, %d/%d query cocok\n",
+         statsBuckets, statsBucketMs / 60000, FirmwareStats::capacityBytes(),
+         std::chrono::duration<double, std::nano>(s1 - s0).count() / logged.size(), queryNs / queries,
+         queries - mismatches, queries);
+  if (mismatches)
+    fail = true;
+
+  delete stats;
+  delete fw;
+  delete store;
+  return fail ? 1 : 0;
+}
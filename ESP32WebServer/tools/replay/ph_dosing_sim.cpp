@@ -0,0 +1,319 @@
+// Simulasi dosing pH tertutup: kontroler firmware (include/PhDosing.h) melawan
+// model pencampuran tangki sederhana.
+//
+//   ph_dosing_sim [--policy pid|onoff] [--hours H] [--start PH] [--ph MIN:MAX]
+//                 [--gain PH_PER_S] [--delay S] [--tau S] [--drift PH_PER_H]
+//                 [--kp K] [--ki K] [--kd K] [--noise COUNTS] [--seed N]
+//                 [--max-overshoot PH] [--min-in-band PCT] [--max-switches N]
+//
+// Model tangki: selama pompa nyala, dosis gain pH/detik masuk ke pipa dengan
+// keterlambatan transport `delay` detik, lalu tercampur orde satu dengan
+// konstanta waktu `tau` detik. pH alami berayun harian (fotosintesis siang
+// menaikkan, respirasi malam menurunkan) dengan amplitudo `drift` pH/jam.
+// pH terukur melewati jalur firmware: tegangan probe -> ADC 12 bit + derau ->
+// filter EMA Analog.h -> phFromVoltage().
+//
+// Kebijakan pembanding `onoff` meniru aturan lama yang dikomentari di
+// autoRelayLogic(): pulsa 5 detik berulang selama pH di luar band.
+//
+// Laporan: waktu di dalam band dan di band dalam kontroler sejak pH pertama
+// kali masuk band dalam, overshoot maksimum (pH melewati tepi band dalam di
+// sisi berlawanan dalam reverseLockMs setelah pulsa), IAE terhadap tengah band,
+// jumlah switch, dan dosis maksimum dalam jendela 60 menit per relay. Exit code 1 jika
+// batas --max-*/--min-* terlampaui, dosis per jam melebihi maxDoseMsPerHour
+// (+ satu window), atau ada pulsa arah berlawanan sebelum reverseLockMs. --max-switches membatasi total switch kedua
+// relay; `--start 7.3 --drift 0.05 --max-switches 0` memastikan air yang tetap
+// di band dalam tidak didosing sama sekali.
+
+#include "Analog.h"
+#include "AutoRelay.h"
+#include "KitConfig.h"
+#include "PhDosing.h"
+#include "SensorConversion.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace
+{
+
+  // Konfigurasi firmware (KitConfig.h); gain bisa diubah lewat opsi
+  PhDosingConfig cfg = phDosingConfig;
+  const uint32_t plantStepMs = 10;
+
+  uint64_t rng = 88172645463325252ULL;
+
+  double uniform()
+  {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return ((rng >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+  }
+
+  float gauss()
+  {
+    static bool hasSpare = false;
+    static float spare;
+    if (hasSpare)
+    {
+      hasSpare = false;
+      return spare;
+    }
+    double r = sqrt(-2.0 * log(uniform()));
+    double a = 2.0 * M_PI * uniform();
+    spare = (float)(r * sin(a));
+    hasSpare = true;
+    return (float)(r * cos(a));
+  }
+
+  // Kebalikan phFromVoltage() (sama dengan control_replay)
+  float phToVoltage(float ph) { return (ph - 1.85f) / (3.5f * 5.0f / 3.3f); }
+
+  // Dosis per detik pompa dalam 60 menit bergulir, resolusi 1 detik
+  struct HourWindow
+  {
+    std::vector<uint32_t> perSecond = std::vector<uint32_t>(3600, 0);
+    uint64_t sum = 0;
+    uint64_t worst = 0;
+    uint32_t second = 0;
+
+    void add(uint32_t nowMs, uint32_t ms)
+    {
+      uint32_t s = nowMs / 1000;
+      while (second < s)
+      {
+        second++;
+        sum -= perSecond[second % 3600];
+        perSecond[second % 3600] = 0;
+      }
+      perSecond[s % 3600] += ms;
+      sum += ms;
+      worst = sum > worst ? sum : worst;
+    }
+  };
+
+  void usage()
+  {
+    fprintf(stderr,
+            "usage: ph_dosing_sim [--policy pid|onoff] [--hours H] [--start PH] [--ph MIN:MAX]\n"
+            "                     [--gain PH_PER_S] [--delay S] [--tau S] [--drift PH_PER_H]\n"
+            "                     [--kp K] [--ki K] [--kd K] [--noise COUNTS] [--seed N]\n"
+            "                     [--max-overshoot PH] [--min-in-band PCT] [--max-switches N]\n");
+  }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  std::string policy = "pid";
+  double hours = 24;
+  float startPh = 8.6f;
+  threshold_t band = {6.5f, 8.5f};
+  double gain = 0.004;  // pH per detik pompa
+  double delayS = 20;   // transport pipa dosing
+  double tauS = 90;     // pencampuran
+  double drift = 0.15;  // amplitudo ayunan harian, pH per jam
+  float noiseCounts = 3.0f;
+  double maxOvershoot = -1;
+  double minInBandPct = -1;
+  long maxSwitches = -1;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string a = argv[i];
+    bool ok = i + 1 < argc;
+    if (ok && a == "--policy")
+      ok = (policy = argv[++i]) == "pid" || policy == "onoff";
+    else if (ok && a == "--hours")
+      ok = (hours = atof(argv[++i])) > 0;
+    else if (ok && a == "--start")
+      startPh = (float)atof(argv[++i]);
+    else if (ok && a == "--ph")
+      ok = sscanf(argv[++i], "%f:%f", &band.min, &band.max) == 2 && band.min < band.max;
+    else if (ok && a == "--gain")
+      ok = (gain = atof(argv[++i])) > 0;
+    else if (ok && a == "--delay")
+      ok = (delayS = atof(argv[++i])) >= 0;
+    else if (ok && a == "--tau")
+      ok = (tauS = atof(argv[++i])) > 0;
+    else if (ok && a == "--drift")
+      drift = atof(argv[++i]);
+    else if (ok && a == "--kp")
+      cfg.kp = (float)atof(argv[++i]);
+    else if (ok && a == "--ki")
+      cfg.ki = (float)atof(argv[++i]);
+    else if (ok && a == "--kd")
+      cfg.kd = (float)atof(argv[++i]);
+    else if (ok && a == "--noise")
+      noiseCounts = (float)atof(argv[++i]);
+    else if (ok && a == "--seed")
+      rng = strtoull(argv[++i], nullptr, 10) | 1;
+    else if (ok && a == "--max-overshoot")
+      maxOvershoot = atof(argv[++i]);
+    else if (ok && a == "--min-in-band")
+      minInBandPct = atof(argv[++i]);
+    else if (ok && a == "--max-switches")
+      maxSwitches = atol(argv[++i]);
+    else
+      ok = false;
+    if (!ok)
+    {
+      usage();
+      return 2;
+    }
+  }
+
+  const float setpoint = (band.min + band.max) * 0.5f;
+  const uint32_t endMs = (uint32_t)(hours * 3600000.0);
+  PhDosing dosing(cfg);
+  Analog phSensor(0, 0.1f);
+
+  // State tangki
+  double ph = startPh;
+  double unmixed = 0;                                        // dosis di tangki yang belum tercampur (pH)
+  std::deque<double> pipe((size_t)(delayS * 1000 / plantStepMs), 0.0); // dosis di pipa per langkah
+  uint8_t pump = 0;                                          // PhDoseRelay
+  uint32_t onoffStartMs = 0;
+
+  uint32_t switches[2] = {0, 0};
+  uint64_t onMs[2] = {0, 0};
+  HourWindow hour[2];
+  bool reached = false;
+  uint64_t settledMs = 0, inBandMs = 0, innerMs = 0;
+  double overshoot = 0, iae = 0;
+  const float innerHalf = cfg.engage * (band.max - band.min) * 0.5f;
+  uint8_t lastDose = 0; // arah pulsa terakhir yang selesai
+  uint32_t lastDoseEndMs = 0;
+  uint32_t quickReversals = 0; // pulsa arah berlawanan dalam reverseLockMs
+
+  for (uint32_t now = 0; now < endMs; now++)
+  {
+    // ADC tiap 1 ms seperti firmware
+    float adc = phToVoltage((float)ph) / 3.3f * 4095.0f + noiseCounts * gauss();
+    phSensor.update(adc < 0 ? 0 : (adc > 4095 ? 4095 : (int)lroundf(adc)));
+    phSensor.setFinal(phFromVoltage(phSensor.getVar(Analog::VOLTAGE)));
+
+    if (now % autoIntervalMs == 0)
+    {
+      float measured = phSensor.getVar(Analog::FINAL);
+      uint8_t next;
+      if (policy == "pid")
+        next = dosing.update(now, measured, band.min, band.max);
+      else
+      {
+        uint8_t want = measured < band.min ? PH_DOSE_BASE : (measured > band.max ? PH_DOSE_ACID : 0);
+        if (!want)
+          onoffStartMs = now;
+        next = (now - onoffStartMs) % 10000 < 5000 ? want : 0;
+      }
+      for (int r = 0; r < 2; r++)
+        if ((next ^ pump) & (1 << r))
+        {
+          switches[r]++;
+          if (pump & (1 << r))
+          {
+            lastDose = 1 << r;
+            lastDoseEndMs = now;
+          }
+          else if (lastDose && lastDose != (1 << r) && now - lastDoseEndMs < cfg.reverseLockMs)
+            quickReversals++;
+        }
+      pump = next;
+    }
+
+    if (now % plantStepMs == 0)
+    {
+      const double dt = plantStepMs * 0.001;
+      double dose = 0;
+      for (int r = 0; r < 2; r++)
+        if (pump & (1 << r))
+        {
+          onMs[r] += plantStepMs;
+          hour[r].add(now, plantStepMs);
+          dose += (r == 0 ? gain : -gain) * dt;
+        }
+      pipe.push_back(dose);
+      unmixed += pipe.front();
+      pipe.pop_front();
+      double mixed = unmixed * (dt / tauS);
+      unmixed -= mixed;
+      ph += mixed + drift / 3600.0 * sin(2 * M_PI * now / 86400000.0) * dt;
+
+      double err = ph - setpoint;
+      bool inner = fabs(err) <= innerHalf;
+      reached = reached || inner;
+      if (reached)
+      {
+        settledMs += plantStepMs;
+        if (ph >= band.min && ph <= band.max)
+          inBandMs += plantStepMs;
+        if (inner)
+          innerMs += plantStepMs;
+      }
+      // overshoot: dosis mendorong pH melewati tepi band dalam di sisi berlawanan
+      uint8_t dir = pump ? pump : lastDose;
+      if (dir && (pump || now - lastDoseEndMs < cfg.reverseLockMs))
+      {
+        double past = (dir & PH_DOSE_BASE ? err : -err) - innerHalf;
+        overshoot = past > overshoot ? past : overshoot;
+      }
+      iae += fabs(err) * dt / 3600.0;
+    }
+  }
+
+  printf("kebijakan: %s, %.1f jam, pH awal %.2f, band %.2f..%.2f (setpoint %.2f)\n", policy.c_str(), hours, startPh,
+         band.min, band.max, setpoint);
+  printf("tangki: gain %.4f pH/s, delay %.0f s, tau %.0f s, drift %.2f pH/jam\n", gain, delayS, tauS, drift);
+  if (policy == "pid")
+    printf("kontroler: kp %.3f ki %.4f kd %.3f, band dalam %.2f..%.2f, deadband %.2f, window %u ms, dead time %u ms,\n"
+           "           kunci arah balik %u ms, maks %u ms/jam\n",
+           cfg.kp, cfg.ki, cfg.kd, setpoint - cfg.engage * (band.max - band.min) * 0.5f,
+           setpoint + cfg.engage * (band.max - band.min) * 0.5f, cfg.deadband, cfg.windowMs, cfg.deadTimeMs,
+           cfg.reverseLockMs, cfg.maxDoseMsPerHour);
+  static const char *names[2] = {"relay1 basa", "relay2 asam"};
+  printf("%-12s %8s %10s %14s\n", "relay", "switch", "nyala", "maks/60 menit");
+  for (int r = 0; r < 2; r++)
+    printf("%-12s %8u %9.1fs %13.1fs\n", names[r], switches[r], onMs[r] / 1000.0, hour[r].worst / 1000.0);
+  if (reached)
+    printf("setelah masuk band dalam: di band %.1f%%, di band dalam %.1f%%, overshoot %.2f pH\n",
+           100.0 * inBandMs / settledMs, 100.0 * innerMs / settledMs, overshoot);
+  else
+    printf("pH tidak pernah masuk band dalam\n");
+  printf("IAE: %.3f pH.jam, pH akhir %.2f, balik arah < %u ms: %u\n", iae, ph, cfg.reverseLockMs, quickReversals);
+
+  bool fail = false;
+  if (policy == "pid")
+    for (int r = 0; r < 2; r++)
+      if (hour[r].worst > cfg.maxDoseMsPerHour + cfg.windowMs)
+      {
+        printf("GAGAL: %s dosis %.1f s dalam 60 menit melebihi batas %u ms\n", names[r], hour[r].worst / 1000.0,
+               cfg.maxDoseMsPerHour);
+        fail = true;
+      }
+  if (policy == "pid" && quickReversals)
+  {
+    printf("GAGAL: %u pulsa arah berlawanan sebelum %u ms\n", quickReversals, cfg.reverseLockMs);
+    fail = true;
+  }
+  if (maxSwitches >= 0 && switches[0] + switches[1] > maxSwitches)
+  {
+    printf("GAGAL: %u switch > %ld\n", switches[0] + switches[1], maxSwitches);
+    fail = true;
+  }
+  if (maxOvershoot >= 0 && overshoot > maxOvershoot)
+  {
+    printf("GAGAL: overshoot %.2f > %.2f\n", overshoot, maxOvershoot);
+    fail = true;
+  }
+  if (minInBandPct >= 0 && (!reached || 100.0 * inBandMs / settledMs < minInBandPct))
+  {
+    printf("GAGAL: waktu di band < %.1f%%\n", minInBandPct);
+    fail = true;
+  }
+  return fail ? 1 : 0;
+}